@@ -1,10 +1,6 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTex;
-layout (location = 2) in float aTexLayer;
-layout (location = 3) in vec3 aNormal;
-layout (location = 4) in float aLightLevel;
-layout (location = 5) in float aAO;
+layout (location = 0) in uint aPosition;
+layout (location = 1) in uint aAttributes;
 
 out vec2 texCoord;
 out float texLayer;
@@ -16,9 +12,26 @@ out float ao;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 chunkOffset;
+
+const vec3 faceNormals[6] = vec3[6](
+    vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, 1.0),
+    vec3(-1.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0)
+);
 
 void main()
 {
+    // Unpack the 8 byte vertex, see PackedVertex in Block.h
+    vec3 aPos = vec3(float(aPosition & 0x1FFu) - 16.0,
+                     float((aPosition >> 9u) & 0xFFFu),
+                     float((aPosition >> 21u) & 0x1FFu) - 16.0) / 16.0 + chunkOffset;
+    float aAO = float(aPosition >> 30u);
+    vec3 aNormal = faceNormals[aAttributes & 0x7u];
+    float aLightLevel = float((aAttributes >> 3u) & 0xFu) / 15.0;
+    float aTexLayer = float((aAttributes >> 7u) & 0xFFu);
+    vec2 aTex = vec2(float((aAttributes >> 15u) & 0x1Fu), float((aAttributes >> 20u) & 0xFFu));
+
     vec4 worldPos = model * vec4(aPos, 1.0);
     gl_Position = projection * view * worldPos;
 
@@ -27,5 +40,5 @@ void main()
     FragPos = worldPos.xyz;
     Normal = mat3(transpose(inverse(model))) * aNormal;
     LightLevel = aLightLevel;
-    ao = aAO;
+    ao = clamp(1.0 - aAO / 3.0, 0.9, 1.0);
 }
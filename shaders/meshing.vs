@@ -1,7 +1,6 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTex;
-layout (location = 2) in float aTexLayer;
+layout (location = 0) in uint aPosition;
+layout (location = 1) in uint aAttributes;
 
 out vec2 texCoord;
 out float texLayer;
@@ -9,10 +8,16 @@ out float texLayer;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 chunkOffset;
 
 void main()
 {
+    // Unpack the 8 byte vertex, see PackedVertex in Block.h
+    vec3 aPos = vec3(float(aPosition & 0x1FFu) - 16.0,
+                     float((aPosition >> 9u) & 0xFFFu),
+                     float((aPosition >> 21u) & 0x1FFu) - 16.0) / 16.0 + chunkOffset;
+
     gl_Position = projection * view * model * vec4(aPos, 1.0);
-    texCoord = aTex;
-    texLayer = aTexLayer;
-}
\ No newline at end of file
+    texCoord = vec2(float((aAttributes >> 15u) & 0x1Fu), float((aAttributes >> 20u) & 0xFFu));
+    texLayer = float((aAttributes >> 7u) & 0xFFu);
+}
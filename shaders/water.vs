@@ -1,11 +1,7 @@
 #version 330 core
 
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec2 aTexCoord;
-layout(location = 2) in float aTexLayer;
-layout(location = 3) in vec3 aNormal;
-layout(location = 4) in float aLightLevel;
-layout(location = 5) in float aAO;
+layout(location = 0) in uint aPosition;
+layout(location = 1) in uint aAttributes;
 
 out vec3 FragPos;
 out vec2 TexCoords;
@@ -17,20 +13,38 @@ out float AO;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform float time;
+uniform vec3 chunkOffset;
+
+const float waveSpeed = 2.3;
+const float waveFrequency = 1.2;
+const float waveAmplitude = 0.05;
+
+const vec3 faceNormals[6] = vec3[6](
+    vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, 1.0),
+    vec3(-1.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0)
+);
 
 void main()
 {
-    vec3 pos = aPos;
+    // Unpack the 8 byte vertex, see PackedVertex in Block.h
+    vec3 pos = vec3(float(aPosition & 0x1FFu) - 16.0,
+                    float((aPosition >> 9u) & 0xFFFu),
+                    float((aPosition >> 21u) & 0x1FFu) - 16.0) / 16.0 + chunkOffset;
+
     pos.y -= 0.21;
     pos.y += sin(pos.x) * 0.1;
+    pos.y += sin(pos.x * waveFrequency + time * waveSpeed) * waveAmplitude +
+             cos(pos.z * waveFrequency + time * waveSpeed) * waveAmplitude;
 
     FragPos = vec3(model * vec4(pos, 1.0));
 
-    TexCoords = aTexCoord;
-    TexLayer = aTexLayer;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    LightLevel = aLightLevel;
-    AO = aAO;
+    TexCoords = vec2(float((aAttributes >> 15u) & 0x1Fu), float((aAttributes >> 20u) & 0xFFu));
+    TexLayer = float((aAttributes >> 7u) & 0xFFu);
+    Normal = mat3(transpose(inverse(model))) * faceNormals[aAttributes & 0x7u];
+    LightLevel = float((aAttributes >> 3u) & 0xFu) / 15.0;
+    AO = clamp(1.0 - float(aPosition >> 30u) / 3.0, 0.9, 1.0);
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,585 @@
+#include "BatchNoise.h"
+#include <cstdint>
+#include <algorithm>
+
+// The kernels are written once against VFloat/VInt, which map to AVX2 (8 lanes) or SSE2 (4 lanes). Without
+// either, or with BATCH_NOISE_SCALAR defined, every sample goes through FastNoiseLite's own scalar code
+#if defined(__AVX2__) && !defined(BATCH_NOISE_SCALAR)
+#include <immintrin.h>
+#define BATCH_NOISE_AVX2
+#elif (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(BATCH_NOISE_SCALAR)
+#include <emmintrin.h>
+#define BATCH_NOISE_SSE2
+#endif
+
+#if defined(BATCH_NOISE_AVX2) || defined(BATCH_NOISE_SSE2)
+#define BATCH_NOISE_SIMD
+
+namespace {
+
+#if defined(BATCH_NOISE_AVX2)
+
+constexpr GLint LANE_COUNT = 8;
+
+struct VFloat { __m256 v; };
+struct VInt { __m256i v; };
+
+inline VFloat splat(float f) { return { _mm256_set1_ps(f) }; }
+inline VInt splat(int32_t i) { return { _mm256_set1_epi32(i) }; }
+inline VFloat load(const float* p) { return { _mm256_loadu_ps(p) }; }
+inline void store(float* p, VFloat a) { _mm256_storeu_ps(p, a.v); }
+
+inline VFloat operator+(VFloat a, VFloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline VFloat operator-(VFloat a, VFloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline VFloat operator*(VFloat a, VFloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline VInt operator+(VInt a, VInt b) { return { _mm256_add_epi32(a.v, b.v) }; }
+inline VInt operator-(VInt a, VInt b) { return { _mm256_sub_epi32(a.v, b.v) }; }
+inline VInt operator*(VInt a, VInt b) { return { _mm256_mullo_epi32(a.v, b.v) }; }
+inline VInt operator^(VInt a, VInt b) { return { _mm256_xor_si256(a.v, b.v) }; }
+inline VInt operator&(VInt a, VInt b) { return { _mm256_and_si256(a.v, b.v) }; }
+inline VInt operator|(VInt a, VInt b) { return { _mm256_or_si256(a.v, b.v) }; }
+template <int Bits> inline VInt shiftRight(VInt a) { return { _mm256_srai_epi32(a.v, Bits) }; }
+
+// Comparisons return a lane mask with every bit set where true
+inline VFloat greaterThan(VFloat a, VFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline VFloat greaterEqual(VFloat a, VFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+inline VFloat lessThan(VFloat a, VFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline VFloat maskAnd(VFloat mask, VFloat a) { return { _mm256_and_ps(mask.v, a.v) }; }
+inline VFloat maskAndNot(VFloat mask, VFloat a) { return { _mm256_andnot_ps(mask.v, a.v) }; }
+inline VFloat select(VFloat mask, VFloat a, VFloat b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+
+inline VFloat toFloat(VInt a) { return { _mm256_cvtepi32_ps(a.v) }; }
+inline VInt truncate(VFloat a) { return { _mm256_cvttps_epi32(a.v) }; }
+inline VInt asInt(VFloat a) { return { _mm256_castps_si256(a.v) }; }
+inline VFloat asFloat(VInt a) { return { _mm256_castsi256_ps(a.v) }; }
+
+inline VFloat gather(const float* table, VInt index) { return { _mm256_i32gather_ps(table, index.v, 4) }; }
+
+#elif defined(BATCH_NOISE_SSE2)
+
+constexpr GLint LANE_COUNT = 4;
+
+struct VFloat { __m128 v; };
+struct VInt { __m128i v; };
+
+inline VFloat splat(float f) { return { _mm_set1_ps(f) }; }
+inline VInt splat(int32_t i) { return { _mm_set1_epi32(i) }; }
+inline VFloat load(const float* p) { return { _mm_loadu_ps(p) }; }
+inline void store(float* p, VFloat a) { _mm_storeu_ps(p, a.v); }
+
+inline VFloat operator+(VFloat a, VFloat b) { return { _mm_add_ps(a.v, b.v) }; }
+inline VFloat operator-(VFloat a, VFloat b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline VFloat operator*(VFloat a, VFloat b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline VInt operator+(VInt a, VInt b) { return { _mm_add_epi32(a.v, b.v) }; }
+inline VInt operator-(VInt a, VInt b) { return { _mm_sub_epi32(a.v, b.v) }; }
+inline VInt operator*(VInt a, VInt b)
+{
+	// SSE2 has no 32 bit low multiply, multiply the even and odd lanes as 64 bit and interleave the low halves
+	__m128i even = _mm_mul_epu32(a.v, b.v);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+	return { _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0))) };
+}
+inline VInt operator^(VInt a, VInt b) { return { _mm_xor_si128(a.v, b.v) }; }
+inline VInt operator&(VInt a, VInt b) { return { _mm_and_si128(a.v, b.v) }; }
+inline VInt operator|(VInt a, VInt b) { return { _mm_or_si128(a.v, b.v) }; }
+template <int Bits> inline VInt shiftRight(VInt a) { return { _mm_srai_epi32(a.v, Bits) }; }
+
+inline VFloat greaterThan(VFloat a, VFloat b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+inline VFloat greaterEqual(VFloat a, VFloat b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+inline VFloat lessThan(VFloat a, VFloat b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline VFloat maskAnd(VFloat mask, VFloat a) { return { _mm_and_ps(mask.v, a.v) }; }
+inline VFloat maskAndNot(VFloat mask, VFloat a) { return { _mm_andnot_ps(mask.v, a.v) }; }
+inline VFloat select(VFloat mask, VFloat a, VFloat b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+
+inline VFloat toFloat(VInt a) { return { _mm_cvtepi32_ps(a.v) }; }
+inline VInt truncate(VFloat a) { return { _mm_cvttps_epi32(a.v) }; }
+inline VInt asInt(VFloat a) { return { _mm_castps_si128(a.v) }; }
+inline VFloat asFloat(VInt a) { return { _mm_castsi128_ps(a.v) }; }
+
+inline VFloat gather(const float* table, VInt index)
+{
+	alignas(16) int32_t lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), index.v);
+	return { _mm_setr_ps(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]) };
+}
+
+#endif
+
+inline VFloat negate(VFloat a) { return asFloat(asInt(a) ^ splat(static_cast<int32_t>(0x80000000))); }
+inline VFloat absolute(VFloat a) { return asFloat(asInt(a) & splat(0x7fffffff)); }
+
+// Same rounding as FastNoiseLite, including FastFloor stepping down on negative whole numbers
+inline VInt fastFloor(VFloat f) { return truncate(f) + asInt(lessThan(f, splat(0.0f))); }
+inline VInt fastRound(VFloat f) { return truncate(f + select(greaterEqual(f, splat(0.0f)), splat(0.5f), splat(-0.5f))); }
+
+inline VFloat lerp(VFloat a, VFloat b, VFloat t) { return a + t * (b - a); }
+inline VFloat interpQuintic(VFloat t) { return t * t * t * (t * (t * splat(6.0f) - splat(15.0f)) + splat(10.0f)); }
+
+constexpr int32_t PRIME_X = 501125321;
+constexpr int32_t PRIME_Y = 1136930381;
+constexpr int32_t PRIME_Z = 1720413743;
+
+// FastNoiseLite's gradient tables, which it keeps private
+alignas(32) const float GRADIENTS_2D[] = {
+	0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+	0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+	0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+	-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+	-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+	-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+	0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+	0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+	0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+	-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+	-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+	-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+	0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+	0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+	0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+	-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+	-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+	-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+	0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+	0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+	0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+	-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+	-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+	-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+	0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+	0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+	0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+	-0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+	-0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+	-0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+	0.38268343236509f, 0.923879532511287f, 0.923879532511287f, 0.38268343236509f, 0.923879532511287f, -0.38268343236509f, 0.38268343236509f, -0.923879532511287f,
+	-0.38268343236509f, -0.923879532511287f, -0.923879532511287f, -0.38268343236509f, -0.923879532511287f, 0.38268343236509f, -0.38268343236509f, 0.923879532511287f
+};
+
+alignas(32) const float GRADIENTS_3D[] = {
+	0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f,
+	1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f,
+	1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f,
+	1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f,
+	1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f,
+	1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f, 0.0f,
+	1.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f, -1.0f, 0.0f
+};
+
+inline VFloat gradCoord(int32_t seed, VInt xPrimed, VInt yPrimed, VFloat xd, VFloat yd)
+{
+	VInt hash = (splat(seed) ^ xPrimed ^ yPrimed) * splat(0x27d4eb2d);
+	hash = (hash ^ shiftRight<15>(hash)) & splat(127 << 1);
+	return xd * gather(GRADIENTS_2D, hash) + yd * gather(GRADIENTS_2D + 1, hash);
+}
+
+inline VFloat gradCoord(int32_t seed, VInt xPrimed, VInt yPrimed, VInt zPrimed, VFloat xd, VFloat yd, VFloat zd)
+{
+	VInt hash = (splat(seed) ^ xPrimed ^ yPrimed ^ zPrimed) * splat(0x27d4eb2d);
+	hash = (hash ^ shiftRight<15>(hash)) & splat(63 << 2);
+	return xd * gather(GRADIENTS_3D, hash) + yd * gather(GRADIENTS_3D + 1, hash) + zd * gather(GRADIENTS_3D + 2, hash);
+}
+
+VFloat singlePerlin(int32_t seed, VFloat x, VFloat y)
+{
+	VInt x0 = fastFloor(x);
+	VInt y0 = fastFloor(y);
+
+	VFloat xd0 = x - toFloat(x0);
+	VFloat yd0 = y - toFloat(y0);
+	VFloat xd1 = xd0 - splat(1.0f);
+	VFloat yd1 = yd0 - splat(1.0f);
+
+	VFloat xs = interpQuintic(xd0);
+	VFloat ys = interpQuintic(yd0);
+
+	x0 = x0 * splat(PRIME_X);
+	y0 = y0 * splat(PRIME_Y);
+	VInt x1 = x0 + splat(PRIME_X);
+	VInt y1 = y0 + splat(PRIME_Y);
+
+	VFloat xf0 = lerp(gradCoord(seed, x0, y0, xd0, yd0), gradCoord(seed, x1, y0, xd1, yd0), xs);
+	VFloat xf1 = lerp(gradCoord(seed, x0, y1, xd0, yd1), gradCoord(seed, x1, y1, xd1, yd1), xs);
+
+	return lerp(xf0, xf1, ys) * splat(1.4247691104677813f);
+}
+
+VFloat singleSimplex(int32_t seed, VFloat x, VFloat y)
+{
+	constexpr float SQRT3 = 1.7320508075688772935274463415059f;
+	constexpr float G2 = (3 - SQRT3) / 6;
+
+	VInt i = fastFloor(x);
+	VInt j = fastFloor(y);
+	VFloat xi = x - toFloat(i);
+	VFloat yi = y - toFloat(j);
+
+	VFloat t = (xi + yi) * splat(G2);
+	VFloat x0 = xi - t;
+	VFloat y0 = yi - t;
+
+	i = i * splat(PRIME_X);
+	j = j * splat(PRIME_Y);
+
+	VFloat a = splat(0.5f) - x0 * x0 - y0 * y0;
+	VFloat n0 = maskAnd(greaterThan(a, splat(0.0f)), (a * a) * (a * a) * gradCoord(seed, i, j, x0, y0));
+
+	VFloat c = splat(static_cast<float>(2 * (1 - 2 * G2) * (1 / G2 - 2))) * t + (splat(static_cast<float>(-2 * (1 - 2 * G2) * (1 - 2 * G2))) + a);
+	VFloat x2 = x0 + splat(2 * G2 - 1);
+	VFloat y2 = y0 + splat(2 * G2 - 1);
+	VFloat n2 = maskAnd(greaterThan(c, splat(0.0f)), (c * c) * (c * c) * gradCoord(seed, i + splat(PRIME_X), j + splat(PRIME_Y), x2, y2));
+
+	// The middle corner is (0, 1) in the upper triangle and (1, 0) in the lower one
+	VFloat isUpper = greaterThan(y0, x0);
+	VFloat x1 = x0 + select(isUpper, splat(G2), splat(G2 - 1));
+	VFloat y1 = y0 + select(isUpper, splat(G2 - 1), splat(G2));
+	VInt i1 = i + (asInt(maskAndNot(isUpper, asFloat(splat(PRIME_X)))));
+	VInt j1 = j + (asInt(maskAnd(isUpper, asFloat(splat(PRIME_Y)))));
+	VFloat b = splat(0.5f) - x1 * x1 - y1 * y1;
+	VFloat n1 = maskAnd(greaterThan(b, splat(0.0f)), (b * b) * (b * b) * gradCoord(seed, i1, j1, x1, y1));
+
+	return (n0 + n1 + n2) * splat(99.83685446303647f);
+}
+
+VFloat singleOpenSimplex2(int32_t seed, VFloat x, VFloat y, VFloat z)
+{
+	VInt i = fastRound(x);
+	VInt j = fastRound(y);
+	VInt k = fastRound(z);
+	VFloat x0 = x - toFloat(i);
+	VFloat y0 = y - toFloat(j);
+	VFloat z0 = z - toFloat(k);
+
+	VInt xNSign = truncate(splat(-1.0f) - x0) | splat(1);
+	VInt yNSign = truncate(splat(-1.0f) - y0) | splat(1);
+	VInt zNSign = truncate(splat(-1.0f) - z0) | splat(1);
+
+	VFloat ax0 = toFloat(xNSign) * negate(x0);
+	VFloat ay0 = toFloat(yNSign) * negate(y0);
+	VFloat az0 = toFloat(zNSign) * negate(z0);
+
+	i = i * splat(PRIME_X);
+	j = j * splat(PRIME_Y);
+	k = k * splat(PRIME_Z);
+
+	VFloat value = splat(0.0f);
+	VFloat a = (splat(0.6f) - x0 * x0) - (y0 * y0 + z0 * z0);
+
+	for (GLint l = 0; ; l++) {
+		value = value + maskAnd(greaterThan(a, splat(0.0f)), (a * a) * (a * a) * gradCoord(seed, i, j, k, x0, y0, z0));
+
+		// Step one unit along whichever axis is furthest from the lattice point, the other two stay put
+		VFloat stepX = maskAnd(greaterEqual(ax0, ay0), greaterEqual(ax0, az0));
+		VFloat stepY = maskAndNot(stepX, maskAnd(greaterThan(ay0, ax0), greaterEqual(ay0, az0)));
+		VFloat stepZ = maskAndNot(stepX, maskAndNot(stepY, asFloat(splat(-1))));
+
+		VFloat xSign = toFloat(xNSign), ySign = toFloat(yNSign), zSign = toFloat(zNSign);
+		VFloat x1 = x0 + maskAnd(stepX, xSign);
+		VFloat y1 = y0 + maskAnd(stepY, ySign);
+		VFloat z1 = z0 + maskAnd(stepZ, zSign);
+		VFloat b = a + splat(1.0f);
+		b = b - (maskAnd(stepX, toFloat(xNSign * splat(2)) * x1)
+			+ maskAnd(stepY, toFloat(yNSign * splat(2)) * y1)
+			+ maskAnd(stepZ, toFloat(zNSign * splat(2)) * z1));
+		VInt i1 = i - (asInt(stepX) & (xNSign * splat(PRIME_X)));
+		VInt j1 = j - (asInt(stepY) & (yNSign * splat(PRIME_Y)));
+		VInt k1 = k - (asInt(stepZ) & (zNSign * splat(PRIME_Z)));
+
+		value = value + maskAnd(greaterThan(b, splat(0.0f)), (b * b) * (b * b) * gradCoord(seed, i1, j1, k1, x1, y1, z1));
+
+		if (l == 1) break;
+
+		ax0 = splat(0.5f) - ax0;
+		ay0 = splat(0.5f) - ay0;
+		az0 = splat(0.5f) - az0;
+
+		x0 = xSign * ax0;
+		y0 = ySign * ay0;
+		z0 = zSign * az0;
+
+		a = a + ((splat(0.75f) - ax0) - (ay0 + az0));
+
+		i = i + (shiftRight<1>(xNSign) & splat(PRIME_X));
+		j = j + (shiftRight<1>(yNSign) & splat(PRIME_Y));
+		k = k + (shiftRight<1>(zNSign) & splat(PRIME_Z));
+
+		xNSign = splat(0) - xNSign;
+		yNSign = splat(0) - yNSign;
+		zNSign = splat(0) - zNSign;
+
+		seed = ~seed;
+	}
+
+	return value * splat(32.69428253173828125f);
+}
+
+struct KernelSettings {
+	int32_t seed;
+	float frequency;
+	int octaves;
+	float lacunarity;
+	float gain;
+	float fractalBounding;
+};
+
+template <FastNoiseLite::NoiseType Noise>
+VFloat single(int32_t seed, VFloat x, VFloat y)
+{
+	if constexpr (Noise == FastNoiseLite::NoiseType_Perlin) return singlePerlin(seed, x, y);
+	else return singleSimplex(seed, x, y);
+}
+
+template <FastNoiseLite::NoiseType Noise>
+VFloat single(int32_t seed, VFloat x, VFloat y, VFloat z)
+{
+	static_assert(Noise == FastNoiseLite::NoiseType_OpenSimplex2, "3D batch kernels only cover OpenSimplex2");
+	return singleOpenSimplex2(seed, x, y, z);
+}
+
+// Matches FastNoiseLite's GenFractalFBm/GenFractalRidged with the default weighted strength of 0, where
+// the per octave amplitude weighting multiplies by exactly 1 and drops out
+template <FastNoiseLite::NoiseType Noise, FastNoiseLite::FractalType Fractal, typename... Coords>
+VFloat fractal(const KernelSettings& settings, Coords... coords)
+{
+	if constexpr (Fractal == FastNoiseLite::FractalType_None) {
+		return single<Noise>(settings.seed, coords...);
+	}
+	else {
+		int32_t seed = settings.seed;
+		VFloat sum = splat(0.0f);
+		float amp = settings.fractalBounding;
+
+		for (GLint i = 0; i < settings.octaves; i++) {
+			VFloat noise = single<Noise>(seed++, coords...);
+			if constexpr (Fractal == FastNoiseLite::FractalType_FBm) {
+				sum = sum + noise * splat(amp);
+			}
+			else {
+				noise = absolute(noise);
+				sum = sum + (noise * splat(-2.0f) + splat(1.0f)) * splat(amp);
+			}
+
+			((coords = coords * splat(settings.lacunarity)), ...);
+			amp *= settings.gain;
+		}
+		return sum;
+	}
+}
+
+template <FastNoiseLite::NoiseType Noise, FastNoiseLite::FractalType Fractal>
+void fillPlaneKernel(const KernelSettings& settings, GLint originX, GLint originZ, GLint sizeX, GLint sizeZ, GLint step, GLfloat* out)
+{
+	alignas(32) float xs[LANE_COUNT], zs[LANE_COUNT], samples[LANE_COUNT];
+
+	for (GLint x = 0; x < sizeX; ++x) {
+		for (GLint z = 0; z < sizeZ; z += LANE_COUNT) {
+			GLint count = std::min<GLint>(LANE_COUNT, sizeZ - z);
+			for (GLint lane = 0; lane < LANE_COUNT; ++lane) {
+				xs[lane] = static_cast<float>(originX + x * step);
+				zs[lane] = static_cast<float>(originZ + (z + std::min(lane, count - 1)) * step);
+			}
+
+			VFloat sampleX = load(xs) * splat(settings.frequency);
+			VFloat sampleZ = load(zs) * splat(settings.frequency);
+			if constexpr (Noise == FastNoiseLite::NoiseType_OpenSimplex2) {
+				const float SQRT3 = 1.7320508075688772935274463415059f;
+				const float F2 = 0.5f * (SQRT3 - 1);
+				VFloat t = (sampleX + sampleZ) * splat(F2);
+				sampleX = sampleX + t;
+				sampleZ = sampleZ + t;
+			}
+
+			store(samples, fractal<Noise, Fractal>(settings, sampleX, sampleZ));
+			std::copy(samples, samples + count, out + x * sizeZ + z);
+		}
+	}
+}
+
+template <FastNoiseLite::NoiseType Noise, FastNoiseLite::FractalType Fractal>
+void fillBlockKernel(const KernelSettings& settings, GLint originX, GLint originY, GLint originZ, GLint sizeX, GLint sizeY, GLint sizeZ, GLint step, GLfloat* out)
+{
+	alignas(32) float ys[LANE_COUNT], samples[LANE_COUNT];
+
+	for (GLint x = 0; x < sizeX; ++x) {
+		for (GLint z = 0; z < sizeZ; ++z) {
+			for (GLint y = 0; y < sizeY; y += LANE_COUNT) {
+				GLint count = std::min<GLint>(LANE_COUNT, sizeY - y);
+				for (GLint lane = 0; lane < LANE_COUNT; ++lane) {
+					ys[lane] = static_cast<float>(originY + (y + std::min(lane, count - 1)) * step);
+				}
+
+				VFloat sampleX = splat(static_cast<float>(originX + x * step) * settings.frequency);
+				VFloat sampleY = load(ys) * splat(settings.frequency);
+				VFloat sampleZ = splat(static_cast<float>(originZ + z * step) * settings.frequency);
+
+				// OpenSimplex2's default 3D rotation, done in FastNoiseLite's TransformNoiseCoordinate
+				const float R3 = static_cast<float>(2.0 / 3.0);
+				VFloat r = (sampleX + sampleY + sampleZ) * splat(R3);
+				sampleX = r - sampleX;
+				sampleY = r - sampleY;
+				sampleZ = r - sampleZ;
+
+				store(samples, fractal<Noise, Fractal>(settings, sampleX, sampleY, sampleZ));
+				std::copy(samples, samples + count, out + (x * sizeZ + z) * sizeY + y);
+			}
+		}
+	}
+}
+
+using PlaneKernel = void (*)(const KernelSettings&, GLint, GLint, GLint, GLint, GLint, GLfloat*);
+using BlockKernel = void (*)(const KernelSettings&, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLfloat*);
+
+template <FastNoiseLite::NoiseType Noise>
+PlaneKernel getPlaneKernel(FastNoiseLite::FractalType fractalType)
+{
+	switch (fractalType) {
+	case FastNoiseLite::FractalType_FBm:
+		return fillPlaneKernel<Noise, FastNoiseLite::FractalType_FBm>;
+	case FastNoiseLite::FractalType_Ridged:
+		return fillPlaneKernel<Noise, FastNoiseLite::FractalType_Ridged>;
+	default:
+		return fillPlaneKernel<Noise, FastNoiseLite::FractalType_None>;
+	}
+}
+
+BlockKernel getBlockKernel(FastNoiseLite::FractalType fractalType)
+{
+	switch (fractalType) {
+	case FastNoiseLite::FractalType_FBm:
+		return fillBlockKernel<FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_FBm>;
+	case FastNoiseLite::FractalType_Ridged:
+		return fillBlockKernel<FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_Ridged>;
+	default:
+		return fillBlockKernel<FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_None>;
+	}
+}
+
+}
+
+#endif
+
+void BatchNoise::SetSeed(int seed)
+{
+	this->seed = seed;
+	FastNoiseLite::SetSeed(seed);
+}
+
+void BatchNoise::SetFrequency(float frequency)
+{
+	this->frequency = frequency;
+	FastNoiseLite::SetFrequency(frequency);
+}
+
+void BatchNoise::SetNoiseType(NoiseType noiseType)
+{
+	this->noiseType = noiseType;
+	FastNoiseLite::SetNoiseType(noiseType);
+}
+
+void BatchNoise::SetRotationType3D(RotationType3D rotationType3D)
+{
+	this->rotationType3D = rotationType3D;
+	FastNoiseLite::SetRotationType3D(rotationType3D);
+}
+
+void BatchNoise::SetFractalType(FractalType fractalType)
+{
+	this->fractalType = fractalType;
+	FastNoiseLite::SetFractalType(fractalType);
+}
+
+void BatchNoise::SetFractalOctaves(int octaves)
+{
+	this->octaves = octaves;
+	calculateFractalBounding();
+	FastNoiseLite::SetFractalOctaves(octaves);
+}
+
+void BatchNoise::SetFractalLacunarity(float lacunarity)
+{
+	this->lacunarity = lacunarity;
+	FastNoiseLite::SetFractalLacunarity(lacunarity);
+}
+
+void BatchNoise::SetFractalGain(float gain)
+{
+	this->gain = gain;
+	calculateFractalBounding();
+	FastNoiseLite::SetFractalGain(gain);
+}
+
+void BatchNoise::SetFractalWeightedStrength(float weightedStrength)
+{
+	this->weightedStrength = weightedStrength;
+	FastNoiseLite::SetFractalWeightedStrength(weightedStrength);
+}
+
+void BatchNoise::calculateFractalBounding()
+{
+	float absGain = gain < 0 ? -gain : gain;
+	float amp = absGain;
+	float ampFractal = 1.0f;
+	for (GLint i = 1; i < octaves; i++) {
+		ampFractal += amp;
+		amp *= absGain;
+	}
+	fractalBounding = 1 / ampFractal;
+}
+
+bool BatchNoise::hasBatchKernel(bool is3D) const
+{
+#if defined(BATCH_NOISE_SIMD)
+	if (weightedStrength != 0.0f) return false;
+	if (fractalType != FractalType_None && fractalType != FractalType_FBm && fractalType != FractalType_Ridged) return false;
+	if (is3D) return noiseType == NoiseType_OpenSimplex2 && rotationType3D == RotationType3D_None;
+	return noiseType == NoiseType_Perlin || noiseType == NoiseType_OpenSimplex2;
+#else
+	(void)is3D;
+	return false;
+#endif
+}
+
+void BatchNoise::fillPlane(GLint originX, GLint originZ, GLint sizeX, GLint sizeZ, GLint step, GLfloat* out) const
+{
+	if (!hasBatchKernel(false)) {
+		for (GLint x = 0; x < sizeX; ++x) {
+			for (GLint z = 0; z < sizeZ; ++z) {
+				out[x * sizeZ + z] = GetNoise(static_cast<GLfloat>(originX + x * step), static_cast<GLfloat>(originZ + z * step));
+			}
+		}
+		return;
+	}
+
+#if defined(BATCH_NOISE_SIMD)
+	KernelSettings settings = { seed, frequency, octaves, lacunarity, gain, fractalBounding };
+	PlaneKernel kernel = noiseType == NoiseType_Perlin ? getPlaneKernel<NoiseType_Perlin>(fractalType) : getPlaneKernel<NoiseType_OpenSimplex2>(fractalType);
+	kernel(settings, originX, originZ, sizeX, sizeZ, step, out);
+#endif
+}
+
+void BatchNoise::fillBlock(GLint originX, GLint originY, GLint originZ, GLint sizeX, GLint sizeY, GLint sizeZ, GLint step, GLfloat* out) const
+{
+	if (!hasBatchKernel(true)) {
+		for (GLint x = 0; x < sizeX; ++x) {
+			for (GLint z = 0; z < sizeZ; ++z) {
+				for (GLint y = 0; y < sizeY; ++y) {
+					out[(x * sizeZ + z) * sizeY + y] = GetNoise(static_cast<GLfloat>(originX + x * step), static_cast<GLfloat>(originY + y * step), static_cast<GLfloat>(originZ + z * step));
+				}
+			}
+		}
+		return;
+	}
+
+#if defined(BATCH_NOISE_SIMD)
+	KernelSettings settings = { seed, frequency, octaves, lacunarity, gain, fractalBounding };
+	getBlockKernel(fractalType)(settings, originX, originY, originZ, sizeX, sizeY, sizeZ, step, out);
+#endif
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "FastNoiseLite.h"
+#include <glad/glad.h>
+
+// FastNoiseLite that can also fill a whole plane or block of samples in one call. The setters shadow
+// FastNoiseLite's so the batch kernels see the same configuration, GetNoise and the rest are inherited.
+// Perlin and OpenSimplex2 with no, FBm or Ridged fractal run on SSE2/AVX2 kernels, anything else falls
+// back to GetNoise per sample
+class BatchNoise : public FastNoiseLite
+{
+public:
+	explicit BatchNoise(int seed = 1337) : FastNoiseLite(seed), seed(seed) {}
+
+	void SetSeed(int seed);
+	void SetFrequency(float frequency);
+	void SetNoiseType(NoiseType noiseType);
+	void SetRotationType3D(RotationType3D rotationType3D);
+	void SetFractalType(FractalType fractalType);
+	void SetFractalOctaves(int octaves);
+	void SetFractalLacunarity(float lacunarity);
+	void SetFractalGain(float gain);
+	void SetFractalWeightedStrength(float weightedStrength);
+
+	// sizeX * sizeZ samples spaced step blocks apart from (originX, originZ), out is indexed [x * sizeZ + z]
+	void fillPlane(GLint originX, GLint originZ, GLint sizeX, GLint sizeZ, GLint step, GLfloat* out) const;
+	// sizeX * sizeY * sizeZ samples spaced step blocks apart, out is indexed [(x * sizeZ + z) * sizeY + y]
+	void fillBlock(GLint originX, GLint originY, GLint originZ, GLint sizeX, GLint sizeY, GLint sizeZ, GLint step, GLfloat* out) const;
+
+private:
+	void calculateFractalBounding();
+	// False when some setting has no batch kernel and the samples have to go through GetNoise
+	bool hasBatchKernel(bool is3D) const;
+
+	// Copies of FastNoiseLite's private settings, kept in step by the setters above
+	int seed;
+	float frequency = 0.01f;
+	NoiseType noiseType = NoiseType_OpenSimplex2;
+	RotationType3D rotationType3D = RotationType3D_None;
+	FractalType fractalType = FractalType_None;
+	int octaves = 3;
+	float lacunarity = 2.0f;
+	float gain = 0.5f;
+	float weightedStrength = 0.0f;
+	float fractalBounding = 1 / 1.75f;
+};
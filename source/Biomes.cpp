@@ -104,31 +104,56 @@ void Biomes::initializeNoise() {
 }
 
 GLint Biomes::getTerrainHeightAt(GLint x, GLint z) const {
+    GLfloat base = baseNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
+    GLfloat ridge = 0.0f, cliff = 0.0f;
+
+    if (biomeTypes == BiomeTypes::Mountain) {
+        ridge = ridgeNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
+    }
+    if (biomeTypes == BiomeTypes::Desert || biomeTypes == BiomeTypes::Mountain) {
+        cliff = cliffNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
+    }
+    return combineHeightNoise(base, ridge, cliff);
+}
+
+void Biomes::getTerrainHeights(GLint originX, GLint originZ, GLint sizeX, GLint sizeZ, GLint* heights) const {
+    GLint count = sizeX * sizeZ;
+    std::vector<GLfloat> base(count), ridge(count, 0.0f), cliff(count, 0.0f);
+
+    baseNoise.fillPlane(originX, originZ, sizeX, sizeZ, 1, base.data());
+    if (biomeTypes == BiomeTypes::Mountain) {
+        ridgeNoise.fillPlane(originX, originZ, sizeX, sizeZ, 1, ridge.data());
+    }
+    if (biomeTypes == BiomeTypes::Desert || biomeTypes == BiomeTypes::Mountain) {
+        cliffNoise.fillPlane(originX, originZ, sizeX, sizeZ, 1, cliff.data());
+    }
+
+    for (GLint i = 0; i < count; ++i) {
+        heights[i] = combineHeightNoise(base[i], ridge[i], cliff[i]);
+    }
+}
+
+GLint Biomes::combineHeightNoise(GLfloat base, GLfloat ridge, GLfloat cliff) const {
     GLfloat height = 0.0f;
 
     switch (biomeTypes) {
     case BiomeTypes::Forest:
-        height = baseNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
+        height = base;
         break;
 
-    case BiomeTypes::Desert: {
-            height = baseNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z)) * 0.5f;
-            GLfloat cliffValue = cliffNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
+    case BiomeTypes::Desert:
+        height = base * 0.5f;
+        height += fabs(cliff) * cliffAmplitude;
+        break;
 
-            height += fabs(cliffValue) * cliffAmplitude;
-            break;
-        }
     case BiomeTypes::Plains:
-        height = baseNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z)) * 0.6f;
+        height = base * 0.6f;
         break;
 
-    case BiomeTypes::Mountain: {
-            height = baseNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
-            GLfloat ridge = ridgeNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
-            GLfloat cliffValue = cliffNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
-            height += ridge + fabs(cliffValue) * cliffAmplitude;
-            break;
-        }
+    case BiomeTypes::Mountain:
+        height = base;
+        height += ridge + fabs(cliff) * cliffAmplitude;
+        break;
     }
 
     return static_cast<GLint>((height + 1.0f) * 0.5f * 128);
@@ -183,9 +208,9 @@ bool Biomes::shouldPlaceDeadBush(int x, int z) const {
     return false;
 }
 
-GLint Biomes::getRandomGrassType() const {
+GLint Biomes::getRandomGrassType(WorldRandom& random) const {
     if (biomeTypes == BiomeTypes::Forest || biomeTypes == BiomeTypes::Plains) {
-        GLfloat randomValue = static_cast<GLfloat>(rand()) / RAND_MAX;
+        GLfloat randomValue = random.nextFloat();
         if      (randomValue < 0.33f)   return GRASS1;
         else if (randomValue < 0.67f)   return GRASS2;
         else                            return GRASS3;
@@ -193,9 +218,9 @@ GLint Biomes::getRandomGrassType() const {
     return -1;
 }
 
-GLint Biomes::getRandomFlowerType() const {
+GLint Biomes::getRandomFlowerType(WorldRandom& random) const {
     if (biomeTypes == BiomeTypes::Forest || biomeTypes == BiomeTypes::Plains) {
-        GLint flowerType = rand() % 5;
+        GLint flowerType = random.nextInt(5);
         switch (flowerType) {
         case 0: return FLOWER1;
         case 1: return FLOWER2;
@@ -1,16 +1,20 @@
 #pragma once
 
-#include "FastNoiseLite.h"
+#include "BatchNoise.h"
+#include "WorldRandom.h"
 #include "BiomeTypes.h"
 #include "BlockTypes.h"
 #include <glad/glad.h>
 #include <cstdlib>
+#include <vector>
 
 class Biomes {
 public:
     explicit Biomes(BiomeTypes type);
 
     GLint getTerrainHeightAt(GLint x, GLint z) const;
+    // Same heights for sizeX * sizeZ columns from (originX, originZ) in one pass, indexed [x * sizeZ + z]
+    void getTerrainHeights(GLint originX, GLint originZ, GLint sizeX, GLint sizeZ, GLint* heights) const;
     bool isCave(GLint x, GLint y, GLint z) const;
 
     bool shouldPlaceTree(GLint x, GLint z) const;
@@ -18,8 +22,8 @@ public:
     bool shouldPlaceFlower(GLint x, GLint z) const;
     bool shouldPlaceDeadBush(int x, int z) const;
 
-    GLint getRandomGrassType() const;
-    GLint getRandomFlowerType() const;
+    GLint getRandomGrassType(WorldRandom& random) const;
+    GLint getRandomFlowerType(WorldRandom& random) const;
 
     GLint getSurfaceBlock(GLint y) const;
     GLint getSubSurfaceBlock() const;
@@ -27,10 +31,11 @@ public:
 
 private:
     void initializeNoise();
+    GLint combineHeightNoise(GLfloat base, GLfloat ridge, GLfloat cliff) const;
 
     BiomeTypes biomeTypes;
 
-    FastNoiseLite baseNoise, elevationNoise, caveNoise, ridgeNoise, detailNoise, mountainNoise, treeNoise, grassNoise, flowerNoise, cliffNoise;
+    BatchNoise baseNoise, elevationNoise, caveNoise, ridgeNoise, detailNoise, mountainNoise, treeNoise, grassNoise, flowerNoise, cliffNoise;
 
     GLfloat cliffAmplitude;
 };
\ No newline at end of file
@@ -1,19 +1,30 @@
 #include "Block.h"
 
-void Block::addBackFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4])
+PackedVertex Block::packVertex(GLfloat x, GLfloat y, GLfloat z, GLfloat u, GLfloat v, uint8_t face, uint8_t textureLayer, uint8_t lightLevel, uint8_t ao)
 {
-	GLfloat topX = x + extentX, topY = y + extentY, texX = 1.0f * extentX, texY = 1.0f * extentY;
+	GLuint packedX = static_cast<GLuint>(std::lround((x + 1.0f) * 16.0f)) & 0x1FF;
+	GLuint packedY = static_cast<GLuint>(std::lround(y * 16.0f)) & 0xFFF;
+	GLuint packedZ = static_cast<GLuint>(std::lround((z + 1.0f) * 16.0f)) & 0x1FF;
+
+	PackedVertex vertex;
+	vertex.position = packedX | (packedY << 9) | (packedZ << 21) | (static_cast<GLuint>(ao & 0x3) << 30);
+	vertex.attributes = (face & 0x7) | ((lightLevel & 0xF) << 3) | (static_cast<GLuint>(textureLayer) << 7) |
+		((static_cast<GLuint>(u) & 0x1F) << 15) | ((static_cast<GLuint>(v) & 0xFF) << 20);
+	return vertex;
+}
 
-	GLfloat nx = 0.0f, ny = 0.0f, nz = -1.0f;
+void Block::addBackFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4])
+{
+	GLfloat topX = x + extentX, topY = y + extentY, texX = 1.0f * extentX, texY = 1.0f * extentY;
 
-	GLfloat normalizedLightLevel = lightLevel / 15.0f;
+	uint8_t face = 0;
 
-	std::array<GLfloat, 44> faceVertices = 
+	std::array<PackedVertex, 4> faceVertices = 
 	{
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y),	static_cast<GLfloat>(z),	0.0f,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[0],
-		topX,						static_cast<GLfloat>(y),	static_cast<GLfloat>(z),	texX,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[1],
-		topX,						topY,						static_cast<GLfloat>(z),	texX,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[2],
-		static_cast<GLfloat>(x),	topY,						static_cast<GLfloat>(z),	0.0f,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[3]
+		packVertex(x,		y,		z,	0.0f,	0.0f,	face, textureLayer, lightLevel, ao[0]),
+		packVertex(topX,	y,		z,	texX,	0.0f,	face, textureLayer, lightLevel, ao[1]),
+		packVertex(topX,	topY,	z,	texX,	texY,	face, textureLayer, lightLevel, ao[2]),
+		packVertex(x,		topY,	z,	0.0f,	texY,	face, textureLayer, lightLevel, ao[3])
 	};
 
 	vertices.insert(vertices.end(), faceVertices.begin(), faceVertices.end());
@@ -29,19 +40,17 @@ void Block::addBackFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& ind
 	vertexOffset += 4;
 }
 
-void Block::addFrontFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4])
+void Block::addFrontFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4])
 {
 	GLfloat topX = x + extentX, topY = y + extentY, texX = 1.0f * extentX, texY = 1.0f * extentY;
 
-	GLfloat nx = 0.0f, ny = 0.0f, nz = 1.0f;
-
-	GLfloat normalizedLightLevel = lightLevel / 15.0f;
+	uint8_t face = 1;
 
-	std::array<GLfloat, 44> faceVertices = {
-		static_cast<GLfloat>(x),	topY,						static_cast<GLfloat>(z + 1),	0.0f,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[0],
-		topX,						topY,						static_cast<GLfloat>(z + 1),	texX,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[1],
-		topX,						static_cast<GLfloat>(y),	static_cast<GLfloat>(z + 1),	texX,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[2],
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y),	static_cast<GLfloat>(z + 1),	0.0f,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[3]
+	std::array<PackedVertex, 4> faceVertices = {
+		packVertex(x,		topY,	z + 1,	0.0f,	texY,	face, textureLayer, lightLevel, ao[0]),
+		packVertex(topX,	topY,	z + 1,	texX,	texY,	face, textureLayer, lightLevel, ao[1]),
+		packVertex(topX,	y,		z + 1,	texX,	0.0f,	face, textureLayer, lightLevel, ao[2]),
+		packVertex(x,		y,		z + 1,	0.0f,	0.0f,	face, textureLayer, lightLevel, ao[3])
 	};
 
 	vertices.insert(vertices.end(), faceVertices.begin(), faceVertices.end());
@@ -57,20 +66,18 @@ void Block::addFrontFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& in
 	vertexOffset += 4;
 }
 
-void Block::addTopFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4])
+void Block::addTopFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4])
 {
 	GLfloat topX = x + extentX, topZ = z + extentY, texX = 1.0f * extentX, texY = 1.0f * extentY;
 
-	GLfloat nx = 0.0f, ny = 1.0f, nz = 0.0f;
+	uint8_t face = 4;
 
-	GLfloat normalizedLightLevel = lightLevel / 15.0f;
-
-	std::array<GLfloat, 44> faceVertices = 
+	std::array<PackedVertex, 4> faceVertices = 
 	{
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y + 1), static_cast<GLfloat>(z),	0.0f,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[0],
-		topX,						static_cast<GLfloat>(y + 1), static_cast<GLfloat>(z),	texX,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[1],
-		topX,						static_cast<GLfloat>(y + 1), topZ,						texX,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[2],
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y + 1), topZ,						0.0f,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[3]
+		packVertex(x,		y + 1, z,		0.0f,	0.0f,	face, textureLayer, lightLevel, ao[0]),
+		packVertex(topX,	y + 1, z,		texX,	0.0f,	face, textureLayer, lightLevel, ao[1]),
+		packVertex(topX,	y + 1, topZ,	texX,	texY,	face, textureLayer, lightLevel, ao[2]),
+		packVertex(x,		y + 1, topZ,	0.0f,	texY,	face, textureLayer, lightLevel, ao[3])
 	};
 
 	vertices.insert(vertices.end(), faceVertices.begin(), faceVertices.end());
@@ -87,20 +94,18 @@ void Block::addTopFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indi
 
 }
 
-void Block::addBottomFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4])
+void Block::addBottomFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4])
 {
 	GLfloat topX = x + extentX, topZ = z + extentY, texX = 1.0f * extentX, texY = 1.0f * extentY;
 
-	GLfloat nx = 0.0f, ny = -1.0f, nz = 0.0f;
-
-	GLfloat normalizedLightLevel = lightLevel / 15.0f;
+	uint8_t face = 5;
 
-	std::array<GLfloat, 44> faceVertices = 
+	std::array<PackedVertex, 4> faceVertices = 
 	{
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y),	topZ,						0.0f,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[0],
-		topX,						static_cast<GLfloat>(y),	topZ,						texX,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[1],
-		topX,						static_cast<GLfloat>(y),	static_cast<GLfloat>(z),	texX,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[2],
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y),	static_cast<GLfloat>(z),	0.0f,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[3]
+		packVertex(x,		y,	topZ,	0.0f,	texY,	face, textureLayer, lightLevel, ao[0]),
+		packVertex(topX,	y,	topZ,	texX,	texY,	face, textureLayer, lightLevel, ao[1]),
+		packVertex(topX,	y,	z,		texX,	0.0f,	face, textureLayer, lightLevel, ao[2]),
+		packVertex(x,		y,	z,		0.0f,	0.0f,	face, textureLayer, lightLevel, ao[3])
 	};
 
 	vertices.insert(vertices.end(), faceVertices.begin(), faceVertices.end());
@@ -117,20 +122,18 @@ void Block::addBottomFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& i
 
 }
 
-void Block::addLeftFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4])
+void Block::addLeftFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4])
 {
 	GLfloat topZ = z + extentZ, topY = y + extentY, texZ = 1.0f * extentZ, texY = 1.0f * extentY;
 
-	GLfloat nx = -1.0f, ny = 0.0f, nz = 0.0f;
+	uint8_t face = 2;
 
-	GLfloat normalizedLightLevel = lightLevel / 15.0f;
-
-	std::array<GLfloat, 44> faceVertices = 
+	std::array<PackedVertex, 4> faceVertices = 
 	{
-		static_cast<GLfloat>(x),	topY,						topZ,						texZ,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[0],
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y),	topZ,						texZ,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[1],
-		static_cast<GLfloat>(x),	static_cast<GLfloat>(y),	static_cast<GLfloat>(z),	0.0f,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[2],
-		static_cast<GLfloat>(x),	topY,						static_cast<GLfloat>(z),	0.0f,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[3]
+		packVertex(x,	topY,	topZ,	texZ,	texY,	face, textureLayer, lightLevel, ao[0]),
+		packVertex(x,	y,		topZ,	texZ,	0.0f,	face, textureLayer, lightLevel, ao[1]),
+		packVertex(x,	y,		z,		0.0f,	0.0f,	face, textureLayer, lightLevel, ao[2]),
+		packVertex(x,	topY,	z,		0.0f,	texY,	face, textureLayer, lightLevel, ao[3])
 	};
 
 	vertices.insert(vertices.end(), faceVertices.begin(), faceVertices.end());
@@ -147,20 +150,18 @@ void Block::addLeftFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& ind
 
 }
 
-void Block::addRightFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4])
+void Block::addRightFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4])
 {
 	GLfloat topZ = z + extentZ, topY = y + extentY, texZ = 1.0f * extentZ, texY = 1.0f * extentY;
 
-	GLfloat nx = 1.0f, ny = 0.0f, nz = 0.0f;
-
-	GLfloat normalizedLightLevel = lightLevel / 15.0f;
+	uint8_t face = 3;
 
-	std::array<GLfloat, 44> faceVertices = 
+	std::array<PackedVertex, 4> faceVertices = 
 	{
-		static_cast<GLfloat>(x + 1),	static_cast<GLfloat>(y),	topZ,						texZ,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[0],
-		static_cast<GLfloat>(x + 1),	topY,						topZ,						texZ,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[1],
-		static_cast<GLfloat>(x + 1),	topY,						static_cast<GLfloat>(z),	0.0f,	texY,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[2],
-		static_cast<GLfloat>(x + 1),	static_cast<GLfloat>(y),	static_cast<GLfloat>(z),	0.0f,	0.0f,	static_cast<GLfloat>(textureLayer), nx, ny, nz, normalizedLightLevel, ao[3]
+		packVertex(x + 1,	y,		topZ,	texZ,	0.0f,	face, textureLayer, lightLevel, ao[0]),
+		packVertex(x + 1,	topY,	topZ,	texZ,	texY,	face, textureLayer, lightLevel, ao[1]),
+		packVertex(x + 1,	topY,	z,		0.0f,	texY,	face, textureLayer, lightLevel, ao[2]),
+		packVertex(x + 1,	y,		z,		0.0f,	0.0f,	face, textureLayer, lightLevel, ao[3])
 	};
 
 	vertices.insert(vertices.end(), faceVertices.begin(), faceVertices.end());
@@ -7,15 +7,23 @@
 #include <vector>
 #include <array>
 
+// Chunk mesh vertex packed into 8 bytes, decoded by main.vs, water.vs and meshing.vs
+struct PackedVertex {
+	GLuint position;	// x:9 y:12 z:9 in 1/16 block units relative to the chunk origin (x and z biased by one block), ao:2
+	GLuint attributes;	// face:3 light:4 textureLayer:8 u:5 v:8
+};
+
 class Block
 {
 public:
-	static void addFrontFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4]);
-	static void addBackFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4]);
-	static void addTopFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4]);
-	static void addBottomFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4]);
-	static void addLeftFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4]);
-	static void addRightFace(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const GLfloat ao[4]);
+	static PackedVertex packVertex(GLfloat x, GLfloat y, GLfloat z, GLfloat u, GLfloat v, uint8_t face, uint8_t textureLayer, uint8_t lightLevel, uint8_t ao);
+
+	static void addFrontFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4]);
+	static void addBackFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4]);
+	static void addTopFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4]);
+	static void addBottomFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentX, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4]);
+	static void addLeftFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4]);
+	static void addRightFace(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, int16_t x, int16_t y, int16_t z, uint8_t extentZ, uint8_t extentY, uint8_t textureLayer, uint8_t lightLevel, const uint8_t ao[4]);
 
 private:
 	GLfloat x, y, z;
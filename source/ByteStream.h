@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+
+// Appends plain values to a byte buffer in the machine's byte order. Every platform the game builds
+// for is little endian, so saved data moves between them unchanged
+class ByteWriter
+{
+public:
+	explicit ByteWriter(std::vector<uint8_t>& out) : out(out) {}
+
+	template<typename T>
+	void write(T value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		writeBytes(&value, sizeof(T));
+	}
+
+	void writeBytes(const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		out.insert(out.end(), bytes, bytes + size);
+	}
+
+private:
+	std::vector<uint8_t>& out;
+};
+
+// Reads what ByteWriter wrote. Reading past the end yields zeros and clears isValid, so a parser
+// can read everything first and check once at the end whether the data was complete
+class ByteReader
+{
+public:
+	ByteReader(const uint8_t* data, size_t size) : data(data), end(data + size) {}
+
+	template<typename T>
+	T read()
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		T value{};
+		readBytes(&value, sizeof(T));
+		return value;
+	}
+
+	void readBytes(void* out, size_t size)
+	{
+		if (static_cast<size_t>(end - data) < size) {
+			valid = false;
+			data = end;
+			std::memset(out, 0, size);
+			return;
+		}
+		std::memcpy(out, data, size);
+		data += size;
+	}
+
+	bool isValid() const { return valid; }
+	bool isAtEnd() const { return data == end; }
+
+private:
+	const uint8_t* data;
+	const uint8_t* end;
+	bool valid = true;
+};
@@ -1,161 +1,167 @@
 #include "Chunk.h"
 #include "World.h"
+#include "LightEngine.h"
+#include "ByteStream.h"
+#include <iostream>
 
-Chunk::Chunk(GLint x, GLint z, TextureManager& textureManager, World* world)
-    : chunkX(x), chunkZ(z), textureManager(textureManager), textureID(textureManager.getTextureID()), world(world), 
-      forestBiome(BiomeTypes::Forest), desertBiome(BiomeTypes::Desert), plainsBiome(BiomeTypes::Plains), mountainBiome(BiomeTypes::Mountain)
+Chunk::Chunk(GLint x, GLint z, TextureManager& textureManager, World* world, const std::vector<uint8_t>* savedData)
+    : chunkX(x), chunkZ(z), textureManager(textureManager), textureID(textureManager.getTextureID()), world(world), stateCounts(world->getChunkStateCounts())
 {
+    stateCounts.add(ChunkState::Generating);
     minBounds = glm::vec3(chunkX * CHUNK_SIZE, 0, chunkZ * CHUNK_SIZE);
     maxBounds = glm::vec3((chunkX + 1) * CHUNK_SIZE, CHUNK_HEIGHT, (chunkZ + 1) * CHUNK_SIZE);
 
-    determineBiomeType(x, z);
-    setupChunk();
+    bool wasDecorated = false;
+    if (savedData && restore(*savedData, wasDecorated)) {
+        // A decorated chunk already holds its structures, it skips decoration and only needs its light.
+        // One saved with just its terrain goes through decoration like a generated one
+        if (wasDecorated) {
+            calculateLight();
+            markSectionsDirty(ALL_SECTIONS);
+            advanceState(ChunkState::Generating, ChunkState::Decorated);
+        }
+    }
+    else {
+        setupChunk();
+    }
     calculateBounds();
+    if (getState() == ChunkState::Generating) {
+        advanceState(ChunkState::Generating, ChunkState::Generated);
+    }
 }
 
 Chunk::~Chunk()
 {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-
-    glDeleteVertexArrays(1, &waterVAO);
-    glDeleteBuffers(1, &waterVBO);
-    glDeleteBuffers(1, &waterEBO);
+    stateCounts.remove(getState());
+    for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+        deleteSectionBuffers(sectionBuffers[section]);
+        deleteSectionBuffers(waterSectionBuffers[section]);
+    }
 }
 
 void Chunk::setupChunk()
 {
+    // Only the terrain stage runs here, structures and light follow in decorate once the neighbours exist
     generateChunk();
-    generateMesh(blockTypes);
 }
 
-Biomes Chunk::determineBiomeType(GLint x, GLint z)
+void Chunk::buildBackMesh(uint8_t sectionMask)
 {
-    biomeNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-    biomeNoise.SetFrequency(0.0003f);
-
-    caveNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-    caveNoise.SetFractalOctaves(5);
-    caveNoise.SetFrequency(0.016f);
-
-    GLfloat noiseValue = biomeNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
-
-    if (noiseValue < -0.3f)
-    {
-        return Biomes(BiomeTypes::Desert);
-    }
-    else if (noiseValue < 0.3f)
-    {
-        return Biomes(BiomeTypes::Plains);
-    }
-    else
-    {
-        return Biomes(BiomeTypes::Forest);
+    ChunkSnapshot snapshot = captureSnapshot();
+    for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+        if (!(sectionMask & (1u << section))) continue;
+        // Nobody will see the mesh of a chunk that started unloading
+        if (isUnloading()) return;
+
+        ChunkMesh& mesh = meshBuffers[section][((frontMeshMask >> section) & 1) ^ 1];
+        if (snapshot.hasNoVisibleFaces(section)) {
+            mesh.vertices.clear();
+            mesh.indices.clear();
+            mesh.waterVertices.clear();
+            mesh.waterIndices.clear();
+            continue;
+        }
+        generateMesh(snapshot, mesh, section);
     }
+    backMeshSections = sectionMask;
+    advanceState(ChunkState::Meshing, ChunkState::MeshReady);
 }
 
-const BiomeData* Chunk::selectBiome(GLfloat noiseValue) {
-    for (const auto& biome : biomes) {
-        if (noiseValue >= biome.minThreshold && noiseValue < biome.maxThreshold) {
-            return &biome;
-        }
-    }
-    return nullptr;
+bool Chunk::publishBackMesh()
+{
+    if (getState() != ChunkState::MeshReady) return false;
+
+    frontMeshMask ^= backMeshSections;
+    unuploadedSections |= backMeshSections;
+    unuploadedWaterSections |= backMeshSections;
+    return advanceState(ChunkState::MeshReady, ChunkState::Uploaded);
 }
 
-const Biomes* Chunk::getBiomeInstance(BiomeTypes type) const {
-    switch (type) {
-    case BiomeTypes::Forest:
-        return &forestBiome;
-    case BiomeTypes::Desert:
-        return &desertBiome;
-    case BiomeTypes::Plains:
-        return &plainsBiome;
-    
-    default:
-        return nullptr;
+bool Chunk::advanceState(ChunkState from, ChunkState to)
+{
+    if (!isValidChunkStateTransition(from, to)) {
+        std::cerr << "Chunk " << getChunkX() << ", " << getChunkZ() << " can't go from " << getChunkStateName(from) << " to " << getChunkStateName(to) << std::endl;
+        return false;
     }
+    if (!state.compare_exchange_strong(from, to, std::memory_order_acq_rel)) return false;
+
+    stateCounts.move(from, to);
+    return true;
 }
 
-GLfloat Chunk::smoothstep(GLfloat edge0, GLfloat edge1, GLfloat x) {
-    x = (x - edge0) / (edge1 - edge0);
-    x = std::clamp(x, 0.0f, 1.0f);
-    return x * x * (3 - 2 * x);
+void Chunk::beginUnloading()
+{
+    ChunkState previous = state.exchange(ChunkState::Unloading, std::memory_order_acq_rel);
+    stateBeforeUnloading = previous;
+    stateCounts.move(previous, ChunkState::Unloading);
 }
 
 void Chunk::generateChunk()
 {
-    blockTypes.resize(CHUNK_SIZE * CHUNK_HEIGHT * CHUNK_SIZE, -1);
+    // Built in a flat array first, the terrain loops write almost every block and look at their neighbours
+    std::vector<int8_t> blockTypes(CHUNK_SIZE * CHUNK_HEIGHT * CHUNK_SIZE, -1);
+    const TerrainGenerator& terrain = world->getTerrainGenerator();
+    std::shared_ptr<const TerrainRegion> terrainRegion = world->getTerrainColumnCache().getRegion(static_cast<int16_t>(chunkX), static_cast<int16_t>(chunkZ));
+    const Biomes& forestBiome = terrain.getBiome(BiomeTypes::Forest);
+    const Biomes& plainsBiome = terrain.getBiome(BiomeTypes::Plains);
 
     constexpr uint8_t caveMinHeight = CHUNK_HEIGHT / 64;
     constexpr uint8_t surfaceBuffer = CHUNK_HEIGHT / 9;
 
+    // Caves only matter inside the solid band below the terrain, so the cave noise is sampled there on a
+    // lattice every caveStep blocks and trilinearly interpolated in between. The lattice is aligned to
+    // world coordinates, neighbouring chunks share their border samples and caves line up across chunks
+    constexpr uint8_t caveStep = 2;
+    constexpr uint8_t caveSamplesXZ = CHUNK_SIZE / caveStep + 1;
+    GLint caveTop = 0;
+    for (const TerrainColumn& column : terrainRegion->columns) {
+        caveTop = std::max(caveTop, std::min<GLint>(column.height, CHUNK_HEIGHT - surfaceBuffer - 1));
+    }
+    GLint caveSamplesY = caveTop / caveStep + 2;
+
+    std::vector<GLfloat> caveLattice(caveSamplesXZ * caveSamplesXZ * caveSamplesY);
+    terrain.fillCaveNoise(static_cast<GLint>(chunkX) * CHUNK_SIZE, 0, static_cast<GLint>(chunkZ) * CHUNK_SIZE,
+        caveSamplesXZ, caveSamplesY, caveSamplesXZ, caveStep, caveLattice.data());
+
     for (uint8_t x = 0; x < CHUNK_SIZE; ++x)
     {
         for (uint8_t z = 0; z < CHUNK_SIZE; ++z)
         {
-            GLfloat globalX = static_cast<GLfloat>(chunkX * CHUNK_SIZE + x);
-            GLfloat globalZ = static_cast<GLfloat>(chunkZ * CHUNK_SIZE + z);
-
-            GLfloat biomeNoiseValue = biomeNoise.GetNoise(static_cast<GLfloat>(globalX), static_cast<GLfloat>(globalZ));
-            GLfloat biomeValue = (biomeNoiseValue + 1.0f) / 2.0f;
-
-            std::vector<GLfloat> biomeWeights(biomes.size(), 0.0f);
-
-            for (size_t i = 0; i < biomes.size(); ++i) {
-                const BiomeData& biome = biomes[i];
-                GLfloat weight = 0.0f;
-
-                if (biome.type == BiomeTypes::Desert) {
-                    weight = 1.0f - smoothstep(biome.edge0, biome.edge1, biomeValue);
-                }
-                else if (biome.type == BiomeTypes::Plains) {
-                    weight = smoothstep(biome.edge0, biome.edge1, biomeValue) * (1.0f - smoothstep(biome.edge2, biome.edge3, biomeValue));
-                }
-                else if (biome.type == BiomeTypes::Forest) {
-                    weight = smoothstep(biome.edge0, biome.edge1, biomeValue);
-                }
-                else if (biome.type == BiomeTypes::Mountain) {
-                    weight = smoothstep(biome.edge0, biome.edge1, biomeValue) * (1.0f - smoothstep(biome.edge2, biome.edge3, biomeValue));
-                }
-                biomeWeights[i] = weight;
-            }
+            GLint globalX = static_cast<GLint>(chunkX) * CHUNK_SIZE + x;
+            GLint globalZ = static_cast<GLint>(chunkZ) * CHUNK_SIZE + z;
 
-            GLfloat totalWeight = std::accumulate(biomeWeights.begin(), biomeWeights.end(), 0.0f);
-            if (totalWeight > 0.0f) {
-                for (GLfloat& weight : biomeWeights) {
-                    weight /= totalWeight;
-                }
-            }
+            const TerrainColumn& column = terrainRegion->columns[x * CHUNK_SIZE + z];
+            const std::array<GLfloat, BIOME_COUNT>& biomeWeights = column.biomeWeights;
+            uint16_t terrainHeight = static_cast<uint16_t>(column.height);
+            const Biomes* biomeInstance = column.primaryBiome;
 
-            // Blend terrain heights
-            GLfloat blendedHeight = 0.0f;
-            for (size_t i = 0; i < biomes.size(); ++i) {
-                if (biomeWeights[i] > 0.0f) {
-                    const BiomeData& biome = biomes[i];
-                    Biomes* biomeInstance = biomeInstances[biome.type];
-                    GLfloat height = biomeInstance->getTerrainHeightAt(globalX, globalZ);
-                    blendedHeight += height * biomeWeights[i];
+            // Interpolate in x and z once per lattice level, each block then only lerps along y
+            std::array<GLfloat, CHUNK_HEIGHT / caveStep + 2> caveColumn;
+            {
+                GLint i = x / caveStep, k = z / caveStep;
+                GLfloat fx = static_cast<GLfloat>(x % caveStep) / caveStep;
+                GLfloat fz = static_cast<GLfloat>(z % caveStep) / caveStep;
+                const GLfloat* c00 = &caveLattice[(i * caveSamplesXZ + k) * caveSamplesY];
+                const GLfloat* c01 = c00 + caveSamplesY;
+                const GLfloat* c10 = c00 + caveSamplesXZ * caveSamplesY;
+                const GLfloat* c11 = c10 + caveSamplesY;
+                for (GLint j = 0; j < caveSamplesY; ++j) {
+                    GLfloat low = c00[j] + (c10[j] - c00[j]) * fx;
+                    GLfloat high = c01[j] + (c11[j] - c01[j]) * fx;
+                    caveColumn[j] = low + (high - low) * fz;
                 }
             }
-            uint16_t terrainHeight = static_cast<uint16_t>(blendedHeight);
-
-            size_t maxWeightBiomeIndex = std::distance(biomeWeights.begin(), std::max_element(biomeWeights.begin(), biomeWeights.end()));
-            const BiomeData& primaryBiome = biomes[maxWeightBiomeIndex];
-            Biomes* biomeInstance = biomeInstances[primaryBiome.type];
-
-            GLfloat biomeCaveThreshold = 0.0f;
-            for (size_t i = 0; i < biomes.size(); ++i) {
-                biomeCaveThreshold += biomeWeights[i] * biomes[i].caveThreshold;
-            }
 
             for (uint8_t y = 0; y < CHUNK_HEIGHT; ++y)
             {
                 uint16_t index = getIndex(x, y, z);
 
-                GLfloat caveValue = caveNoise.GetNoise(static_cast<GLfloat>(globalX), static_cast<GLfloat>(y), static_cast<GLfloat>(globalZ));
-                bool isCave = (caveValue > biomeCaveThreshold) && y > caveMinHeight && y < (CHUNK_HEIGHT - surfaceBuffer);
+                bool isCave = false;
+                if (y > caveMinHeight && y < (CHUNK_HEIGHT - surfaceBuffer) && y <= terrainHeight) {
+                    GLfloat fy = static_cast<GLfloat>(y % caveStep) / caveStep;
+                    GLfloat caveValue = caveColumn[y / caveStep] + (caveColumn[y / caveStep + 1] - caveColumn[y / caveStep]) * fy;
+                    isCave = caveValue > column.caveThreshold;
+                }
 
                 if (isCave)
                 {
@@ -193,14 +199,15 @@ void Chunk::generateChunk()
             if (world->isStructureGenerationEnabled) {
                 if (blockTypes[indexBelow] != -1 && blockTypes[indexAbove] == -1)
                 {
-                    GLfloat randomValue = static_cast<GLfloat>(rand()) / RAND_MAX;
+                    WorldRandom random(world->getSeed(), globalX, globalZ);
+                    GLfloat randomValue = random.nextFloat();
 
                     GLfloat weightThreshold = 0.0f;
-                    for (size_t i = 0; i < biomes.size(); ++i) {
+                    for (size_t i = 0; i < BIOME_COUNT; ++i) {
                         weightThreshold += biomeWeights[i];
                         if (randomValue <= weightThreshold) {
-                            const BiomeData& biome = biomes[i];
-                            Biomes* biomeInstance = biomeInstances[biome.type];
+                            const BiomeData& biome = terrain.getBiomes()[i];
+                            const Biomes* biomeInstance = &terrain.getBiome(biome.type);
 
                             // -- FOREST -- //
                             if (biome.type == BiomeTypes::Forest && blockTypes[indexBelow] == GRASS_BLOCK)
@@ -208,17 +215,17 @@ void Chunk::generateChunk()
 
                                 if (biomeInstance->shouldPlaceTree(globalX, globalZ))
                                 {
-                                    uint8_t randomTreeType = rand() % 3;
+                                    uint8_t randomTreeType = random.nextInt(3);
+                                    StructureAnchor::Type treeType = StructureAnchor::Type::YellowLeavesTree;
                                     if (randomTreeType == 0)
-                                        Structure::generateBaseProceduralTree(*this, x, terrainHeight + 1, z);
+                                        treeType = StructureAnchor::Type::ProceduralTree;
                                     else if (randomTreeType == 1)
-                                        Structure::generateProceduralTreeOrangeLeaves(*this, x, terrainHeight + 1, z);
-                                    else
-                                        Structure::generateProceduralTreeYellowLeaves(*this, x, terrainHeight + 1, z);
+                                        treeType = StructureAnchor::Type::OrangeLeavesTree;
+                                    structureAnchors.push_back({ treeType, globalX, terrainHeight + 1, globalZ, random });
                                 }
                                 else if (biomeInstance->shouldPlaceGrass(globalX, globalZ))
                                 {
-                                    uint8_t grassType = forestBiome.getRandomGrassType();
+                                    uint8_t grassType = forestBiome.getRandomGrassType(random);
                                     if (grassType != -1)
                                     {
                                         blockTypes[indexAbove] = grassType;
@@ -226,7 +233,7 @@ void Chunk::generateChunk()
                                 }
                                 else if (biomeInstance->shouldPlaceFlower(globalX, globalZ))
                                 {
-                                    uint8_t flowerType = forestBiome.getRandomFlowerType();
+                                    uint8_t flowerType = forestBiome.getRandomFlowerType(random);
                                     if (flowerType != -1)
                                     {
                                         blockTypes[indexAbove] = flowerType;
@@ -238,13 +245,13 @@ void Chunk::generateChunk()
                             {
                                 if (plainsBiome.shouldPlaceTree(globalX, globalZ))
                                 {
-                                    Structure::generateBasePurpleTree(*this, x, terrainHeight + 1, z);
+                                    structureAnchors.push_back({ StructureAnchor::Type::PurpleTree, globalX, terrainHeight + 1, globalZ, random });
                                 }
                                 else if (plainsBiome.shouldPlaceGrass(globalX, globalZ)) {
-                                    blockTypes[indexAbove] = plainsBiome.getRandomGrassType();
+                                    blockTypes[indexAbove] = plainsBiome.getRandomGrassType(random);
                                 }
                                 else if (plainsBiome.shouldPlaceFlower(globalX, globalZ)) {
-                                    blockTypes[indexAbove] = plainsBiome.getRandomFlowerType();
+                                    blockTypes[indexAbove] = plainsBiome.getRandomFlowerType(random);
                                 }
                             }
                             // -- DESERT -- //
@@ -264,110 +271,256 @@ void Chunk::generateChunk()
         }
     }
 
-    lightLevels.resize(blockTypes.size(), 0);
-
-    // Calculate light levels
-    for (uint8_t x = 0; x < CHUNK_SIZE; ++x)
-    {
-        for (uint8_t z = 0; z < CHUNK_SIZE; ++z)
-        {
-            recalculateSunlightColumn(x, z);
-        }
+    for (uint8_t section = 0; section < CHUNK_SECTIONS; ++section) {
+        sections[section].pack(&blockTypes[getIndex(0, section * SECTION_SIZE, 0)], CHUNK_HEIGHT * CHUNK_SIZE);
     }
-    isInitialized = true;
+
 }
 
-GLint Chunk::getTerrainHeightAt(GLint x, GLint z)
+void Chunk::decorate(const std::array<const Chunk*, 9>& neighbourhood)
 {
-    GLfloat biomeNoiseValue = biomeNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z));
-    GLfloat biomeValue = (biomeNoiseValue + 1.0f) / 2.0f;
+    if (isUnloading()) return;
+    {
+        // Anchors are replayed in world chunk order, overlapping structures end up the same in every chunk
+        std::unique_lock<std::shared_mutex> lock(blockDataMutex);
+        for (const Chunk* source : neighbourhood) {
+            for (const StructureAnchor& anchor : source->structureAnchors) {
+                Structure::generate(*this, anchor);
+            }
+        }
+    }
+    // Unloading can't save a chunk while it is decorated, what was built so far is dropped with it
+    if (isUnloading()) return;
 
-    std::vector<GLfloat> biomeWeights(biomes.size(), 0.0f);
+    calculateLight();
 
-    for (size_t i = 0; i < biomes.size(); ++i) {
-        const BiomeData& biome = biomes[i];
-        GLfloat weight = 0.0f;
+    hasUnsavedChanges = true;
+    markSectionsDirty(ALL_SECTIONS);
+    advanceState(ChunkState::Decorating, ChunkState::Decorated);
+}
 
-        if (biome.type == BiomeTypes::Desert) {
-            weight = 1.0f - smoothstep(biome.edge0, biome.edge1, biomeValue);
-        }
-        else if (biome.type == BiomeTypes::Plains) {
-            weight = smoothstep(biome.edge0, biome.edge1, biomeValue) * (1.0f - smoothstep(biome.edge2, biome.edge3, biomeValue));
-        }
-        else if (biome.type == BiomeTypes::Forest) {
-            weight = smoothstep(biome.edge0, biome.edge1, biomeValue);
-        }
-        else if (biome.type == BiomeTypes::Mountain) {
-            weight = smoothstep(biome.edge0, biome.edge1, biomeValue) * (1.0f - smoothstep(biome.edge2, biome.edge3, biomeValue));
-        }
+void Chunk::save(std::vector<uint8_t>& out) const
+{
+    ByteWriter writer(out);
+    writer.write<uint8_t>(SAVE_VERSION);
+    writer.write<uint8_t>(getStateBeforeUnloading() >= ChunkState::Decorated ? 1 : 0);
+
+    // Neighbours that are generated again still need the anchors to build their part of these structures
+    writer.write<uint16_t>(static_cast<uint16_t>(structureAnchors.size()));
+    for (const StructureAnchor& anchor : structureAnchors) {
+        writer.write<uint8_t>(static_cast<uint8_t>(anchor.type));
+        writer.write<int32_t>(anchor.x);
+        writer.write<int32_t>(anchor.y);
+        writer.write<int32_t>(anchor.z);
+        writer.write<uint64_t>(anchor.random.getPosition());
+    }
 
-        biomeWeights[i] = weight;
+    for (const PalettedSection& section : sections) {
+        section.serialize(writer);
     }
+}
 
-    GLfloat totalWeight = std::accumulate(biomeWeights.begin(), biomeWeights.end(), 0.0f);
-    if (totalWeight > 0.0f) {
-        for (GLfloat& weight : biomeWeights) {
-            weight /= totalWeight;
-        }
+bool Chunk::restore(const std::vector<uint8_t>& data, bool& wasDecorated)
+{
+    ByteReader reader(data.data(), data.size());
+    if (reader.read<uint8_t>() != SAVE_VERSION) return false;
+    uint8_t decorated = reader.read<uint8_t>();
+
+    uint16_t anchorCount = reader.read<uint16_t>();
+    std::vector<StructureAnchor> anchors;
+    anchors.reserve(anchorCount);
+    for (uint16_t i = 0; i < anchorCount; ++i) {
+        uint8_t type = reader.read<uint8_t>();
+        if (type > static_cast<uint8_t>(StructureAnchor::Type::PurpleTree)) return false;
+        GLint x = reader.read<int32_t>();
+        GLint y = reader.read<int32_t>();
+        GLint z = reader.read<int32_t>();
+        // The stream is keyed by the trunk column, rebuilding it there and seeking continues it exactly
+        WorldRandom random(world->getSeed(), x, z);
+        random.seek(reader.read<uint64_t>());
+        anchors.push_back({ static_cast<StructureAnchor::Type>(type), x, y, z, random });
     }
 
-    GLfloat blendedHeight = 0.0f;
-    for (size_t i = 0; i < biomes.size(); ++i) {
-        if (biomeWeights[i] > 0.0f) {
-            const BiomeData& biome = biomes[i];
-            const Biomes* biomeInstance = getBiomeInstance(biome.type);
-            GLfloat biomeHeight = biomeInstance->getTerrainHeightAt(x, z);
-            blendedHeight += biomeHeight * biomeWeights[i];
-        }
+    std::array<PalettedSection, CHUNK_SECTIONS> restoredSections;
+    for (PalettedSection& section : restoredSections) {
+        if (!section.deserialize(reader)) return false;
     }
+    if (!reader.isValid() || !reader.isAtEnd()) return false;
 
-    return static_cast<int16_t>(blendedHeight);
+    structureAnchors = std::move(anchors);
+    sections = std::move(restoredSections);
+    wasDecorated = decorated != 0;
+    return true;
 }
 
 void Chunk::placeBlockIfInChunk(GLint globalX, GLint y, GLint globalZ, GLint blockType)
 {
     if (y >= 0 && y < CHUNK_HEIGHT) {
-        GLint localX = globalX - chunkX * CHUNK_SIZE;
-        GLint localZ = globalZ - chunkZ * CHUNK_SIZE;
+        GLint localX = globalX - getChunkX() * CHUNK_SIZE;
+        GLint localZ = globalZ - getChunkZ() * CHUNK_SIZE;
 
         if (localX >= 0 && localX < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE) {
-            blockTypes[getIndex(localX, y, localZ)] = blockType;
+            sections[y / SECTION_SIZE].set(PalettedSection::getIndex(localX, y % SECTION_SIZE, localZ), static_cast<int8_t>(blockType));
         }
     }
 }
 
+bool Chunk::containsColumn(GLint globalX, GLint globalZ) const
+{
+    GLint localX = globalX - getChunkX() * CHUNK_SIZE;
+    GLint localZ = globalZ - getChunkZ() * CHUNK_SIZE;
+    return localX >= 0 && localX < CHUNK_SIZE && localZ >= 0 && localZ < CHUNK_SIZE;
+}
+
 inline GLint Chunk::getIndex(GLint x, GLint y, GLint z) const
 {
     static constexpr uint16_t layerSize = CHUNK_HEIGHT * CHUNK_SIZE;
     return x * layerSize + y * CHUNK_SIZE + z;
 }
 
-inline bool Chunk::isTransparent(GLint blockType)
+SectionState Chunk::getSectionState(GLint section) const
 {
-    return blockType == -1 || blockType == WATER || blockType == OAK_LEAF || blockType == OAK_LEAF_ORANGE || blockType == OAK_LEAF_YELLOW || blockType == GLASS ||
-        blockType == FLOWER1 || blockType == FLOWER2 || blockType == FLOWER3 || blockType == FLOWER4 || blockType == FLOWER5 || blockType == GRASS1 || blockType == GRASS2 || 
-        blockType == GRASS3 || blockType == DEADBUSH || blockType == OAK_LEAF_PURPLE || blockType == TORCH;
+    const PalettedSection& blocks = sections[section];
+    if (blocks.isUniform() && blocks.getUniformBlock() == -1) return SectionState::Empty;
+
+    for (int8_t blockType : blocks.getPalette()) {
+        if (isTransparent(blockType)) return SectionState::Mixed;
+    }
+    return SectionState::Opaque;
 }
 
-void Chunk::recalculateSunlightColumn(GLint x, GLint z) {
-    uint8_t lightLevel = 15; // Maximum sunlight
+uint8_t Chunk::getSectionsAround(GLint y)
+{
+    GLint section = y / SECTION_SIZE;
+    uint8_t mask = static_cast<uint8_t>(1u << section);
+    if (y % SECTION_SIZE == 0 && section > 0) mask |= static_cast<uint8_t>(1u << (section - 1));
+    if (y % SECTION_SIZE == SECTION_SIZE - 1 && section < CHUNK_SECTIONS - 1) mask |= static_cast<uint8_t>(1u << (section + 1));
+    return mask;
+}
 
-    // Loop through the column from top to bottom
-    for (GLint y = CHUNK_HEIGHT - 1; y >= 0; --y) {
-        GLuint index = getIndex(x, y, z);
+void Chunk::calculateLight()
+{
+    std::unique_lock<std::shared_mutex> lock(blockDataMutex);
+    std::array<Chunk*, 9> neighbourhood = {};
+    neighbourhood[4] = this;
+    LightEngine engine(neighbourhood);
+    engine.lightChunk();
+    compactLight(ALL_SECTIONS);
+}
 
-        if (isTransparent(blockTypes[index])) {
-            lightLevels[index] = lightLevel;
-        }
-        else { // Solid block
-            lightLevels[index] = lightLevel;
-            lightLevel = 0; // Stop sunlight propagation at solid blocks
+void Chunk::compactLight(uint8_t sectionMask)
+{
+    for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+        if (sectionMask & (1u << section)) light[section].compact();
+    }
+}
+
+bool Chunk::mayContainBlock(GLint section, int8_t blockType) const
+{
+    const std::vector<int8_t>& palette = sections[section].getPalette();
+    return std::find(palette.begin(), palette.end(), blockType) != palette.end();
+}
+
+ChunkSnapshot Chunk::captureSnapshot() const
+{
+    ChunkSnapshot snapshot;
+    snapshot.blockTypes.assign(ChunkSnapshot::VOLUME, -1);
+    snapshot.light.assign(ChunkSnapshot::VOLUME, 0);
+    for (auto& states : snapshot.sectionStates) {
+        states.fill(SectionState::Empty);
+    }
+
+    for (GLint dx = -1; dx <= 1; ++dx) {
+        for (GLint dz = -1; dz <= 1; ++dz) {
+            const Chunk* source = (dx == 0 && dz == 0) ? this : world->getChunk(getChunkX() + dx, getChunkZ() + dz);
+            if (!source) continue;
+
+            // Only the columns of the source chunk that touch this one are copied
+            GLint minX = dx < 0 ? CHUNK_SIZE - 1 : 0, maxX = dx > 0 ? 0 : CHUNK_SIZE - 1;
+            GLint minZ = dz < 0 ? CHUNK_SIZE - 1 : 0, maxZ = dz > 0 ? 0 : CHUNK_SIZE - 1;
+
+            std::shared_lock<std::shared_mutex> lock(source->blockDataMutex);
+            for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+                snapshot.sectionStates[(dx + 1) * 3 + (dz + 1)][section] = source->getSectionState(section);
+            }
+
+            for (GLint x = minX; x <= maxX; ++x) {
+                for (GLint y = 0; y < CHUNK_HEIGHT; ++y) {
+                    const SectionLight& sectionLight = source->light[y / SECTION_SIZE];
+                    if (dz == 0) {
+                        sectionLight.copyRow(PalettedSection::getIndex(x, y % SECTION_SIZE, 0),
+                            &snapshot.light[snapshot.getIndex(x + dx * CHUNK_SIZE, y, 0)]);
+                        continue;
+                    }
+                    for (GLint z = minZ; z <= maxZ; ++z) {
+                        snapshot.light[snapshot.getIndex(x + dx * CHUNK_SIZE, y, z + dz * CHUNK_SIZE)] =
+                            sectionLight.get(PalettedSection::getIndex(x, y % SECTION_SIZE, z));
+                    }
+                }
+            }
+
+            if (source == this) {
+                // The chunk itself is unpacked a section at a time, all air sections are already in place
+                std::array<int8_t, SECTION_VOLUME> sectionBlocks;
+                for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+                    if (sections[section].isUniform() && sections[section].getUniformBlock() == -1) continue;
+
+                    sections[section].unpack(sectionBlocks.data(), SECTION_SIZE * SECTION_SIZE);
+                    for (GLint x = 0; x < CHUNK_SIZE; ++x) {
+                        for (GLint y = 0; y < SECTION_SIZE; ++y) {
+                            std::memcpy(&snapshot.blockTypes[snapshot.getIndex(x, section * SECTION_SIZE + y, 0)],
+                                &sectionBlocks[PalettedSection::getIndex(x, y, 0)], CHUNK_SIZE);
+                        }
+                    }
+                }
+                continue;
+            }
+
+            for (GLint x = minX; x <= maxX; ++x) {
+                for (GLint y = 0; y < CHUNK_HEIGHT; ++y) {
+                    for (GLint z = minZ; z <= maxZ; ++z) {
+                        snapshot.blockTypes[snapshot.getIndex(x + dx * CHUNK_SIZE, y, z + dz * CHUNK_SIZE)] = static_cast<int8_t>(source->getStoredBlock(x, y, z));
+                    }
+                }
+            }
         }
     }
+
+    return snapshot;
+}
+
+bool ChunkSnapshot::hasNoVisibleFaces(GLint section) const
+{
+    const std::array<SectionState, CHUNK_SECTIONS>& states = sectionStates[4];
+    if (states[section] == SectionState::Empty) return true;
+    if (states[section] != SectionState::Opaque) return false;
+
+    // The bottom of the world is never seen, the top of the chunk is open sky
+    bool below = section == 0 || states[section - 1] == SectionState::Opaque;
+    bool above = section < CHUNK_SECTIONS - 1 && states[section + 1] == SectionState::Opaque;
+    return below && above &&
+        sectionStates[1][section] == SectionState::Opaque && sectionStates[7][section] == SectionState::Opaque &&
+        sectionStates[3][section] == SectionState::Opaque && sectionStates[5][section] == SectionState::Opaque;
 }
 
-void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
+void Chunk::generateMesh(const ChunkSnapshot& snapshot, ChunkMesh& mesh, GLint section)
 {
+    if (world->getIsGreedyMeshingEnabled() && world->getIsBinaryGreedyMeshingEnabled()) {
+        generateBinaryGreedyMesh(snapshot, mesh, section);
+        return;
+    }
+
+    // Only blocks in [minY, endY) are meshed, faces never grow past the section
+    const GLint minY = section * SECTION_SIZE;
+    const GLint endY = minY + SECTION_SIZE;
+
+    const std::vector<int8_t>& blockTypes = snapshot.blockTypes;
+
+    std::vector<PackedVertex>& vertices = mesh.vertices;
+    std::vector<GLuint>& indices = mesh.indices;
+    std::vector<PackedVertex>& waterVertices = mesh.waterVertices;
+    std::vector<GLuint>& waterIndices = mesh.waterIndices;
+
     vertices.clear();
     indices.clear();
     waterVertices.clear();
@@ -396,50 +549,17 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
         processed.flags |= face;
     };
 
+    // Indexed with section local y
     std::vector<std::vector<std::vector<ProcessedFaces>>> processed(
-        CHUNK_SIZE, std::vector<std::vector<ProcessedFaces>>(CHUNK_HEIGHT, std::vector<ProcessedFaces>(CHUNK_SIZE)));
+        CHUNK_SIZE, std::vector<std::vector<ProcessedFaces>>(SECTION_SIZE, std::vector<ProcessedFaces>(CHUNK_SIZE)));
 
     auto isAir = [](GLint blockType) {
         return blockType == -1;
     };
 
     auto isExposed = [&](GLint x, GLint y, GLint z, GLint dx, GLint dy, GLint dz, GLint blockType) {
-        GLint nx = x + dx, ny = y + dy, nz = z + dz;
-        GLint neighborBlockType = -1; // Default to air
-
-        if (nx >= 0 && ny >= 0 && nz >= 0 && nx < CHUNK_SIZE && ny < CHUNK_HEIGHT && nz < CHUNK_SIZE) {
-            neighborBlockType = blockTypes[getIndex(nx, ny, nz)];
-        }
-        else {
-            GLint neighborChunkX = chunkX, neighborChunkZ = chunkZ;
-            GLint neighborX = nx, neighborZ = nz;
-
-            if (nx < 0) {
-                neighborChunkX -= 1;
-                neighborX += CHUNK_SIZE;
-            }
-            else if (nx >= CHUNK_SIZE) {
-                neighborChunkX += 1;
-                neighborX -= CHUNK_SIZE;
-            }
-
-            if (nz < 0) {
-                neighborChunkZ -= 1;
-                neighborZ += CHUNK_SIZE;
-            }
-            else if (nz >= CHUNK_SIZE) {
-                neighborChunkZ += 1;
-                neighborZ -= CHUNK_SIZE;
-            }
-
-            Chunk* neighborChunk = world->getChunk(neighborChunkX, neighborChunkZ);
-            if (neighborChunk) {
-                neighborBlockType = neighborChunk->getBlockType(neighborX, ny, neighborZ);
-            }
-            else {
-                neighborBlockType = -1;
-            }
-        }
+        // The snapshot border covers every neighbour the mesher samples, including the diagonals used for AO
+        GLint neighborBlockType = blockTypes[snapshot.getIndex(x + dx, y + dy, z + dz)];
 
         if (neighborBlockType == blockType) {
             return false; // Same block type; do not expose face
@@ -448,61 +568,54 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
         return isTransparent(neighborBlockType);
     };
 
-    auto calculateAO = [&](bool side1, bool side2, bool corner) {
-        GLfloat baseAO = 1.0f;
-        if (side1 && side2) baseAO = 1.0f;
-        else baseAO = 1.0f - (side1 + side2 + corner) / 3.0f;
-        return glm::clamp(baseAO, 0.90f, 1.0f);
+    // Occlusion level 0-3, the shaders turn it into a brightness factor
+    auto calculateAO = [&](bool side1, bool side2, bool corner) -> uint8_t {
+        if (side1 && side2) return 0;
+        return side1 + side2 + corner;
     };
 
     if (!world->getIsGreedyMeshingEnabled()) {
         for (int16_t x = 0; x < CHUNK_SIZE; ++x) {
-            for (int16_t y = 0; y < CHUNK_HEIGHT; ++y) {
+            for (int16_t y = minY; y < endY; ++y) {
                 for (int16_t z = 0; z < CHUNK_SIZE; ++z) {
-                    GLint index = getIndex(x, y, z);
+                    GLint index = snapshot.getIndex(x, y, z);
                     GLint blockType = blockTypes[index];
                     if (blockType == -1) continue;
 
                     // Grass & flowers
                     if (blockType == FLOWER1 || blockType == FLOWER2 || blockType == FLOWER3 || blockType == FLOWER4 || blockType == FLOWER5
                         || blockType == GRASS1 || blockType == GRASS2 || blockType == GRASS3 || blockType == DEADBUSH) {
-                        addGrassPlant(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, lightLevels[index], blockType);
+                        addGrassPlant(vertices, indices, vertexOffset, x, y, z, snapshot.getLightLevel(index), blockType);
                         continue;
                     }
 
                     // Torch
                     if (blockType == TORCH) {
-                        addTorch(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, lightLevels[index], blockType);
+                        addTorch(vertices, indices, vertexOffset, x, y, z, snapshot.getLightLevel(index), blockType);
                         continue;
                     }
 
                     // Water
                     if (blockType == WATER) {
-                        uint8_t lightLevel = lightLevels[index];
+                        uint8_t lightLevel = snapshot.getLightLevel(index);
                         GLint textureLayer = getTextureLayer(blockType, 0);
-                        GLfloat ao[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+                        uint8_t ao[4] = { 0, 0, 0, 0 };
 
-                        int16_t worldX = chunkX * CHUNK_SIZE + x;
-                        int16_t worldZ = chunkZ * CHUNK_SIZE + z;
-
-                        if (isExposed(x, y, z, 0, 0, -1, blockType)) Block::addBackFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
-                        if (isExposed(x, y, z, 0, 0, 1, blockType)) Block::addFrontFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
-                        if (isExposed(x, y, z, -1, 0, 0, blockType)) Block::addLeftFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
-                        if (isExposed(x, y, z, 1, 0, 0, blockType)) Block::addRightFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        if (isExposed(x, y, z, 0, 0, -1, blockType)) Block::addBackFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
+                        if (isExposed(x, y, z, 0, 0, 1, blockType)) Block::addFrontFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
+                        if (isExposed(x, y, z, -1, 0, 0, blockType)) Block::addLeftFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
+                        if (isExposed(x, y, z, 1, 0, 0, blockType)) Block::addRightFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                         if (isExposed(x, y, z, 0, 1, 0, blockType)) {
                             GLfloat waterY = y + 0.9f;
-                            Block::addTopFace(waterVertices, waterIndices, waterVertexOffset, worldX, waterY, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                            Block::addTopFace(waterVertices, waterIndices, waterVertexOffset, x, waterY, z, 1, 1, textureLayer, lightLevel, ao);
                         }
-                        if (isExposed(x, y, z, 0, -1, 0, blockType)) Block::addBottomFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        if (isExposed(x, y, z, 0, -1, 0, blockType)) Block::addBottomFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                         continue;
                     }
 
                     GLint textureLayer;
-                    GLfloat ao[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-                    uint8_t lightLevel = lightLevels[index];
-                    int16_t worldX = chunkX * CHUNK_SIZE + x;
-                    int16_t worldZ = chunkZ * CHUNK_SIZE + z;
-
+                    uint8_t ao[4] = { 0, 0, 0, 0 };
+                    uint8_t lightLevel = snapshot.getLightLevel(index);
                     // Back
                     if (isExposed(x, y, z, 0, 0, -1, blockType)) {
                         textureLayer = getTextureLayer(blockType, 0);
@@ -512,7 +625,7 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                             ao[2] = calculateAO(isExposed(x, y, z, -1, 0, 0, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, -1, -1, 0, blockType));
                             ao[3] = calculateAO(isExposed(x, y, z, 1, 0, 0, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 1, -1, 0, blockType));
                         }
-                        Block::addBackFace(vertices, indices, vertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        Block::addBackFace(vertices, indices, vertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     }
 
                     // Front
@@ -524,7 +637,7 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                             ao[2] = calculateAO(isExposed(x, y, z, -1, 0, 0, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, -1, -1, 1, blockType));
                             ao[3] = calculateAO(isExposed(x, y, z, 1, 0, 0, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 1, -1, 1, blockType));
                         }
-                        Block::addFrontFace(vertices, indices, vertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        Block::addFrontFace(vertices, indices, vertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     }
 
                     // Left
@@ -536,7 +649,7 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                             ao[2] = calculateAO(isExposed(x, y, z, 0, 0, -1, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 0, -1, -1, blockType));
                             ao[3] = calculateAO(isExposed(x, y, z, 0, 0, 1, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 0, -1, 1, blockType));
                         }
-                        Block::addLeftFace(vertices, indices, vertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        Block::addLeftFace(vertices, indices, vertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     }
 
                     // Right
@@ -548,13 +661,13 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                             ao[2] = calculateAO(isExposed(x, y, z, 0, 0, -1, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 0, -1, -1, blockType));
                             ao[3] = calculateAO(isExposed(x, y, z, 0, 0, 1, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 0, -1, 1, blockType));
                         }
-                        Block::addRightFace(vertices, indices, vertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        Block::addRightFace(vertices, indices, vertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     }
 
                     // Top
                     if (isExposed(x, y, z, 0, 1, 0, blockType)) {
                         textureLayer = getTextureLayer(blockType, 4);
-                        Block::addTopFace(vertices, indices, vertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        Block::addTopFace(vertices, indices, vertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     }
 
                     // Bottom
@@ -566,7 +679,7 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                             ao[2] = calculateAO(isExposed(x, y, z, 0, 0, 1, blockType), isExposed(x, y, z, -1, 0, 0, blockType), isExposed(x, y, z, -1, 0, 1, blockType));
                             ao[3] = calculateAO(isExposed(x, y, z, 0, 0, 1, blockType), isExposed(x, y, z, 1, 0, 0, blockType), isExposed(x, y, z, 1, 0, 1, blockType));
                         }
-                        Block::addBottomFace(vertices, indices, vertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        Block::addBottomFace(vertices, indices, vertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     }
                 }
             }
@@ -577,11 +690,12 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
     auto processFace = [&](GLint x, GLint y, GLint z, int8_t face) {
         uint16_t extentX = 1;
         uint16_t extentY = 1;
-        GLint blockType = blockTypes[getIndex(x, y, z)];
+        GLint blockType = blockTypes[snapshot.getIndex(x, y, z)];
         GLint textureLayer = getTextureLayer(blockType, face);
-        GLuint index = getIndex(x, y, z);
-        uint8_t lightLevel = lightLevels[index];
-        GLfloat ao[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        GLuint index = snapshot.getIndex(x, y, z);
+        // A quad carries a single light level, it only grows over faces lit the same
+        uint8_t lightLevel = snapshot.getLightLevel(index);
+        uint8_t ao[4] = { 0, 0, 0, 0 };
 
         switch (face) {
         case 0: // Back face
@@ -594,10 +708,10 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 ao[3] = calculateAO(isExposed(x, y, z, 1, 0, 0, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 1, -1, 0, blockType));
             }
             
-            while (y + extentY < CHUNK_HEIGHT && blockTypes[getIndex(x, y + extentY, z)] == blockType &&
-                !isFaceProcessed(processed[x][y + extentY][z], FaceFlag::BACK) && 
+            while (y + extentY < endY && blockTypes[snapshot.getIndex(x, y + extentY, z)] == blockType && snapshot.getLightLevel(snapshot.getIndex(x, y + extentY, z)) == lightLevel &&
+                !isFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::BACK) && 
                 isExposed(x, y + extentY, z, 0, 0, -1, blockType)) {
-                setFaceProcessed(processed[x][y + extentY][z], FaceFlag::BACK);
+                setFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::BACK);
                 extentY++;
             }
 
@@ -605,8 +719,8 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
             while (x + extentX < CHUNK_SIZE) {
                 bool canExtend = true;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    if (blockTypes[getIndex(x + extentX, y + dy, z)] != blockType ||
-                        isFaceProcessed(processed[x + extentX][y + dy][z], FaceFlag::BACK) ||
+                    if (blockTypes[snapshot.getIndex(x + extentX, y + dy, z)] != blockType || snapshot.getLightLevel(snapshot.getIndex(x + extentX, y + dy, z)) != lightLevel ||
+                        isFaceProcessed(processed[x + extentX][y + dy - minY][z], FaceFlag::BACK) ||
                         !isExposed(x + extentX, y + dy, z, 0, 0, -1, blockType)) {
                         canExtend = false;
                         break;
@@ -614,11 +728,11 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 }
                 if (!canExtend) break;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    setFaceProcessed(processed[x + extentX][y + dy][z], FaceFlag::BACK);
+                    setFaceProcessed(processed[x + extentX][y + dy - minY][z], FaceFlag::BACK);
                 }
                 extentX++;
             }
-            Block::addBackFace(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, extentX, extentY, textureLayer, lightLevel, ao);
+            Block::addBackFace(vertices, indices, vertexOffset, x, y, z, extentX, extentY, textureLayer, lightLevel, ao);
             break;
 
         case 1: // Front face
@@ -631,10 +745,10 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 ao[3] = calculateAO(isExposed(x, y, z, 1, 0, 0, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 1, -1, 1, blockType));
             }
 
-            while (y + extentY < CHUNK_HEIGHT && blockTypes[getIndex(x, y + extentY, z)] == blockType &&
-                !isFaceProcessed(processed[x][y + extentY][z], FaceFlag::FRONT) &&
+            while (y + extentY < endY && blockTypes[snapshot.getIndex(x, y + extentY, z)] == blockType && snapshot.getLightLevel(snapshot.getIndex(x, y + extentY, z)) == lightLevel &&
+                !isFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::FRONT) &&
                 isExposed(x, y + extentY, z, 0, 0, 1, blockType)) {
-                setFaceProcessed(processed[x][y + extentY][z], FaceFlag::FRONT);
+                setFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::FRONT);
                 extentY++;
             }
 
@@ -642,8 +756,8 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
             while (x + extentX < CHUNK_SIZE) {
                 bool canExtend = true;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    if (blockTypes[getIndex(x + extentX, y + dy, z)] != blockType ||
-                        isFaceProcessed(processed[x + extentX][y + dy][z], FaceFlag::FRONT) ||
+                    if (blockTypes[snapshot.getIndex(x + extentX, y + dy, z)] != blockType || snapshot.getLightLevel(snapshot.getIndex(x + extentX, y + dy, z)) != lightLevel ||
+                        isFaceProcessed(processed[x + extentX][y + dy - minY][z], FaceFlag::FRONT) ||
                         !isExposed(x + extentX, y + dy, z, 0, 0, 1, blockType)) {
                         canExtend = false;
                         break;
@@ -651,11 +765,11 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 }
                 if (!canExtend) break;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    setFaceProcessed(processed[x + extentX][y + dy][z], FaceFlag::FRONT);
+                    setFaceProcessed(processed[x + extentX][y + dy - minY][z], FaceFlag::FRONT);
                 }
                 extentX++;
             }
-            Block::addFrontFace(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, extentX, extentY, textureLayer, lightLevel, ao);
+            Block::addFrontFace(vertices, indices, vertexOffset, x, y, z, extentX, extentY, textureLayer, lightLevel, ao);
             break;
 
         case 2: // Left face
@@ -668,10 +782,10 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 ao[3] = calculateAO(isExposed(x, y, z, 0, 0, 1, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 0, -1, 1, blockType));
             }
 
-            while (y + extentY < CHUNK_HEIGHT && blockTypes[getIndex(x, y + extentY, z)] == blockType &&
-                !isFaceProcessed(processed[x][y + extentY][z], FaceFlag::LEFT) &&
+            while (y + extentY < endY && blockTypes[snapshot.getIndex(x, y + extentY, z)] == blockType && snapshot.getLightLevel(snapshot.getIndex(x, y + extentY, z)) == lightLevel &&
+                !isFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::LEFT) &&
                 isExposed(x, y + extentY, z, -1, 0, 0, blockType)) {
-                setFaceProcessed(processed[x][y + extentY][z], FaceFlag::LEFT);
+                setFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::LEFT);
                 extentY++;
             }
 
@@ -679,8 +793,8 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
             while (z + extentX < CHUNK_SIZE) {
                 bool canExtend = true;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    if (blockTypes[getIndex(x, y + dy, z + extentX)] != blockType ||
-                        isFaceProcessed(processed[x][y + dy][z + extentX], FaceFlag::LEFT) ||
+                    if (blockTypes[snapshot.getIndex(x, y + dy, z + extentX)] != blockType || snapshot.getLightLevel(snapshot.getIndex(x, y + dy, z + extentX)) != lightLevel ||
+                        isFaceProcessed(processed[x][y + dy - minY][z + extentX], FaceFlag::LEFT) ||
                         !isExposed(x, y + dy, z + extentX, -1, 0, 0, blockType)) {
                         canExtend = false;
                         break;
@@ -688,11 +802,11 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 }
                 if (!canExtend) break;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    setFaceProcessed(processed[x][y + dy][z + extentX], FaceFlag::LEFT);
+                    setFaceProcessed(processed[x][y + dy - minY][z + extentX], FaceFlag::LEFT);
                 }
                 extentX++;
             }
-            Block::addLeftFace(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, extentX, extentY, textureLayer, lightLevel, ao);
+            Block::addLeftFace(vertices, indices, vertexOffset, x, y, z, extentX, extentY, textureLayer, lightLevel, ao);
             break;
 
         case 3: // Right face
@@ -705,10 +819,10 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 ao[3] = calculateAO(isExposed(x, y, z, 0, 0, 1, blockType), isExposed(x, y, z, 0, -1, 0, blockType), isExposed(x, y, z, 0, -1, 1, blockType));
             }
 
-            while (y + extentY < CHUNK_HEIGHT && blockTypes[getIndex(x, y + extentY, z)] == blockType &&
-                !isFaceProcessed(processed[x][y + extentY][z], FaceFlag::RIGHT) &&
+            while (y + extentY < endY && blockTypes[snapshot.getIndex(x, y + extentY, z)] == blockType && snapshot.getLightLevel(snapshot.getIndex(x, y + extentY, z)) == lightLevel &&
+                !isFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::RIGHT) &&
                 isExposed(x, y + extentY, z, 1, 0, 0, blockType)) {
-                setFaceProcessed(processed[x][y + extentY][z], FaceFlag::RIGHT);
+                setFaceProcessed(processed[x][y + extentY - minY][z], FaceFlag::RIGHT);
                 extentY++;
             }
 
@@ -716,8 +830,8 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
             while (z + extentX < CHUNK_SIZE) {
                 bool canExtend = true;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    if (blockTypes[getIndex(x, y + dy, z + extentX)] != blockType ||
-                        isFaceProcessed(processed[x][y + dy][z + extentX], FaceFlag::RIGHT) ||
+                    if (blockTypes[snapshot.getIndex(x, y + dy, z + extentX)] != blockType || snapshot.getLightLevel(snapshot.getIndex(x, y + dy, z + extentX)) != lightLevel ||
+                        isFaceProcessed(processed[x][y + dy - minY][z + extentX], FaceFlag::RIGHT) ||
                         !isExposed(x, y + dy, z + extentX, 1, 0, 0, blockType)) {
                         canExtend = false;
                         break;
@@ -725,19 +839,19 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 }
                 if (!canExtend) break;
                 for (int16_t dy = 0; dy < extentY; ++dy) {
-                    setFaceProcessed(processed[x][y + dy][z + extentX], FaceFlag::RIGHT);
+                    setFaceProcessed(processed[x][y + dy - minY][z + extentX], FaceFlag::RIGHT);
                 }
                 extentX++;
             }
-            Block::addRightFace(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, extentX, extentY, textureLayer, lightLevel, ao);
+            Block::addRightFace(vertices, indices, vertexOffset, x, y, z, extentX, extentY, textureLayer, lightLevel, ao);
             break;
 
         case 4: // Top face
 
-            while (z + extentY < CHUNK_SIZE && blockTypes[getIndex(x, y, z + extentY)] == blockType &&
-                !isFaceProcessed(processed[x][y][z + extentY], FaceFlag::TOP) &&
+            while (z + extentY < CHUNK_SIZE && blockTypes[snapshot.getIndex(x, y, z + extentY)] == blockType && snapshot.getLightLevel(snapshot.getIndex(x, y, z + extentY)) == lightLevel &&
+                !isFaceProcessed(processed[x][y - minY][z + extentY], FaceFlag::TOP) &&
                 isExposed(x, y, z + extentY, 0, 1, 0, blockType)) {
-                setFaceProcessed(processed[x][y][z + extentY], FaceFlag::TOP);
+                setFaceProcessed(processed[x][y - minY][z + extentY], FaceFlag::TOP);
                 extentY++;
             }
 
@@ -745,8 +859,8 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
             while (x + extentX < CHUNK_SIZE) {
                 bool canExtend = true;
                 for (int16_t dz = 0; dz < extentY; ++dz) {
-                    if (blockTypes[getIndex(x + extentX, y, z + dz)] != blockType ||
-                        isFaceProcessed(processed[x + extentX][y][z + dz], FaceFlag::TOP) ||
+                    if (blockTypes[snapshot.getIndex(x + extentX, y, z + dz)] != blockType || snapshot.getLightLevel(snapshot.getIndex(x + extentX, y, z + dz)) != lightLevel ||
+                        isFaceProcessed(processed[x + extentX][y - minY][z + dz], FaceFlag::TOP) ||
                         !isExposed(x + extentX, y, z + dz, 0, 1, 0, blockType)) {
                         canExtend = false;
                         break;
@@ -754,11 +868,11 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 }
                 if (!canExtend) break;
                 for (int16_t dz = 0; dz < extentY; ++dz) {
-                    setFaceProcessed(processed[x + extentX][y][z + dz], FaceFlag::TOP);
+                    setFaceProcessed(processed[x + extentX][y - minY][z + dz], FaceFlag::TOP);
                 }
                 extentX++;
             }
-            Block::addTopFace(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, extentX, extentY, textureLayer, lightLevel, ao);
+            Block::addTopFace(vertices, indices, vertexOffset, x, y, z, extentX, extentY, textureLayer, lightLevel, ao);
             break;
 
         case 5: // Bottom face
@@ -771,18 +885,18 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 ao[3] = calculateAO(isExposed(x, y, z, 0, 0, 1, blockType), isExposed(x, y, z, 1, 0, 0, blockType), isExposed(x, y, z, 1, 0, 1, blockType));
             }
 
-            while (z + extentY < CHUNK_SIZE && blockTypes[getIndex(x, y, z + extentY)] == blockType &&
-                !isFaceProcessed(processed[x][y][z + extentY], FaceFlag::BOTTOM) &&
+            while (z + extentY < CHUNK_SIZE && blockTypes[snapshot.getIndex(x, y, z + extentY)] == blockType && snapshot.getLightLevel(snapshot.getIndex(x, y, z + extentY)) == lightLevel &&
+                !isFaceProcessed(processed[x][y - minY][z + extentY], FaceFlag::BOTTOM) &&
                 isExposed(x, y, z + extentY, 0, -1, 0, blockType)) {
-                setFaceProcessed(processed[x][y][z + extentY], FaceFlag::BOTTOM);
+                setFaceProcessed(processed[x][y - minY][z + extentY], FaceFlag::BOTTOM);
                 extentY++;
             }
             extentX = 1;
             while (x + extentX < CHUNK_SIZE) {
                 bool canExtend = true;
                 for (int16_t dz = 0; dz < extentY; ++dz) {
-                    if (blockTypes[getIndex(x + extentX, y, z + dz)] != blockType ||
-                        isFaceProcessed(processed[x + extentX][y][z + dz], FaceFlag::BOTTOM) ||
+                    if (blockTypes[snapshot.getIndex(x + extentX, y, z + dz)] != blockType || snapshot.getLightLevel(snapshot.getIndex(x + extentX, y, z + dz)) != lightLevel ||
+                        isFaceProcessed(processed[x + extentX][y - minY][z + dz], FaceFlag::BOTTOM) ||
                         !isExposed(x + extentX, y, z + dz, 0, -1, 0, blockType)) {
                         canExtend = false;
                         break;
@@ -790,19 +904,19 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                 }
                 if (!canExtend) break;
                 for (int16_t dz = 0; dz < extentY; ++dz) {
-                    setFaceProcessed(processed[x + extentX][y][z + dz], FaceFlag::BOTTOM);
+                    setFaceProcessed(processed[x + extentX][y - minY][z + dz], FaceFlag::BOTTOM);
                 }
                 extentX++;
             }
-            Block::addBottomFace(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, extentX, extentY, textureLayer, lightLevel, ao);
+            Block::addBottomFace(vertices, indices, vertexOffset, x, y, z, extentX, extentY, textureLayer, lightLevel, ao);
             break;
         }
         };
 
     for (int16_t x = 0; x < CHUNK_SIZE; ++x) {
-        for (int16_t y = 0; y < CHUNK_HEIGHT; ++y) {
+        for (int16_t y = minY; y < endY; ++y) {
             for (int16_t z = 0; z < CHUNK_SIZE; ++z) {
-                GLint index = getIndex(x, y, z);
+                GLint index = snapshot.getIndex(x, y, z);
                 GLint blockType = blockTypes[index];
                 if (blockTypes[index] == -1) continue;
 
@@ -810,71 +924,366 @@ void Chunk::generateMesh(const std::vector<GLint>& blockTypes)
                     || blockTypes[index] == GRASS1 || blockTypes[index] == GRASS2 || blockTypes[index] == GRASS3 || blockTypes[index] == DEADBUSH)
                 {
                     // Add grass plant mesh
-                    addGrassPlant(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, lightLevels[index], blockTypes[index]);
+                    addGrassPlant(vertices, indices, vertexOffset, x, y, z, snapshot.getLightLevel(index), blockTypes[index]);
                     continue;
                 }
 
                 if (blockTypes[index] == TORCH)
                 {
                     // Add torch mesh
-                    addTorch(vertices, indices, vertexOffset, chunkX * CHUNK_SIZE + x, y, chunkZ * CHUNK_SIZE + z, lightLevels[index], blockTypes[index]);
+                    addTorch(vertices, indices, vertexOffset, x, y, z, snapshot.getLightLevel(index), blockTypes[index]);
                     continue;
                 }
 
                 // Water block
                 if (blockType == WATER) {
-                    uint8_t lightLevel = lightLevels[index];
+                    uint8_t lightLevel = snapshot.getLightLevel(index);
                     GLint textureLayer = getTextureLayer(blockType, 0);
-                    GLfloat ao[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+                    uint8_t ao[4] = { 0, 0, 0, 0 };
 
-                    int16_t worldX = chunkX * CHUNK_SIZE + x;
-                    int16_t worldZ = chunkZ * CHUNK_SIZE + z;
-
-                    if (isExposed(x, y, z, 0, 0, -1, blockType)) Block::addBackFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
-                    if (isExposed(x, y, z, 0, 0, 1, blockType)) Block::addFrontFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
-                    if (isExposed(x, y, z, -1, 0, 0, blockType)) Block::addLeftFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
-                    if (isExposed(x, y, z, 1, 0, 0, blockType)) Block::addRightFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                    if (isExposed(x, y, z, 0, 0, -1, blockType)) Block::addBackFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
+                    if (isExposed(x, y, z, 0, 0, 1, blockType)) Block::addFrontFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
+                    if (isExposed(x, y, z, -1, 0, 0, blockType)) Block::addLeftFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
+                    if (isExposed(x, y, z, 1, 0, 0, blockType)) Block::addRightFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     if (isExposed(x, y, z, 0, 1, 0, blockType)) 
                     {
                         GLfloat waterY = y + 0.9f;
-                        Block::addTopFace(waterVertices, waterIndices, waterVertexOffset, worldX, waterY, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                        Block::addTopFace(waterVertices, waterIndices, waterVertexOffset, x, waterY, z, 1, 1, textureLayer, lightLevel, ao);
                     }
-                    if (isExposed(x, y, z, 0, -1, 0, blockType)) Block::addBottomFace(waterVertices, waterIndices, waterVertexOffset, worldX, y, worldZ, 1, 1, textureLayer, lightLevel, ao);
+                    if (isExposed(x, y, z, 0, -1, 0, blockType)) Block::addBottomFace(waterVertices, waterIndices, waterVertexOffset, x, y, z, 1, 1, textureLayer, lightLevel, ao);
                     continue;
                 }
 
                 // Back face
-                if (!isFaceProcessed(processed[x][y][z], FaceFlag::BACK) && isExposed(x, y, z, 0, 0, -1, blockType)) {
+                if (!isFaceProcessed(processed[x][y - minY][z], FaceFlag::BACK) && isExposed(x, y, z, 0, 0, -1, blockType)) {
                     processFace(x, y, z, 0);
-                    setFaceProcessed(processed[x][y][z], FaceFlag::BACK);
+                    setFaceProcessed(processed[x][y - minY][z], FaceFlag::BACK);
                 }
                 // Front face
-                if (!isFaceProcessed(processed[x][y][z], FaceFlag::FRONT) && isExposed(x, y, z, 0, 0, 1, blockType)) {
+                if (!isFaceProcessed(processed[x][y - minY][z], FaceFlag::FRONT) && isExposed(x, y, z, 0, 0, 1, blockType)) {
                     processFace(x, y, z, 1);
-                    setFaceProcessed(processed[x][y][z], FaceFlag::FRONT);
+                    setFaceProcessed(processed[x][y - minY][z], FaceFlag::FRONT);
                 }
                 // Left face
-                if (!isFaceProcessed(processed[x][y][z], FaceFlag::LEFT) && isExposed(x, y, z, -1, 0, 0, blockType)) {
+                if (!isFaceProcessed(processed[x][y - minY][z], FaceFlag::LEFT) && isExposed(x, y, z, -1, 0, 0, blockType)) {
                     processFace(x, y, z, 2);
-                    setFaceProcessed(processed[x][y][z], FaceFlag::LEFT);
+                    setFaceProcessed(processed[x][y - minY][z], FaceFlag::LEFT);
                 }
                 // Right face
-                if (!isFaceProcessed(processed[x][y][z], FaceFlag::RIGHT) && isExposed(x, y, z, 1, 0, 0, blockType)) {
+                if (!isFaceProcessed(processed[x][y - minY][z], FaceFlag::RIGHT) && isExposed(x, y, z, 1, 0, 0, blockType)) {
                     processFace(x, y, z, 3);
-                    setFaceProcessed(processed[x][y][z], FaceFlag::RIGHT);
+                    setFaceProcessed(processed[x][y - minY][z], FaceFlag::RIGHT);
                 }
                 // Top face
-                if (!isFaceProcessed(processed[x][y][z], FaceFlag::TOP) && isExposed(x, y, z, 0, 1, 0, blockType)) {
+                if (!isFaceProcessed(processed[x][y - minY][z], FaceFlag::TOP) && isExposed(x, y, z, 0, 1, 0, blockType)) {
                     processFace(x, y, z, 4);
-                    setFaceProcessed(processed[x][y][z], FaceFlag::TOP);
+                    setFaceProcessed(processed[x][y - minY][z], FaceFlag::TOP);
                 }
                 // Bottom face
-                if (!isFaceProcessed(processed[x][y][z], FaceFlag::BOTTOM) && y > 0 && isExposed(x, y, z, 0, -1, 0, blockType)) {
+                if (!isFaceProcessed(processed[x][y - minY][z], FaceFlag::BOTTOM) && y > 0 && isExposed(x, y, z, 0, -1, 0, blockType)) {
                     processFace(x, y, z, 5);
-                    setFaceProcessed(processed[x][y][z], FaceFlag::BOTTOM);
+                    setFaceProcessed(processed[x][y - minY][z], FaceFlag::BOTTOM);
+                }
+            }
+        }
+    }
+}
+
+// Corner occlusion of a face for the binary mesher, isExposed(dx, dy, dz) tells whether the
+// neighbour at that offset lets light through. Same corner order as the other meshers
+template <typename IsExposed>
+static void calculateFaceAO(int8_t face, const IsExposed& isExposed, uint8_t ao[4])
+{
+    auto calculateAO = [](bool side1, bool side2, bool corner) -> uint8_t {
+        if (side1 && side2) return 0;
+        return side1 + side2 + corner;
+    };
+
+    switch (face) {
+    case 0: // Back face
+    case 1: // Front face
+    {
+        GLint dz = face == 1 ? 1 : 0;
+        ao[0] = calculateAO(isExposed(-1, 0, 0), isExposed(0, 1, 0), isExposed(-1, 1, dz));
+        ao[1] = calculateAO(isExposed(1, 0, 0), isExposed(0, 1, 0), isExposed(1, 1, dz));
+        ao[2] = calculateAO(isExposed(-1, 0, 0), isExposed(0, -1, 0), isExposed(-1, -1, dz));
+        ao[3] = calculateAO(isExposed(1, 0, 0), isExposed(0, -1, 0), isExposed(1, -1, dz));
+        break;
+    }
+    case 2: // Left face
+    case 3: // Right face
+        ao[0] = calculateAO(isExposed(0, 0, -1), isExposed(0, 1, 0), isExposed(0, 1, -1));
+        ao[1] = calculateAO(isExposed(0, 0, 1), isExposed(0, 1, 0), isExposed(0, 1, 1));
+        ao[2] = calculateAO(isExposed(0, 0, -1), isExposed(0, -1, 0), isExposed(0, -1, -1));
+        ao[3] = calculateAO(isExposed(0, 0, 1), isExposed(0, -1, 0), isExposed(0, -1, 1));
+        break;
+    case 5: // Bottom face
+        ao[0] = calculateAO(isExposed(0, 0, -1), isExposed(-1, 0, 0), isExposed(-1, 0, -1));
+        ao[1] = calculateAO(isExposed(0, 0, -1), isExposed(1, 0, 0), isExposed(1, 0, -1));
+        ao[2] = calculateAO(isExposed(0, 0, 1), isExposed(-1, 0, 0), isExposed(-1, 0, 1));
+        ao[3] = calculateAO(isExposed(0, 0, 1), isExposed(1, 0, 0), isExposed(1, 0, 1));
+        break;
+    default: // Top faces get no AO
+        break;
+    }
+}
+
+void Chunk::generateBinaryGreedyMesh(const ChunkSnapshot& snapshot, ChunkMesh& mesh, GLint section)
+{
+    // Every line of the padded snapshot becomes one bit row: bit i is set when padded coordinate i
+    // holds the block, so CHUNK_SIZE + 2 bits per row. Rows along x are indexed [y][z], rows along z [y][x].
+    // Only the section and one padding layer above and below it are turned into rows, y is section
+    // local in here and baseY + y is the chunk y
+    static constexpr GLint SIZE = ChunkSnapshot::SIZE;
+    static constexpr GLint HEIGHT = SECTION_SIZE + 2;
+    static constexpr GLint ROW_COUNT = SIZE * HEIGHT;
+    static constexpr uint32_t FULL_ROW = (1u << SIZE) - 1;
+    static constexpr uint32_t INNER_BITS = ((1u << CHUNK_SIZE) - 1) << 1;
+    static constexpr GLint PLANE_ROWS = CHUNK_SIZE * SECTION_SIZE;
+    const GLint baseY = section * SECTION_SIZE;
+    static constexpr uint8_t MAX_BLOCK_TYPES = 32;
+
+    const std::vector<int8_t>& blockTypes = snapshot.blockTypes;
+
+    std::vector<PackedVertex>& vertices = mesh.vertices;
+    std::vector<GLuint>& indices = mesh.indices;
+    std::vector<PackedVertex>& waterVertices = mesh.waterVertices;
+    std::vector<GLuint>& waterIndices = mesh.waterIndices;
+
+    vertices.clear();
+    indices.clear();
+    waterVertices.clear();
+    waterIndices.clear();
+    GLint vertexOffset = 0;
+    GLint waterVertexOffset = 0;
+
+    struct TypeSlot {
+        int8_t blockType;
+        bool isTransparent;
+        GLint minY, maxY; // Padded y range the type shows up in
+    };
+
+    std::vector<uint32_t> opaqueRowsX(ROW_COUNT, 0), opaqueRowsZ(ROW_COUNT, 0);
+    std::vector<uint32_t> typeRowsX, typeRowsZ;
+    // x bits of the lines that are entirely one type, per slot and y, spread over typeRowsX afterwards
+    std::vector<uint32_t> uniformLinesX;
+    std::vector<TypeSlot> slots;
+    typeRowsX.reserve(16 * ROW_COUNT);
+    typeRowsZ.reserve(16 * ROW_COUNT);
+    int8_t slotOfType[MAX_BLOCK_TYPES];
+    std::fill(std::begin(slotOfType), std::end(slotOfType), -1);
+
+    auto getSlot = [&](int8_t blockType, GLint y) {
+        int8_t& slot = slotOfType[blockType];
+        if (slot == -1) {
+            slot = static_cast<int8_t>(slots.size());
+            slots.push_back({ blockType, isTransparent(blockType), y, y });
+            typeRowsX.resize(typeRowsX.size() + ROW_COUNT, 0);
+            typeRowsZ.resize(typeRowsZ.size() + ROW_COUNT, 0);
+            uniformLinesX.resize(uniformLinesX.size() + HEIGHT, 0);
+        }
+        return slot;
+    };
+
+    auto extendSlotRange = [&](int8_t slot, GLint y) {
+        slots[slot].minY = std::min(slots[slot].minY, y);
+        slots[slot].maxY = std::max(slots[slot].maxY, y);
+    };
+
+    for (GLint x = 0; x < SIZE; ++x) {
+        uint32_t bitX = 1u << x;
+        for (GLint y = 0; y < HEIGHT; ++y) {
+            const int8_t* line = &blockTypes[(x * ChunkSnapshot::HEIGHT + baseY + y) * SIZE];
+            GLint rowZ = y * SIZE + x;
+
+            // Most lines are all air or all one block, air needs no bits at all and a uniform line
+            // is written a whole row at a time
+            uint64_t head, middle;
+            std::memcpy(&head, line, sizeof(head));
+            std::memcpy(&middle, line + 8, sizeof(middle));
+            uint64_t repeated = 0x0101010101010101ull * static_cast<uint8_t>(line[0]);
+            if (head == repeated && middle == repeated && line[16] == line[0] && line[17] == line[0]) {
+                if (line[0] == -1) continue;
+
+                int8_t slot = getSlot(line[0], y);
+                extendSlotRange(slot, y);
+                typeRowsZ[slot * ROW_COUNT + rowZ] = FULL_ROW;
+                uniformLinesX[slot * HEIGHT + y] |= bitX;
+                continue;
+            }
+
+            uint32_t lineSlots = 0;
+            for (GLint z = 0; z < SIZE; ++z) {
+                int8_t blockType = line[z];
+                if (blockType == -1) continue;
+
+                int8_t slot = getSlot(blockType, y);
+                lineSlots |= 1u << slot;
+                typeRowsX[slot * ROW_COUNT + y * SIZE + z] |= bitX;
+                typeRowsZ[slot * ROW_COUNT + rowZ] |= 1u << z;
+            }
+            for (; lineSlots; lineSlots &= lineSlots - 1) {
+                extendSlotRange(static_cast<int8_t>(std::countr_zero(lineSlots)), y);
+            }
+        }
+    }
+
+    // Anything that is neither opaque nor the same type lets a face show through
+    for (size_t slot = 0; slot < slots.size(); ++slot) {
+        uint32_t* rowsX = &typeRowsX[slot * ROW_COUNT];
+        const uint32_t* rowsZ = &typeRowsZ[slot * ROW_COUNT];
+        for (GLint y = slots[slot].minY; y <= slots[slot].maxY; ++y) {
+            if (uint32_t uniformBits = uniformLinesX[slot * HEIGHT + y]) {
+                for (GLint z = 0; z < SIZE; ++z) rowsX[y * SIZE + z] |= uniformBits;
+            }
+        }
+
+        if (slots[slot].isTransparent) continue;
+        for (GLint row = slots[slot].minY * SIZE; row < (slots[slot].maxY + 1) * SIZE; ++row) {
+            opaqueRowsX[row] |= rowsX[row];
+            opaqueRowsZ[row] |= rowsZ[row];
+        }
+    }
+
+    // Visible faces of one block type as CHUNK_SIZE bit rows without the border. Back/front planes are
+    // indexed [z][y] with x bits, left/right [x][y] with z bits and top/bottom [y][z] with x bits.
+    // Merging clears every bit it emits so the rows are all zero again for the next type
+    std::vector<uint16_t> faceRows(6 * PLANE_ROWS, 0);
+
+    // Turns the lowest run of set bits in a row into a quad and grows it over the following rows
+    // for as long as they contain the whole run. A quad carries a single light level, so the run stops
+    // where getLight(bit, row) changes and only grows over rows lit the same along all of it
+    auto mergePlane = [](uint16_t* rows, GLint firstRow, GLint lastRow, bool canMerge, auto&& getLight, auto&& emitQuad) {
+        for (GLint row = firstRow; row <= lastRow; ++row) {
+            while (rows[row]) {
+                GLint start = std::countr_zero(rows[row]);
+                GLint width = 1;
+                uint8_t lightLevel = getLight(start, row);
+                if (canMerge) {
+                    GLint maxWidth = std::countr_one(static_cast<uint16_t>(rows[row] >> start));
+                    while (width < maxWidth && getLight(start + width, row) == lightLevel) width++;
+                }
+                uint16_t run = static_cast<uint16_t>(((1u << width) - 1) << start);
+                auto isLitTheSame = [&](GLint otherRow) {
+                    for (GLint bit = start; bit < start + width; ++bit) {
+                        if (getLight(bit, otherRow) != lightLevel) return false;
+                    }
+                    return true;
+                };
+                GLint height = 1;
+                while (canMerge && row + height <= lastRow && (rows[row + height] & run) == run && isLitTheSame(row + height)) {
+                    rows[row + height] &= ~run;
+                    height++;
+                }
+                rows[row] &= ~run;
+                emitQuad(start, row, width, height, lightLevel);
+            }
+        }
+    };
+
+    for (size_t slot = 0; slot < slots.size(); ++slot) {
+        GLint blockType = slots[slot].blockType;
+        GLint minY = std::max(slots[slot].minY - 1, 0);
+        GLint maxY = std::min(slots[slot].maxY - 1, SECTION_SIZE - 1);
+        const uint32_t* rowsX = &typeRowsX[slot * ROW_COUNT];
+        const uint32_t* rowsZ = &typeRowsZ[slot * ROW_COUNT];
+
+        // Grass, flowers and torches are not cubes, they are added one block at a time
+        if (blockType == FLOWER1 || blockType == FLOWER2 || blockType == FLOWER3 || blockType == FLOWER4 || blockType == FLOWER5
+            || blockType == GRASS1 || blockType == GRASS2 || blockType == GRASS3 || blockType == DEADBUSH || blockType == TORCH) {
+            for (GLint y = minY; y <= maxY; ++y) {
+                for (GLint z = 0; z < CHUNK_SIZE; ++z) {
+                    uint32_t bits = rowsX[(y + 1) * SIZE + z + 1] & INNER_BITS;
+                    while (bits) {
+                        GLint x = std::countr_zero(bits) - 1;
+                        bits &= bits - 1;
+                        uint8_t lightLevel = snapshot.getLightLevel(snapshot.getIndex(x, baseY + y, z));
+                        if (blockType == TORCH) addTorch(vertices, indices, vertexOffset, x, baseY + y, z, lightLevel, blockType);
+                        else addGrassPlant(vertices, indices, vertexOffset, x, baseY + y, z, lightLevel, blockType);
+                    }
+                }
+            }
+            continue;
+        }
+
+        // A face is visible where the block sits next to a transparent block of another type
+        bool isWater = blockType == WATER;
+        for (GLint y = minY; y <= maxY; ++y) {
+            for (GLint i = 0; i < CHUNK_SIZE; ++i) {
+                GLint row = (y + 1) * SIZE + i + 1;
+
+                // i is z here, rows run along x
+                if (uint32_t solid = rowsX[row] & INNER_BITS) {
+                    auto visible = [&](GLint neighborRow) {
+                        return static_cast<uint16_t>((solid & ~(opaqueRowsX[neighborRow] | rowsX[neighborRow])) >> 1);
+                    };
+                    faceRows[0 * PLANE_ROWS + i * SECTION_SIZE + y] = visible(row - 1);
+                    faceRows[1 * PLANE_ROWS + i * SECTION_SIZE + y] = visible(row + 1);
+                    faceRows[4 * PLANE_ROWS + y * CHUNK_SIZE + i] = visible(row + SIZE);
+                    // The bottom of the world is never seen
+                    if (baseY + y > 0 || isWater) faceRows[5 * PLANE_ROWS + y * CHUNK_SIZE + i] = visible(row - SIZE);
+                }
+
+                // i is x here, rows run along z
+                if (uint32_t solid = rowsZ[row] & INNER_BITS) {
+                    auto visible = [&](GLint neighborRow) {
+                        return static_cast<uint16_t>((solid & ~(opaqueRowsZ[neighborRow] | rowsZ[neighborRow])) >> 1);
+                    };
+                    faceRows[2 * PLANE_ROWS + i * SECTION_SIZE + y] = visible(row - 1);
+                    faceRows[3 * PLANE_ROWS + i * SECTION_SIZE + y] = visible(row + 1);
                 }
             }
         }
+
+        std::vector<PackedVertex>& targetVertices = isWater ? waterVertices : vertices;
+        std::vector<GLuint>& targetIndices = isWater ? waterIndices : indices;
+        GLint& targetVertexOffset = isWater ? waterVertexOffset : vertexOffset;
+
+        for (int8_t face = 0; face < 6; ++face) {
+            GLint textureLayer = getTextureLayer(blockType, isWater ? 0 : face);
+            bool isSideFace = face < 4;
+
+            // Side planes are vertical slices with one row per y, top and bottom planes are y layers
+            GLint firstPlane = isSideFace ? 0 : minY;
+            GLint lastPlane = isSideFace ? CHUNK_SIZE - 1 : maxY;
+            GLint rowCount = isSideFace ? SECTION_SIZE : CHUNK_SIZE;
+            GLint firstRow = isSideFace ? minY : 0;
+            GLint lastRow = isSideFace ? maxY : CHUNK_SIZE - 1;
+
+            for (GLint plane = firstPlane; plane <= lastPlane; ++plane) {
+                auto getLight = [&](GLint bit, GLint row) {
+                    GLint x = face < 2 ? bit : face < 4 ? plane : bit;
+                    GLint y = isSideFace ? row : plane;
+                    GLint z = face < 2 ? plane : face < 4 ? bit : row;
+                    return snapshot.getLightLevel(snapshot.getIndex(x, baseY + y, z));
+                };
+
+                // Water is kept one quad per block face like in the other meshers
+                mergePlane(&faceRows[face * PLANE_ROWS + plane * rowCount], firstRow, lastRow, !isWater, getLight, [&](GLint start, GLint row, GLint width, GLint height, uint8_t lightLevel) {
+                    GLint x = face < 2 ? start : face < 4 ? plane : start;
+                    GLint y = isSideFace ? row : plane;
+                    GLint chunkY = baseY + y;
+                    GLint z = face < 2 ? plane : face < 4 ? start : row;
+
+                    uint8_t ao[4] = { 0, 0, 0, 0 };
+                    if (!isWater && world->getAOState()) {
+                        calculateFaceAO(face, [&](GLint dx, GLint dy, GLint dz) {
+                            GLint row = (y + dy + 1) * SIZE + x + dx + 1;
+                            return ((opaqueRowsZ[row] | rowsZ[row]) >> (z + dz + 1) & 1) == 0;
+                        }, ao);
+                    }
+
+                    switch (face) {
+                    case 0: Block::addBackFace(targetVertices, targetIndices, targetVertexOffset, x, chunkY, z, width, height, textureLayer, lightLevel, ao); break;
+                    case 1: Block::addFrontFace(targetVertices, targetIndices, targetVertexOffset, x, chunkY, z, width, height, textureLayer, lightLevel, ao); break;
+                    case 2: Block::addLeftFace(targetVertices, targetIndices, targetVertexOffset, x, chunkY, z, width, height, textureLayer, lightLevel, ao); break;
+                    case 3: Block::addRightFace(targetVertices, targetIndices, targetVertexOffset, x, chunkY, z, width, height, textureLayer, lightLevel, ao); break;
+                    case 4: Block::addTopFace(targetVertices, targetIndices, targetVertexOffset, x, chunkY, z, width, height, textureLayer, lightLevel, ao); break;
+                    case 5: Block::addBottomFace(targetVertices, targetIndices, targetVertexOffset, x, chunkY, z, width, height, textureLayer, lightLevel, ao); break;
+                    }
+                });
+            }
+        }
     }
 }
 
@@ -927,7 +1336,7 @@ GLint Chunk::getTextureLayer(int8_t blockType, int8_t face)
     }
 }
 
-void Chunk::addTorch(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType)
+void Chunk::addTorch(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType)
 {
     GLfloat torchHeight = 1.5f;
 
@@ -970,16 +1379,8 @@ void Chunk::addTorch(std::vector<GLfloat>& vertices, std::vector<GLuint>& indice
         { 0.0f, 1.0f }
     };
 
-    GLfloat torchLightLevel = 1.0f;
-    GLfloat torchAO = 1.0f;
-
-    GLfloat normals[5][3] = {
-        {  0.0f,  0.0f, -1.0f }, // Front face
-        {  0.0f,  0.0f,  1.0f }, // Back face
-        { -1.0f,  0.0f,  0.0f }, // Left face
-        {  1.0f,  0.0f,  0.0f }, // Right face
-        {  0.0f,  1.0f,  0.0f }  // Top face only
-    };
+    uint8_t torchLightLevel = 15;
+    uint8_t torchAO = 0;
 
     GLfloat positions[5][4][3] = {
         // Front face
@@ -1027,14 +1428,9 @@ void Chunk::addTorch(std::vector<GLfloat>& vertices, std::vector<GLuint>& indice
 
         for (uint8_t i = 0; i < 4; ++i)
         {
-            vertices.insert(vertices.end(), {
-                positions[face][i][0], positions[face][i][1], positions[face][i][2],  // Position
-                texCoords[i][0], texCoords[i][1],                                     // Texture coordinates
-                (GLfloat)textureLayer,                                                // Texture layer
-                normals[face][0], normals[face][1], normals[face][2],                 // Normal
-                torchLightLevel,                                                      // Light level
-                torchAO                                                               // Ambient occlusion
-            });
+            // Positions snap to the 1/16 grid of the packed format, faces[face] doubles as the normal index
+            vertices.push_back(Block::packVertex(positions[face][i][0], positions[face][i][1], positions[face][i][2],
+                texCoords[i][0], texCoords[i][1], faces[face], textureLayer, torchLightLevel, torchAO));
         }
 
         indices.insert(indices.end(), {
@@ -1046,7 +1442,7 @@ void Chunk::addTorch(std::vector<GLfloat>& vertices, std::vector<GLuint>& indice
     }
 }
 
-void Chunk::addGrassPlant(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType)
+void Chunk::addGrassPlant(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType)
 {
     GLfloat size = 0.5f;
     GLfloat centerX = x + 0.5f;
@@ -1075,25 +1471,19 @@ void Chunk::addGrassPlant(std::vector<GLfloat>& vertices, std::vector<GLuint>& i
     };
 
     GLint textureLayer = getTextureLayer(blockType, 0);
-    GLfloat normal[3] = { 0.0f, 1.0f, 0.0f };
-    GLfloat grassLightLevel = 1.0f;
-    GLfloat grassAO = 1.0f;
+    uint8_t grassLightLevel = 15;
+    uint8_t grassAO = 0;
 
-    vertices.reserve(vertices.size() + 8 * 10);
+    vertices.reserve(vertices.size() + 8);
     indices.reserve(indices.size() + 6 * 2);
 
     for (int8_t quad = 0; quad < 2; ++quad)
     {
         for (int8_t i = 0; i < 4; ++i)
         {
-            vertices.insert(vertices.end(), {
-                positions[quad][i][0], positions[quad][i][1], positions[quad][i][2],   // Position
-                texCoords[i][0], texCoords[i][1],                                      // Texture coordinates
-                (GLfloat)textureLayer,                                                 // Texture layer
-                normal[0], normal[1], normal[2],                                       // Normal
-                grassLightLevel,                                                       // Light level
-                grassAO                                                                // Ambient occlusion
-            });
+            // Plants are lit as if they faced up
+            vertices.push_back(Block::packVertex(positions[quad][i][0], positions[quad][i][1], positions[quad][i][2],
+                texCoords[i][0], texCoords[i][1], TOP, textureLayer, grassLightLevel, grassAO));
         }
 
         indices.insert(indices.end(), {
@@ -1109,13 +1499,28 @@ GLint Chunk::getBlockType(GLint x, GLint y, GLint z) const {
         return -1;
     }
 
-    GLint index = x * CHUNK_HEIGHT * CHUNK_SIZE + y * CHUNK_SIZE + z;
-    return blockTypes[index];
+    std::shared_lock<std::shared_mutex> lock(blockDataMutex);
+    return getStoredBlock(x, y, z);
+}
+
+size_t Chunk::getBlockMemoryUsage() const
+{
+    std::shared_lock<std::shared_mutex> lock(blockDataMutex);
+    size_t bytes = 0;
+    for (const PalettedSection& section : sections) {
+        bytes += section.getMemoryUsage();
+    }
+    return bytes;
 }
 
-const std::vector<GLint>& Chunk::getBlockTypes() const
+size_t Chunk::getLightMemoryUsage() const
 {
-    return blockTypes;
+    std::shared_lock<std::shared_mutex> lock(blockDataMutex);
+    size_t bytes = 0;
+    for (const SectionLight& sectionLight : light) {
+        bytes += sectionLight.getMemoryUsage();
+    }
+    return bytes;
 }
 
 void Chunk::setBlockType(GLint x, GLint y, GLint z, int8_t type)
@@ -1124,25 +1529,38 @@ void Chunk::setBlockType(GLint x, GLint y, GLint z, int8_t type)
         return;
     }
 
-    GLint index = x * CHUNK_HEIGHT * CHUNK_SIZE + y * CHUNK_SIZE + z;
-    if (blockTypes[index] != type) {
-        blockTypes[index] = type;
-        needsMeshUpdate = true;
-    }
+    std::unique_lock<std::shared_mutex> lock(blockDataMutex);
+    setStoredBlock(x, y, z, type);
+}
+
+bool Chunk::setStoredBlock(GLint x, GLint y, GLint z, int8_t type)
+{
+    if (getStoredBlock(x, y, z) == type) return false;
+
+    sections[y / SECTION_SIZE].set(PalettedSection::getIndex(x, y % SECTION_SIZE, z), type);
+    markSectionsDirty(getSectionsAround(y));
+    hasUnsavedChanges = true;
+    return true;
 }
 
-void Chunk::Draw()
+void Chunk::Draw(shader& chunkShader)
 {
-    if (indices.empty()) return;
+    if (std::none_of(sectionBuffers.begin(), sectionBuffers.end(), [](const SectionBuffers& buffers) { return buffers.indexCount > 0; })) return;
+
+    // Vertex positions are chunk local, the shader moves them into place
+    chunkShader.setVec3("chunkOffset", glm::vec3(chunkX * CHUNK_SIZE, 0.0f, chunkZ * CHUNK_SIZE));
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDisable(GL_CULL_FACE);
 
-    glBindVertexArray(VAO);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    for (const SectionBuffers& buffers : sectionBuffers) {
+        if (buffers.indexCount == 0) continue;
+        glBindVertexArray(buffers.VAO);
+        glDrawElements(GL_TRIANGLES, buffers.indexCount, GL_UNSIGNED_INT, 0);
+    }
     glBindVertexArray(0);
 
     glEnable(GL_CULL_FACE);
@@ -1153,133 +1571,117 @@ void Chunk::Draw()
 
 void Chunk::DrawWater(shader& waterShader, glm::mat4 view, glm::mat4 projection, glm::vec3 lightDirection, Camera& camera)
 {
-    if (waterIndices.empty()) return;
+    if (std::none_of(waterSectionBuffers.begin(), waterSectionBuffers.end(), [](const SectionBuffers& buffers) { return buffers.indexCount > 0; })) return;
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    GLfloat timeValue = glfwGetTime();
-    GLfloat waveSpeed = 2.3f;
-    GLfloat waveFrequency = 1.2f;
-    GLfloat waveAmplitude = 0.05f;
-
-    std::vector<GLfloat> modifiedWaterVertices = waterVertices;
-
-    for (size_t i = 0; i < modifiedWaterVertices.size(); i += 11)
-    {
-        GLfloat x = modifiedWaterVertices[i];
-        GLfloat z = modifiedWaterVertices[i + 2];
-
-        modifiedWaterVertices[i + 1] += sin(x * waveFrequency + timeValue * waveSpeed) * waveAmplitude +
-                                        cos(z * waveFrequency + timeValue * waveSpeed) * waveAmplitude;
-    }
-
-    glBindBuffer(GL_ARRAY_BUFFER, waterVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, modifiedWaterVertices.size() * sizeof(GLfloat), modifiedWaterVertices.data());
-
+    // Waves are animated in water.vs, so the uploaded water mesh stays untouched between rebuilds
     waterShader.use();
+    waterShader.setFloat("time", static_cast<GLfloat>(glfwGetTime()));
+    waterShader.setVec3("chunkOffset", glm::vec3(chunkX * CHUNK_SIZE, 0.0f, chunkZ * CHUNK_SIZE));
     waterShader.setMat4("model", glm::mat4(1.0f));
     waterShader.setMat4("view", view);
     waterShader.setMat4("projection", projection);
     waterShader.setVec3("lightDirection", lightDirection);
     waterShader.setVec3("viewPos", camera.getPosition());
 
-    glBindVertexArray(waterVAO);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
-    glDrawElements(GL_TRIANGLES, waterIndices.size(), GL_UNSIGNED_INT, 0);
+    for (const SectionBuffers& buffers : waterSectionBuffers) {
+        if (buffers.indexCount == 0) continue;
+        glBindVertexArray(buffers.VAO);
+        glDrawElements(GL_TRIANGLES, buffers.indexCount, GL_UNSIGNED_INT, 0);
+    }
 
     glDisable(GL_BLEND);
 
     glBindVertexArray(0);
 }
 
-void Chunk::updateOpenGLBuffers()
+size_t Chunk::uploadSectionMesh(SectionBuffers& buffers, const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices)
 {
-    if (VAO == 0)
+    buffers.indexCount = static_cast<GLsizei>(indices.size());
+
+    // Sections without geometry give their buffers back instead of keeping empty ones around
+    if (indices.empty()) {
+        deleteSectionBuffers(buffers);
+        return 0;
+    }
+
+    if (buffers.VAO == 0)
     {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        glGenVertexArrays(1, &buffers.VAO);
+        glGenBuffers(1, &buffers.VBO);
+        glGenBuffers(1, &buffers.EBO);
     }
 
-    glBindVertexArray(VAO);
+    glBindVertexArray(buffers.VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)0);
+    // Packed position and ambient occlusion
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
     glEnableVertexAttribArray(0);
 
-    // Texture coordinate attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+    // Packed face, light level, texture layer and texture coordinates
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, attributes));
     glEnableVertexAttribArray(1);
 
-    // Texture layer attribute
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(2);
-    
-    // Normal attribute
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(3);
-
-    // Light level attribute
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(9 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(4);
-
-    // Ambient occlusion attribute
-    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(10 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(5);
-
     glBindVertexArray(0);
+
+    return vertices.size() * sizeof(PackedVertex) + indices.size() * sizeof(GLuint);
 }
 
-void Chunk::updateOpenGLWaterBuffers()
+void Chunk::releaseBuffers(std::vector<GLuint>& vertexArrays, std::vector<GLuint>& buffers)
 {
-    if (waterVAO == 0)
-    {
-        glGenVertexArrays(1, &waterVAO);
-        glGenBuffers(1, &waterVBO);
-        glGenBuffers(1, &waterEBO);
+    for (SectionBuffers* sectionBufferSet : { sectionBuffers.data(), waterSectionBuffers.data() }) {
+        for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+            SectionBuffers& released = sectionBufferSet[section];
+            if (released.VAO == 0) continue;
+
+            vertexArrays.push_back(released.VAO);
+            buffers.push_back(released.VBO);
+            buffers.push_back(released.EBO);
+            released = SectionBuffers();
+        }
     }
+}
 
-    glBindVertexArray(waterVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, waterVBO);
-    glBufferData(GL_ARRAY_BUFFER, waterVertices.size() * sizeof(GLfloat), waterVertices.data(), GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, waterEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, waterIndices.size() * sizeof(GLuint), waterIndices.data(), GL_STATIC_DRAW);
-
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Texture coordinate attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(1);
-
-    // Texture layer attribute
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(2);
-
-    // Normal attribute
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(3);
+void Chunk::deleteSectionBuffers(SectionBuffers& buffers)
+{
+    if (buffers.VAO == 0) return;
 
-    // Light level attribute
-    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(9 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(4);
+    glDeleteVertexArrays(1, &buffers.VAO);
+    glDeleteBuffers(1, &buffers.VBO);
+    glDeleteBuffers(1, &buffers.EBO);
+    buffers = SectionBuffers();
+}
 
-    // Ambient occlusion attribute
-    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (void*)(10 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(5);
+size_t Chunk::updateOpenGLBuffers()
+{
+    size_t bytes = 0;
+    for (; unuploadedSections; unuploadedSections &= unuploadedSections - 1) {
+        GLint section = std::countr_zero(unuploadedSections);
+        const ChunkMesh& mesh = meshBuffers[section][(frontMeshMask >> section) & 1];
+        bytes += uploadSectionMesh(sectionBuffers[section], mesh.vertices, mesh.indices);
+    }
+    return bytes;
+}
 
-    glBindVertexArray(0);
+size_t Chunk::updateOpenGLWaterBuffers()
+{
+    size_t bytes = 0;
+    for (; unuploadedWaterSections; unuploadedWaterSections &= unuploadedWaterSections - 1) {
+        GLint section = std::countr_zero(unuploadedWaterSections);
+        const ChunkMesh& mesh = meshBuffers[section][(frontMeshMask >> section) & 1];
+        bytes += uploadSectionMesh(waterSectionBuffers[section], mesh.waterVertices, mesh.waterIndices);
+    }
+    return bytes;
 }
 
 void Chunk::calculateBounds() {
@@ -1288,6 +1690,5 @@ void Chunk::calculateBounds() {
 }
 
 bool Chunk::isInFrustum(const Frustum& frustum) const {
-    if (!isInitialized) return false;
     return frustum.isBoxInFrustum(minBounds, maxBounds);
 }
\ No newline at end of file
@@ -6,42 +6,119 @@
 #include "Structure.h"
 #include "shader.h"
 #include "Camera.h"
-#include "Biomes.h"
+#include "TerrainGenerator.h"
+#include "PalettedSection.h"
+#include "SectionLight.h"
+#include "ChunkState.h"
 #include <numeric>
+#include <atomic>
+#include <shared_mutex>
+#include <bit>
+#include <cstring>
+#include <array>
+#include <algorithm>
 
 class World;
 
 constexpr uint8_t CHUNK_SIZE = 16;
 constexpr uint8_t CHUNK_HEIGHT = 128;
 constexpr uint8_t WATERLEVEL = 62;
+constexpr uint8_t CHUNK_SECTIONS = CHUNK_HEIGHT / SECTION_SIZE;
+constexpr uint8_t ALL_SECTIONS = static_cast<uint8_t>((1u << CHUNK_SECTIONS) - 1);
+static_assert(CHUNK_SIZE == SECTION_SIZE, "sections span the full width of a chunk");
+static_assert(CHUNK_SECTIONS <= 8, "section masks are 8 bits");
+
+// What a section holds as far as meshing and light are concerned
+enum class SectionState : uint8_t {
+	Empty,	// Only air, never meshed and sunlight passes straight through
+	Opaque,	// Only blocks light can't pass, faces can only show where it touches another section
+	Mixed
+};
 
-struct BiomeData {
-	GLfloat minThreshold, maxThreshold;
-	BiomeTypes type;
-	GLfloat baseFrequency;
-	GLfloat caveThreshold;
-	GLfloat edge0, edge1, edge2, edge3;
+// Copy of a chunk's blocks and light plus a one block border from its 8 neighbours,
+// everything generateMesh needs so it never has to look at the live world
+struct ChunkSnapshot {
+	static constexpr GLint SIZE = CHUNK_SIZE + 2;
+	static constexpr GLint HEIGHT = CHUNK_HEIGHT + 2;
+	static constexpr GLint VOLUME = SIZE * HEIGHT * SIZE;
+
+	std::vector<int8_t> blockTypes;
+	// Sky and block light packed like SectionLight stores them
+	std::vector<uint8_t> light;
+	// Section states of the chunk and its neighbours indexed [(dx + 1) * 3 + (dz + 1)][section],
+	// missing neighbours read as air like their blocks do
+	std::array<std::array<SectionState, CHUNK_SECTIONS>, 9> sectionStates;
+
+	// Takes chunk local coordinates, -1 and CHUNK_SIZE/CHUNK_HEIGHT address the border
+	GLint getIndex(GLint x, GLint y, GLint z) const { return (x + 1) * HEIGHT * SIZE + (y + 1) * SIZE + (z + 1); }
+	// The light level the mesher bakes into a face, whichever channel is brighter
+	uint8_t getLightLevel(GLint index) const { return SectionLight::getLightLevel(light[index]); }
+
+	// True when a section has no blocks or is opaque and walled in by opaque sections on all sides
+	bool hasNoVisibleFaces(GLint section) const;
 };
 
-extern std::vector<BiomeData> biomes;
+// CPU side geometry of one section of a chunk, built by generateMesh into the section's back buffer
+struct ChunkMesh {
+	std::vector<PackedVertex> vertices;
+	std::vector<GLuint> indices;
+	std::vector<PackedVertex> waterVertices;
+	std::vector<GLuint> waterIndices;
+};
 
 class Chunk
 {
 public:
-	Chunk(GLint x, GLint z, TextureManager& textureManager, World* world);
+	// Restores the chunk from savedData when it is given and readable, otherwise generates its terrain
+	Chunk(GLint x, GLint z, TextureManager& textureManager, World* world, const std::vector<uint8_t>* savedData = nullptr);
 	~Chunk();
 
-	void Draw();
+	void Draw(shader& chunkShader);
 	void DrawWater(shader& waterShader, glm::mat4 view, glm::mat4 projection, glm::vec3 lightDirection, Camera& camera);
 	void setupChunk();
-	void updateOpenGLBuffers();
-	void updateOpenGLWaterBuffers();
-
-	void generateMesh(const std::vector<GLint>& blockTypes);
+	size_t updateOpenGLBuffers();
+	size_t updateOpenGLWaterBuffers();
+	// Hands the names of the chunk's GL objects to the caller to delete in bulk, the chunk forgets them
+	void releaseBuffers(std::vector<GLuint>& vertexArrays, std::vector<GLuint>& buffers);
+
+	ChunkSnapshot captureSnapshot() const;
+	// Meshes the blocks of one section, the snapshot supplies the blocks around it
+	void generateMesh(const ChunkSnapshot& snapshot, ChunkMesh& mesh, GLint section);
+	// Greedy mesher working on bit rows of the snapshot instead of one block at a time
+	void generateBinaryGreedyMesh(const ChunkSnapshot& snapshot, ChunkMesh& mesh, GLint section);
+	// Rebuilds the back buffers of the sections in the mask, the others keep their current mesh
+	void buildBackMesh(uint8_t sectionMask);
+	// Swaps the back buffers to the front and moves the chunk to Uploaded, the caller uploads them right away
+	bool publishBackMesh();
+	bool hasUnpublishedMesh() const { return getState() == ChunkState::MeshReady; }
 	GLint getBlockType(GLint x, GLint y, GLint z) const;
-	const std::vector<GLint>& getBlockTypes() const;
 	void setBlockType(GLint x, GLint y, GLint z, int8_t type);
-	GLint getTerrainHeightAt(GLint x, GLint z);
+
+	// Unlocked block and light access for jobs that lock several chunks at once, callers hold
+	// blockDataMutex or own the chunk exclusively
+	GLint getStoredBlock(GLint x, GLint y, GLint z) const { return sections[y / SECTION_SIZE].get(PalettedSection::getIndex(x, y % SECTION_SIZE, z)); }
+	// Returns false when the block already had that type, otherwise marks the affected sections dirty
+	bool setStoredBlock(GLint x, GLint y, GLint z, int8_t type);
+	uint8_t getStoredLight(GLint x, GLint y, GLint z) const { return light[y / SECTION_SIZE].get(PalettedSection::getIndex(x, y % SECTION_SIZE, z)); }
+	void setStoredLight(GLint x, GLint y, GLint z, uint8_t value) { light[y / SECTION_SIZE].set(PalettedSection::getIndex(x, y % SECTION_SIZE, z), value); }
+	const SectionLight& getSectionLight(GLint section) const { return light[section]; }
+	void fillLight(GLint section, uint8_t value) { light[section].fill(value); }
+	// Shrinks the light of the sections in the mask back to a single value where possible
+	void compactLight(uint8_t sectionMask);
+	SectionState getSectionState(GLint section) const;
+	// Can report blocks that were since overwritten, never misses one
+	bool mayContainBlock(GLint section, int8_t blockType) const;
+
+	static bool isTransparent(GLint blockType)
+	{
+		return blockType == -1 || blockType == WATER || blockType == OAK_LEAF || blockType == OAK_LEAF_ORANGE || blockType == OAK_LEAF_YELLOW || blockType == GLASS ||
+			blockType == FLOWER1 || blockType == FLOWER2 || blockType == FLOWER3 || blockType == FLOWER4 || blockType == FLOWER5 || blockType == GRASS1 || blockType == GRASS2 ||
+			blockType == GRASS3 || blockType == DEADBUSH || blockType == OAK_LEAF_PURPLE || blockType == TORCH;
+	}
+	// Heap bytes held by the block sections
+	size_t getBlockMemoryUsage() const;
+	// Heap bytes held by the light sections
+	size_t getLightMemoryUsage() const;
 
 	bool isInFrustum(const Frustum& frustum) const;
 	glm::vec3 getMinBounds() const { return minBounds; }
@@ -50,64 +127,113 @@ public:
 	GLint getChunkX() const { return chunkX; }
 	GLint getChunkZ() const { return chunkZ; }
 
-	bool isLoaded() const { return isInitialized; }
-
-	void recalculateSunlightColumn(GLint x, GLint z);
+	ChunkState getState() const { return state.load(std::memory_order_acquire); }
+	// True once the chunk went through the stage, false again once it is unloading
+	bool hasReached(ChunkState stage) const
+	{
+		ChunkState current = getState();
+		return current >= stage && current != ChunkState::Unloading;
+	}
+	// False when the chunk is no longer in from, most often because it started unloading meanwhile and the
+	// work that led here can be dropped. The transition itself must be one the pipeline makes
+	bool advanceState(ChunkState from, ChunkState to);
+	void beginUnloading();
+	// The state the chunk was in when it started unloading, its current state before that. Main thread only
+	ChunkState getStateBeforeUnloading() const { return isUnloading() ? stateBeforeUnloading : getState(); }
+
+	// Lights the chunk from the sky and its own emitters, light coming from the neighbours is added
+	// later by LightEngine::spreadAcrossBorders. Runs once as part of decoration, before the chunk has any light
+	void calculateLight();
+	// Sections whose mesh can change when the block at y does, its own and the one it borders
+	static uint8_t getSectionsAround(GLint y);
+	void markSectionsDirty(uint8_t sectionMask) { dirtySections.fetch_or(sectionMask); }
+	// Moves the sections waiting to be remeshed over to editedSections, so they are remeshed in the urgent lane
+	void markDirtySectionsEdited()
+	{
+		if (uint8_t sections = dirtySections.exchange(0)) editedSections.fetch_or(sections);
+	}
+	bool hasDirtySections() const { return (dirtySections | editedSections) != 0; }
+	bool isUnloading() const { return getState() == ChunkState::Unloading; }
+
+	// Appends the blocks, the structure anchors and whether decoration has run in the format the constructor
+	// restores. Light is left out, it is cheaper to calculate again than to store. Not while decoration runs,
+	// the caller holds blockDataMutex. Main thread only
+	void save(std::vector<uint8_t>& out) const;
+
+	// Builds the parts of the structures anchored in this chunk and its 8 neighbours that fall inside this
+	// chunk, neighbourhood is indexed [(dx + 1) * 3 + (dz + 1)] and every entry must have its terrain
+	void decorate(const std::array<const Chunk*, 9>& neighbourhood);
+	// Writes a block given in world coordinates, dropped when it lies outside this chunk
+	void placeBlockIfInChunk(GLint globalX, GLint y, GLint globalZ, GLint blockType);
+	bool containsColumn(GLint globalX, GLint globalZ) const;
 
 	GLfloat chunkX, chunkZ;
-	std::vector<GLint> blockTypes;
-	std::vector<uint8_t> lightLevels;
+
+	// Structures rooted in this chunk, written by the terrain stage and read only afterwards
+	std::vector<StructureAnchor> structureAnchors;
 
 	World* world;
-	bool needsMeshUpdate = false;
+	// Set when the blocks differ from what was last saved, by decoration and by edits
+	std::atomic<bool> hasUnsavedChanges = false;
+	// Sections waiting to be remeshed, a mesh job takes the whole mask at once
+	std::atomic<uint8_t> dirtySections = 0;
+	// Sections a player edit changed, their mesh job runs ahead of streaming work
+	std::atomic<uint8_t> editedSections = 0;
+	// Main thread only. Set while the back mesh holds a player edit, its upload doesn't wait for the budget
+	bool hasEditedBackMesh = false;
+
+	// Guards sections and light, writers take it exclusively while meshing holds it shared
+	mutable std::shared_mutex blockDataMutex;
 
 private:
 	void generateChunk();
+	// Loads what save wrote, leaves the chunk untouched and returns false when the data is unreadable
+	bool restore(const std::vector<uint8_t>& data, bool& wasDecorated);
 	void calculateBounds();
-	void placeBlockIfInChunk(GLint globalX, GLint y, GLint globalZ, GLint blockType);
 	inline GLint getIndex(GLint x, GLint y, GLint z) const;
-	inline bool isTransparent(GLint blockType);
 	GLint getTextureLayer(int8_t blockType, int8_t face);
 
-	void addGrassPlant(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType);
-	void addTorch(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType);
+	void addGrassPlant(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType);
+	void addTorch(std::vector<PackedVertex>& vertices, std::vector<GLuint>& indices, GLint& vertexOffset, GLint x, GLint y, GLint z, uint8_t lightLevel, GLint blockType);
 
-	Biomes determineBiomeType(GLint x, GLint z);
-	const BiomeData* selectBiome(GLfloat noiseValue);
-	const Biomes* getBiomeInstance(BiomeTypes type) const;
-	GLfloat smoothstep(GLfloat edge0, GLfloat edge1, GLfloat x);
+	struct SectionBuffers {
+		GLuint VAO = 0, VBO = 0, EBO = 0;
+		GLsizei indexCount = 0;
+	};
 
-	GLuint textureID;
-	FastNoiseLite noiseGenerator;
-	std::vector<GLfloat> vertices;
-	std::vector<GLuint> indices;
-	GLuint VAO = 0, VBO = 0, EBO = 0;
+	static size_t uploadSectionMesh(SectionBuffers& buffers, const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices);
+	static void deleteSectionBuffers(SectionBuffers& buffers);
 
-	std::vector<GLfloat> waterVertices;
-	std::vector<GLuint> waterIndices;
-	GLuint waterVAO = 0, waterVBO = 0, waterEBO = 0;
+	GLuint textureID;
+	// Light only crosses a chunk's borders once its whole 3x3 neighbourhood is decorated, and a chunk is
+	// only meshed once its whole neighbourhood is lit since any of them can still change its light
+	std::atomic<ChunkState> state = ChunkState::Generating;
+	// Set by beginUnloading, main thread only
+	ChunkState stateBeforeUnloading = ChunkState::Generating;
+	ChunkStateCounts& stateCounts;
+
+	// Every section is double buffered. The render thread only reads front buffers, a worker only writes
+	// the back buffers of backMeshSections while Meshing, and MeshReady hands them over with release/acquire ordering
+	ChunkMesh meshBuffers[CHUNK_SECTIONS][2];
+	// Bit s selects which of meshBuffers[s] is the front one
+	uint8_t frontMeshMask = 0;
+	uint8_t backMeshSections = 0;
+
+	// Published sections whose GPU buffers are out of date
+	uint8_t unuploadedSections = 0;
+	uint8_t unuploadedWaterSections = 0;
+	std::array<SectionBuffers, CHUNK_SECTIONS> sectionBuffers;
+	std::array<SectionBuffers, CHUNK_SECTIONS> waterSectionBuffers;
+
+	// Blocks in 16 high slices from the bottom up, each with its own palette
+	std::array<PalettedSection, CHUNK_SECTIONS> sections;
+	std::array<SectionLight, CHUNK_SECTIONS> light;
 
 	glm::vec3 minBounds;
 	glm::vec3 maxBounds;
-	bool isInitialized = false;
-
-	std::vector<std::vector<std::vector<GLint>>> chunkData;
-	TextureManager& textureManager;
-
-	FastNoiseLite biomeNoise, caveNoise;
-	Biomes forestBiome, desertBiome, plainsBiome, mountainBiome;
 
-	std::vector<BiomeData> biomes = {
-		{0.0f, 0.33f, BiomeTypes::Desert, 0.0011f, 0.5f, 0.2f, 0.4f, 0.0f, 0.0f},
-		{0.33f, 0.5f, BiomeTypes::Plains, 0.0003f, 0.98f, 0.3f, 0.4f, 0.6f, 0.7f},
-		{0.5f, 0.8f, BiomeTypes::Forest, 0.002f, 0.85f, 0.6f, 0.8f, 0.0f, 0.0f},
-		{0.8f, 1.0f, BiomeTypes::Mountain, 0.005f, 0.9f, 0.6f, 0.7f, 0.6f, 0.8f}
-	};
+	// Bumped whenever the saved layout changes, older payloads are generated again instead
+	static constexpr uint8_t SAVE_VERSION = 2;
 
-	std::unordered_map<BiomeTypes, Biomes*> biomeInstances = {
-		{BiomeTypes::Desert, &desertBiome},
-		{BiomeTypes::Plains, &plainsBiome},
-		{BiomeTypes::Forest, &forestBiome},
-		{BiomeTypes::Mountain, &mountainBiome}
-	};
+	TextureManager& textureManager;
 };
\ No newline at end of file
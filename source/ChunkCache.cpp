@@ -0,0 +1,50 @@
+#include "ChunkCache.h"
+
+void ChunkCache::insert(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t> payload)
+{
+	int32_t key = getChunkKey(chunkX, chunkZ);
+	auto it = entriesByChunk.find(key);
+	if (it != entriesByChunk.end()) {
+		memoryUsage -= it->second->payload.capacity();
+		entries.erase(it->second);
+		entriesByChunk.erase(it);
+	}
+
+	// Payloads are built by appending, trimming them keeps the budget honest
+	payload.shrink_to_fit();
+	memoryUsage += payload.capacity();
+	entries.push_front({ key, std::move(payload) });
+	entriesByChunk[key] = entries.begin();
+	evictToBudget();
+}
+
+bool ChunkCache::take(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t>& out)
+{
+	auto it = entriesByChunk.find(getChunkKey(chunkX, chunkZ));
+	if (it == entriesByChunk.end()) {
+		++misses;
+		return false;
+	}
+
+	++hits;
+	memoryUsage -= it->second->payload.capacity();
+	out = std::move(it->second->payload);
+	entries.erase(it->second);
+	entriesByChunk.erase(it);
+	return true;
+}
+
+void ChunkCache::setMemoryBudget(size_t budget)
+{
+	memoryBudget = budget;
+	evictToBudget();
+}
+
+void ChunkCache::evictToBudget()
+{
+	while (memoryUsage > memoryBudget && !entries.empty()) {
+		memoryUsage -= entries.back().payload.capacity();
+		entriesByChunk.erase(entries.back().key);
+		entries.pop_back();
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+// Recently unloaded chunks kept in memory as the palette compressed payloads Chunk::save writes, so
+// walking back and forth over the load distance border restores chunks instead of generating them.
+// Unlike region storage it also keeps chunks that only have their terrain yet, which is what the
+// outer rings of the load area are. Once the payloads outgrow the budget the chunks unloaded longest
+// ago are dropped. Main thread only
+class ChunkCache
+{
+public:
+	explicit ChunkCache(size_t memoryBudget) : memoryBudget(memoryBudget) {}
+
+	// Keeps the payload of a chunk that just unloaded
+	void insert(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t> payload);
+	// Moves the payload out when the chunk is cached, a loaded chunk is never kept here as well.
+	// Every call counts as a hit or a miss
+	bool take(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t>& out);
+
+	void setMemoryBudget(size_t budget);
+	size_t getMemoryBudget() const { return memoryBudget; }
+	size_t getMemoryUsage() const { return memoryUsage; }
+	size_t getChunkCount() const { return entries.size(); }
+	GLuint getHitCount() const { return hits; }
+	GLuint getMissCount() const { return misses; }
+
+private:
+	struct Entry {
+		int32_t key;
+		std::vector<uint8_t> payload;
+	};
+
+	static int32_t getChunkKey(int16_t chunkX, int16_t chunkZ) { return (static_cast<int32_t>(chunkX) << 16) | static_cast<uint16_t>(chunkZ); }
+	void evictToBudget();
+
+	// Most recently unloaded first
+	std::list<Entry> entries;
+	std::unordered_map<int32_t, std::list<Entry>::iterator> entriesByChunk;
+	size_t memoryBudget;
+	// Heap bytes of the payloads
+	size_t memoryUsage = 0;
+	GLuint hits = 0;
+	GLuint misses = 0;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Chunk.h"
+
+// The loaded chunks indexed by their coordinates modulo SIZE on both axes. The loaded set is always a
+// window around the player narrower than SIZE, so no two loaded chunks share a slot and a lookup is
+// one array access instead of a hash and a bucket walk. Only the main thread adds and removes chunks,
+// any thread may look them up while it does without taking a lock
+class ChunkGrid
+{
+public:
+	// Wider than the largest unload area, render distance 32 plus the pipeline margin and hysteresis on both sides
+	static constexpr GLint SIZE = 128;
+
+	// The slots live on the heap, the world itself sits on the main thread's stack
+	ChunkGrid() : slots(std::make_unique<Slot[]>(SLOT_COUNT)), occupiedPositions(std::make_unique<uint32_t[]>(SLOT_COUNT)) {}
+
+	// The chunk at (x, z) or null. Readers only see fully constructed chunks; off the main thread the
+	// caller keeps a returned chunk alive by pinning the world's chunk reclaimer first
+	Chunk* get(int16_t x, int16_t z) const
+	{
+		const Slot& slot = slots[getSlotIndex(x, z)];
+		int32_t key = getKey(x, z);
+		// A sequence lock: the version is odd while the main thread rewrites the slot, a read that saw
+		// the same even version before and after got a key and chunk that belong together
+		while (true) {
+			uint32_t version = slot.version.load(std::memory_order_acquire);
+			int32_t slotKey = slot.key.load(std::memory_order_relaxed);
+			Chunk* chunk = slot.chunk.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if ((version & 1) == 0 && slot.version.load(std::memory_order_relaxed) == version) {
+				return slotKey == key ? chunk : nullptr;
+			}
+		}
+	}
+
+	// The chunk that currently owns the slot of (x, z), whatever its coordinates. Main thread only
+	Chunk* getOccupant(int16_t x, int16_t z) const { return slots[getSlotIndex(x, z)].chunk.load(std::memory_order_relaxed); }
+
+	// Main thread only, the slot must be empty
+	void insert(Chunk* chunk)
+	{
+		int16_t x = static_cast<int16_t>(chunk->getChunkX());
+		int16_t z = static_cast<int16_t>(chunk->getChunkZ());
+		size_t index = getSlotIndex(x, z);
+		write(slots[index], getKey(x, z), chunk);
+		occupiedPositions[index] = static_cast<uint32_t>(occupiedSlots.size());
+		occupiedSlots.push_back(static_cast<uint32_t>(index));
+	}
+
+	// Main thread only. Returns the chunk that was at (x, z), null when there was none
+	Chunk* remove(int16_t x, int16_t z)
+	{
+		Chunk* chunk = get(x, z);
+		if (!chunk) return nullptr;
+
+		size_t index = getSlotIndex(x, z);
+		write(slots[index], 0, nullptr);
+		uint32_t moved = occupiedSlots.back();
+		occupiedSlots[occupiedPositions[index]] = moved;
+		occupiedPositions[moved] = occupiedPositions[index];
+		occupiedSlots.pop_back();
+		return chunk;
+	}
+
+	// Main thread only
+	size_t size() const { return occupiedSlots.size(); }
+
+	// Walks the loaded chunks in no particular order without visiting the empty slots, main thread only
+	class Iterator
+	{
+	public:
+		Iterator(const ChunkGrid& grid, std::vector<uint32_t>::const_iterator position) : grid(grid), position(position) {}
+		Chunk* operator*() const { return grid.slots[*position].chunk.load(std::memory_order_relaxed); }
+		Iterator& operator++() { ++position; return *this; }
+		bool operator!=(const Iterator& other) const { return position != other.position; }
+
+	private:
+		const ChunkGrid& grid;
+		std::vector<uint32_t>::const_iterator position;
+	};
+
+	Iterator begin() const { return Iterator(*this, occupiedSlots.begin()); }
+	Iterator end() const { return Iterator(*this, occupiedSlots.end()); }
+
+private:
+	struct Slot {
+		std::atomic<uint32_t> version;
+		std::atomic<int32_t> key;
+		std::atomic<Chunk*> chunk;
+	};
+
+	static void write(Slot& slot, int32_t key, Chunk* chunk)
+	{
+		uint32_t version = slot.version.load(std::memory_order_relaxed);
+		slot.version.store(version + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.key.store(key, std::memory_order_relaxed);
+		slot.chunk.store(chunk, std::memory_order_relaxed);
+		slot.version.store(version + 2, std::memory_order_release);
+	}
+
+	static int32_t getKey(int16_t x, int16_t z) { return (static_cast<int32_t>(x) << 16) | static_cast<uint16_t>(z); }
+	// Two's complement wraps negative coordinates onto the same ring as positive ones
+	static size_t getSlotIndex(int16_t x, int16_t z) { return (static_cast<size_t>(x & (SIZE - 1)) * SIZE) + static_cast<size_t>(z & (SIZE - 1)); }
+
+	static constexpr size_t SLOT_COUNT = SIZE * SIZE;
+
+	std::unique_ptr<Slot[]> slots;
+	// Indices of the slots holding a chunk, so walking the chunks doesn't visit the whole grid
+	std::vector<uint32_t> occupiedSlots;
+	// Where each occupied slot is listed in occupiedSlots, kept apart so a slot stays 16 bytes
+	std::unique_ptr<uint32_t[]> occupiedPositions;
+};
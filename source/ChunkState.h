@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Where a chunk is in the streaming pipeline. The stages run in this order, except that an uploaded
+// chunk goes back to Meshing when its blocks change and any chunk can start Unloading. Queued covers
+// the load jobs that haven't started, there is no chunk object yet
+enum class ChunkState : uint8_t {
+	Queued,
+	Generating,	// Terrain generated or restored by a load job
+	Generated,	// Terrain only, waiting for its neighbours' terrain
+	Decorating,	// Structures of the 3x3 neighbourhood are being placed and the chunk lit by itself
+	Decorated,	// Waiting for its neighbours to be decorated
+	Lighting,	// Light is being spread across its borders
+	Lit,		// Waiting for its neighbours' light before the first mesh
+	Meshing,	// A worker builds the back buffers
+	MeshReady,	// The back buffers wait for the main thread to publish and upload them
+	Uploaded,	// The GPU buffers show the current blocks
+	Unloading,	// Out of the grid, waiting for the pins that can still reach it
+	Count
+};
+
+inline const char* getChunkStateName(ChunkState state)
+{
+	static const char* const names[] = { "Queued", "Generating", "Generated", "Decorating", "Decorated", "Lighting", "Lit", "Meshing", "Mesh Ready", "Uploaded", "Unloading" };
+	return names[static_cast<size_t>(state)];
+}
+
+// Whether the pipeline ever moves a chunk from one state straight to the other
+inline bool isValidChunkStateTransition(ChunkState from, ChunkState to)
+{
+	switch (to) {
+	case ChunkState::Generated: return from == ChunkState::Generating;
+	// A restored chunk that was saved decorated skips decoration
+	case ChunkState::Decorating: return from == ChunkState::Generated;
+	case ChunkState::Decorated: return from == ChunkState::Generating || from == ChunkState::Decorating;
+	case ChunkState::Lighting: return from == ChunkState::Decorated;
+	case ChunkState::Lit: return from == ChunkState::Lighting;
+	case ChunkState::Meshing: return from == ChunkState::Lit || from == ChunkState::Uploaded;
+	case ChunkState::MeshReady: return from == ChunkState::Meshing;
+	case ChunkState::Uploaded: return from == ChunkState::MeshReady;
+	case ChunkState::Unloading: return from != ChunkState::Unloading;
+	default: return false;
+	}
+}
+
+// How many chunks are in each state, updated by every transition. Any thread. A transition's state
+// change and its count update aren't one step, so a thread that takes the chunk on from the new state
+// can remove it from that count before it was added. The counts are signed and read as zero while
+// such a removal runs ahead
+class ChunkStateCounts
+{
+public:
+	void add(ChunkState state) { counts[static_cast<size_t>(state)].fetch_add(1, std::memory_order_relaxed); }
+	void remove(ChunkState state) { counts[static_cast<size_t>(state)].fetch_sub(1, std::memory_order_relaxed); }
+	void move(ChunkState from, ChunkState to) { remove(from); add(to); }
+	GLuint get(ChunkState state) const { return static_cast<GLuint>(std::max(counts[static_cast<size_t>(state)].load(std::memory_order_relaxed), 0)); }
+
+private:
+	std::array<std::atomic<GLint>, static_cast<size_t>(ChunkState::Count)> counts{};
+};
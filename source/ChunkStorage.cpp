@@ -0,0 +1,94 @@
+#include "ChunkStorage.h"
+#include <string>
+#include <iostream>
+
+ChunkStorage::ChunkStorage(std::filesystem::path directory) : directory(std::move(directory))
+{
+	std::error_code error;
+	std::filesystem::create_directories(this->directory, error);
+
+	ioThread = std::thread([this]() { writeQueuedChunks(); });
+}
+
+ChunkStorage::~ChunkStorage()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_one();
+	ioThread.join();
+}
+
+bool ChunkStorage::load(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t>& out)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		auto it = queuedPayloads.find(getChunkKey(chunkX, chunkZ));
+		if (it != queuedPayloads.end()) {
+			out = *it->second;
+			return true;
+		}
+	}
+	return getRegion(chunkX, chunkZ).read(getLocalCoordinate(chunkX), getLocalCoordinate(chunkZ), out);
+}
+
+void ChunkStorage::save(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t> payload)
+{
+	int32_t key = getChunkKey(chunkX, chunkZ);
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queuedPayloads[key] = std::make_shared<const std::vector<uint8_t>>(std::move(payload));
+		writeQueue.push_back(key);
+	}
+	queueCondition.notify_one();
+}
+
+size_t ChunkStorage::getQueuedWriteCount() const
+{
+	std::lock_guard<std::mutex> lock(queueMutex);
+	return queuedPayloads.size();
+}
+
+RegionFile& ChunkStorage::getRegion(int16_t chunkX, int16_t chunkZ)
+{
+	GLint regionX = getRegionCoordinate(chunkX);
+	GLint regionZ = getRegionCoordinate(chunkZ);
+
+	std::lock_guard<std::mutex> lock(regionsMutex);
+	std::unique_ptr<RegionFile>& region = regions[getChunkKey(static_cast<int16_t>(regionX), static_cast<int16_t>(regionZ))];
+	if (!region) {
+		region = std::make_unique<RegionFile>(directory / ("r." + std::to_string(regionX) + "." + std::to_string(regionZ) + ".vxr"));
+	}
+	return *region;
+}
+
+void ChunkStorage::writeQueuedChunks()
+{
+	std::unique_lock<std::mutex> lock(queueMutex);
+	while (true) {
+		queueCondition.wait(lock, [this]() { return stopping || !writeQueue.empty(); });
+		if (writeQueue.empty()) return;
+
+		int32_t key = writeQueue.front();
+		writeQueue.pop_front();
+		auto it = queuedPayloads.find(key);
+		if (it == queuedPayloads.end()) continue;
+		std::shared_ptr<const std::vector<uint8_t>> payload = it->second;
+		lock.unlock();
+
+		int16_t chunkX = static_cast<int16_t>(key >> 16);
+		int16_t chunkZ = static_cast<int16_t>(key & 0xFFFF);
+		if (!getRegion(chunkX, chunkZ).write(getLocalCoordinate(chunkX), getLocalCoordinate(chunkZ), *payload)) {
+			std::cerr << "Failed to save chunk " << chunkX << ", " << chunkZ << " to " << directory.string() << std::endl;
+		}
+
+		// A payload that failed to write is dropped as well, the chunk is generated again when it returns.
+		// One saved while this one was being written stays queued
+		lock.lock();
+		it = queuedPayloads.find(key);
+		if (it != queuedPayloads.end() && it->second == payload) {
+			queuedPayloads.erase(it);
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "RegionFile.h"
+#include <memory>
+#include <unordered_map>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+
+// Keeps saved chunks in region files under a world directory. Saving only queues the payload, a
+// dedicated I/O thread writes it out so neither the main thread nor the generation workers wait on
+// the disk. A queued payload is served to loads until it is written, so a chunk that comes back into
+// range right after unloading still gets its latest blocks
+class ChunkStorage
+{
+public:
+	explicit ChunkStorage(std::filesystem::path directory);
+	// Writes everything still queued before returning
+	~ChunkStorage();
+
+	// Any thread. Copies the newest saved payload of the chunk into out, false when it was never saved
+	bool load(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t>& out);
+	// Any thread. Queues the payload for the I/O thread, replacing one still queued for the same chunk
+	void save(int16_t chunkX, int16_t chunkZ, std::vector<uint8_t> payload);
+
+	size_t getQueuedWriteCount() const;
+
+private:
+	static int32_t getChunkKey(int16_t chunkX, int16_t chunkZ) { return (static_cast<int32_t>(chunkX) << 16) | static_cast<uint16_t>(chunkZ); }
+	// Opens the region holding the chunk the first time it is needed
+	RegionFile& getRegion(int16_t chunkX, int16_t chunkZ);
+	static GLint getRegionCoordinate(int16_t chunkCoordinate) { return chunkCoordinate >= 0 ? chunkCoordinate / RegionFile::REGION_SIZE : (chunkCoordinate + 1) / RegionFile::REGION_SIZE - 1; }
+	static GLint getLocalCoordinate(int16_t chunkCoordinate) { return (chunkCoordinate % RegionFile::REGION_SIZE + RegionFile::REGION_SIZE) % RegionFile::REGION_SIZE; }
+
+	void writeQueuedChunks();
+
+	const std::filesystem::path directory;
+
+	std::mutex regionsMutex;
+	std::unordered_map<int32_t, std::unique_ptr<RegionFile>> regions;
+
+	// Payloads waiting for the I/O thread keyed by chunk. The queue can list a chunk twice when it was
+	// saved again in the meantime, the second visit finds it already written
+	mutable std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	std::unordered_map<int32_t, std::shared_ptr<const std::vector<uint8_t>>> queuedPayloads;
+	std::deque<int32_t> writeQueue;
+	bool stopping = false;
+	std::thread ioThread;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Epoch based reclamation for objects one owner thread unlinks while other threads may still hold
+// pointers to them. Readers pin the current epoch for as long as they use pointers they looked up,
+// the owner retires unlinked objects and collects the ones no pin can reach any more.
+//
+// The epoch only moves from e to e + 1 once no pin from e - 1 is left, so while any pin from e is
+// held the epoch stays at e + 1 at most. An object retired during epoch e can only be reached by
+// pins from e or earlier. It is handed back by the collect that moves the epoch from e + 2 to e + 3,
+// which needs every pin from e + 1 to be gone, and the step before needed every pin from e to be
+// gone. Pins are counted per epoch rather than per thread, so they can be taken on one thread and
+// released on another, which lets the main thread pin for a job before it hands the job pointers to chunks
+template<typename T>
+class EpochReclaimer
+{
+public:
+	// Keeps every object that could be reached when it was taken alive until it is destroyed. Copies
+	// pin the same epoch
+	class Guard
+	{
+	public:
+		Guard() = default;
+		Guard(const Guard& other) : reclaimer(other.reclaimer), epoch(other.epoch) { if (reclaimer) reclaimer->pins[epoch % EPOCHS].fetch_add(1); }
+		Guard(Guard&& other) noexcept : reclaimer(other.reclaimer), epoch(other.epoch) { other.reclaimer = nullptr; }
+		Guard& operator=(Guard other) noexcept { std::swap(reclaimer, other.reclaimer); std::swap(epoch, other.epoch); return *this; }
+		~Guard() { if (reclaimer) reclaimer->pins[epoch % EPOCHS].fetch_sub(1); }
+
+	private:
+		friend class EpochReclaimer;
+		Guard(EpochReclaimer* reclaimer, uint64_t epoch) : reclaimer(reclaimer), epoch(epoch) {}
+
+		EpochReclaimer* reclaimer = nullptr;
+		uint64_t epoch = 0;
+	};
+
+	// Any thread. Objects looked up after this returns stay alive as long as the guard does
+	Guard pin()
+	{
+		while (true) {
+			uint64_t current = epoch.load();
+			pins[current % EPOCHS].fetch_add(1);
+			// The epoch may have moved on before the pin was counted, then the pin belongs to the new one
+			if (epoch.load() == current) return Guard(this, current);
+			pins[current % EPOCHS].fetch_sub(1);
+		}
+	}
+
+	// Owner thread only, the object must already be unreachable for new lookups
+	void retire(T* object)
+	{
+		retired[epoch.load(std::memory_order_relaxed) % EPOCHS].push_back(object);
+	}
+
+	// Owner thread only. Advances the epoch as far as the pins allow and moves every retired object no
+	// pin can reach any more into reclaimable
+	void collect(std::vector<T*>& reclaimable)
+	{
+		for (size_t step = 0; step < EPOCHS; ++step) {
+			uint64_t current = epoch.load(std::memory_order_relaxed);
+			if (pins[(current + EPOCHS - 1) % EPOCHS].load() != 0) return;
+
+			// The bucket the next epoch retires into holds what was retired two epochs ago, in current - 2
+			std::vector<T*>& expired = retired[(current + 1) % EPOCHS];
+			reclaimable.insert(reclaimable.end(), expired.begin(), expired.end());
+			expired.clear();
+			epoch.store(current + 1);
+		}
+	}
+
+	// Owner thread only, once no guard is left. Hands back everything retired
+	void drain(std::vector<T*>& reclaimable)
+	{
+		for (std::vector<T*>& bucket : retired) {
+			reclaimable.insert(reclaimable.end(), bucket.begin(), bucket.end());
+			bucket.clear();
+		}
+	}
+
+	// Owner thread only
+	size_t getRetiredCount() const
+	{
+		size_t count = 0;
+		for (const std::vector<T*>& bucket : retired) count += bucket.size();
+		return count;
+	}
+
+private:
+	static constexpr size_t EPOCHS = 3;
+
+	std::atomic<uint64_t> epoch = 0;
+	std::array<std::atomic<uint32_t>, EPOCHS> pins{};
+	std::array<std::vector<T*>, EPOCHS> retired;
+};
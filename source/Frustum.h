@@ -42,6 +42,11 @@ public:
         return true;
     }
 
+    // The near plane faces along the view direction, unit length once the frustum was updated
+    glm::vec3 getViewDirection() const {
+        return glm::vec3(planes[PLANE_NEAR]);
+    }
+
 private:
     std::array<glm::vec4, 6> planes;
 
@@ -0,0 +1,268 @@
+#include "LightEngine.h"
+
+namespace {
+	constexpr GLint DIRECTIONS[6][3] = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, 1, 0 }, { 0, -1, 0 }
+	};
+	constexpr GLint DOWN = 5;
+}
+
+std::vector<std::unique_lock<std::shared_mutex>> LightEngine::lockNeighbourhood(const std::array<Chunk*, 9>& neighbourhood)
+{
+	std::vector<std::unique_lock<std::shared_mutex>> locks;
+	locks.reserve(neighbourhood.size());
+	for (Chunk* chunk : neighbourhood) {
+		if (chunk) locks.emplace_back(chunk->blockDataMutex);
+	}
+	return locks;
+}
+
+GLint LightEngine::getSlot(GLint x, GLint z) const
+{
+	if (x < -CHUNK_SIZE || x >= 2 * CHUNK_SIZE || z < -CHUNK_SIZE || z >= 2 * CHUNK_SIZE) return -1;
+
+	GLint slot = (x + CHUNK_SIZE) / CHUNK_SIZE * 3 + (z + CHUNK_SIZE) / CHUNK_SIZE;
+	return neighbourhood[slot] ? slot : -1;
+}
+
+uint8_t LightEngine::getLight(GLint slot, GLint x, GLint y, GLint z, Channel channel) const
+{
+	uint8_t light = neighbourhood[slot]->getStoredLight(toLocal(x), y, toLocal(z));
+	return channel == SKY ? SectionLight::getSkyLight(light) : SectionLight::getBlockLight(light);
+}
+
+void LightEngine::setLight(GLint slot, GLint x, GLint y, GLint z, Channel channel, uint8_t level)
+{
+	Chunk* chunk = neighbourhood[slot];
+	uint8_t light = chunk->getStoredLight(toLocal(x), y, toLocal(z));
+	light = channel == SKY ? SectionLight::pack(level, SectionLight::getBlockLight(light)) : SectionLight::pack(SectionLight::getSkyLight(light), level);
+	chunk->setStoredLight(toLocal(x), y, toLocal(z), light);
+
+	changedSections[slot] |= static_cast<uint8_t>(1u << (y / SECTION_SIZE));
+	++changedBlocks;
+}
+
+uint8_t LightEngine::getSource(Channel channel, GLint blockType, GLint y)
+{
+	if (channel == BLOCK) return getEmission(blockType);
+	return y == CHUNK_HEIGHT - 1 ? MAX_LIGHT : 0;
+}
+
+void LightEngine::queueLitNeighbours(GLint x, GLint y, GLint z, Channel channel)
+{
+	for (const GLint* direction : DIRECTIONS) {
+		GLint nx = x + direction[0], ny = y + direction[1], nz = z + direction[2];
+		GLint slot = getSlot(nx, nz);
+		if (slot < 0 || ny < 0 || ny >= CHUNK_HEIGHT) continue;
+
+		if (getLight(slot, nx, ny, nz, channel) > 1 && Chunk::isTransparent(getBlock(slot, nx, ny, nz))) {
+			addQueues[channel].push_back({ static_cast<int8_t>(nx), static_cast<uint8_t>(ny), static_cast<int8_t>(nz), 0 });
+		}
+	}
+}
+
+void LightEngine::propagate(Channel channel)
+{
+	std::vector<Node>& queue = addQueues[channel];
+	for (size_t head = 0; head < queue.size(); ++head) {
+		Node node = queue[head];
+		GLint slot = getSlot(node.x, node.z);
+		if (!Chunk::isTransparent(getBlock(slot, node.x, node.y, node.z))) continue;
+
+		// Read now rather than when queued, the block may have been raised or darkened since
+		uint8_t level = getLight(slot, node.x, node.y, node.z, channel);
+		if (level <= 1) continue;
+
+		for (GLint d = 0; d < 6; ++d) {
+			GLint nx = node.x + DIRECTIONS[d][0], ny = node.y + DIRECTIONS[d][1], nz = node.z + DIRECTIONS[d][2];
+			GLint neighbourSlot = getSlot(nx, nz);
+			if (neighbourSlot < 0 || ny < 0 || ny >= CHUNK_HEIGHT) continue;
+
+			// Full sunlight keeps its strength on the way down
+			uint8_t spread = (channel == SKY && d == DOWN && level == MAX_LIGHT) ? MAX_LIGHT : level - 1;
+			if (getLight(neighbourSlot, nx, ny, nz, channel) >= spread) continue;
+
+			setLight(neighbourSlot, nx, ny, nz, channel, spread);
+			if (Chunk::isTransparent(getBlock(neighbourSlot, nx, ny, nz))) {
+				queue.push_back({ static_cast<int8_t>(nx), static_cast<uint8_t>(ny), static_cast<int8_t>(nz), 0 });
+			}
+		}
+	}
+	queue.clear();
+}
+
+void LightEngine::unpropagate(Channel channel)
+{
+	std::vector<Node>& queue = removeQueues[channel];
+	for (size_t head = 0; head < queue.size(); ++head) {
+		Node node = queue[head];
+
+		for (GLint d = 0; d < 6; ++d) {
+			GLint nx = node.x + DIRECTIONS[d][0], ny = node.y + DIRECTIONS[d][1], nz = node.z + DIRECTIONS[d][2];
+			GLint slot = getSlot(nx, nz);
+			if (slot < 0 || ny < 0 || ny >= CHUNK_HEIGHT) continue;
+
+			uint8_t level = getLight(slot, nx, ny, nz, channel);
+			if (level == 0) continue;
+
+			// A neighbour at least as bright as the removed block was lit by something else
+			GLint blockType = getBlock(slot, nx, ny, nz);
+			bool litByRemoved = level < node.level || (channel == SKY && d == DOWN && node.level == MAX_LIGHT);
+			if (!litByRemoved || getSource(channel, blockType, ny) >= level) {
+				addQueues[channel].push_back({ static_cast<int8_t>(nx), static_cast<uint8_t>(ny), static_cast<int8_t>(nz), 0 });
+				continue;
+			}
+
+			setLight(slot, nx, ny, nz, channel, 0);
+			if (Chunk::isTransparent(blockType)) {
+				queue.push_back({ static_cast<int8_t>(nx), static_cast<uint8_t>(ny), static_cast<int8_t>(nz), level });
+			}
+			else {
+				// Opaque blocks don't pass light on, but another side of them may still be lit
+				queueLitNeighbours(nx, ny, nz, channel);
+			}
+		}
+	}
+	queue.clear();
+}
+
+void LightEngine::lightChunk()
+{
+	Chunk* chunk = neighbourhood[4];
+
+	// Everything above the highest section holding a block is open sky
+	GLint topSection = CHUNK_SECTIONS - 1;
+	while (topSection >= 0 && chunk->getSectionState(topSection) == SectionState::Empty) {
+		chunk->fillLight(topSection, SectionLight::pack(MAX_LIGHT, 0));
+		--topSection;
+	}
+
+	// Below that full sunlight goes straight down to the first opaque block of every column, which is
+	// lit as well. skyFloor keeps the height of that block, -1 when the sky reaches the bottom
+	std::array<GLint, CHUNK_SIZE * CHUNK_SIZE> skyFloor;
+	for (GLint x = 0; x < CHUNK_SIZE; ++x) {
+		for (GLint z = 0; z < CHUNK_SIZE; ++z) {
+			GLint y = (topSection + 1) * SECTION_SIZE - 1;
+			for (; y >= 0; --y) {
+				setLight(4, x, y, z, SKY, MAX_LIGHT);
+				if (!Chunk::isTransparent(getBlock(4, x, y, z))) break;
+			}
+			skyFloor[x * CHUNK_SIZE + z] = y;
+		}
+	}
+
+	// Sunlit blocks next to a column whose sky floor is higher sit beside an overhang or a wall,
+	// they are the only ones whose sunlight can spread sideways
+	for (GLint x = 0; x < CHUNK_SIZE; ++x) {
+		for (GLint z = 0; z < CHUNK_SIZE; ++z) {
+			GLint floor = skyFloor[x * CHUNK_SIZE + z];
+			GLint highestNeighbour = floor;
+			for (GLint d = 0; d < 4; ++d) {
+				GLint nx = x + DIRECTIONS[d][0], nz = z + DIRECTIONS[d][2];
+				if (nx < 0 || nx >= CHUNK_SIZE || nz < 0 || nz >= CHUNK_SIZE) continue;
+				highestNeighbour = std::max(highestNeighbour, skyFloor[nx * CHUNK_SIZE + nz]);
+			}
+			for (GLint y = floor + 1; y < highestNeighbour; ++y) {
+				addQueues[SKY].push_back({ static_cast<int8_t>(x), static_cast<uint8_t>(y), static_cast<int8_t>(z), 0 });
+			}
+		}
+	}
+
+	for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+		if (!chunk->mayContainBlock(section, TORCH)) continue;
+
+		for (GLint x = 0; x < CHUNK_SIZE; ++x) {
+			for (GLint y = section * SECTION_SIZE; y < (section + 1) * SECTION_SIZE; ++y) {
+				for (GLint z = 0; z < CHUNK_SIZE; ++z) {
+					uint8_t emission = getEmission(getBlock(4, x, y, z));
+					if (emission > getLight(4, x, y, z, BLOCK)) {
+						setLight(4, x, y, z, BLOCK, emission);
+						addQueues[BLOCK].push_back({ static_cast<int8_t>(x), static_cast<uint8_t>(y), static_cast<int8_t>(z), 0 });
+					}
+				}
+			}
+		}
+	}
+
+	propagate(SKY);
+	propagate(BLOCK);
+}
+
+void LightEngine::spreadAcrossBorders()
+{
+	// Only the side of a border that is brighter by more than one level has anything to give
+	for (GLint d = 0; d < 4; ++d) {
+		GLint dx = DIRECTIONS[d][0], dz = DIRECTIONS[d][2];
+		GLint outsideSlot = getSlot(dx * CHUNK_SIZE, dz * CHUNK_SIZE);
+		if (outsideSlot < 0) continue;
+
+		for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+			// Nothing crosses between two sections lit evenly to the same level
+			const SectionLight& insideLight = neighbourhood[4]->getSectionLight(section);
+			const SectionLight& outsideLight = neighbourhood[outsideSlot]->getSectionLight(section);
+			if (insideLight.isUniform() && outsideLight.isUniform() && insideLight.getUniformLight() == outsideLight.getUniformLight()) continue;
+
+			for (GLint i = 0; i < CHUNK_SIZE; ++i) {
+				GLint x = dx < 0 ? 0 : dx > 0 ? CHUNK_SIZE - 1 : i;
+				GLint z = dz < 0 ? 0 : dz > 0 ? CHUNK_SIZE - 1 : i;
+
+				for (GLint y = section * SECTION_SIZE; y < (section + 1) * SECTION_SIZE; ++y) {
+					for (Channel channel : { SKY, BLOCK }) {
+						uint8_t inside = getLight(4, x, y, z, channel);
+						uint8_t outside = getLight(outsideSlot, x + dx, y, z + dz, channel);
+						if (inside > outside + 1) {
+							addQueues[channel].push_back({ static_cast<int8_t>(x), static_cast<uint8_t>(y), static_cast<int8_t>(z), 0 });
+						}
+						else if (outside > inside + 1) {
+							addQueues[channel].push_back({ static_cast<int8_t>(x + dx), static_cast<uint8_t>(y), static_cast<int8_t>(z + dz), 0 });
+						}
+					}
+				}
+			}
+		}
+	}
+
+	propagate(SKY);
+	propagate(BLOCK);
+}
+
+void LightEngine::updateBlock(GLint x, GLint y, GLint z, GLint oldType)
+{
+	GLint newType = getBlock(4, x, y, z);
+	bool wasTransparent = Chunk::isTransparent(oldType);
+	bool isTransparent = Chunk::isTransparent(newType);
+	Node node = { static_cast<int8_t>(x), static_cast<uint8_t>(y), static_cast<int8_t>(z), 0 };
+
+	for (Channel channel : { SKY, BLOCK }) {
+		uint8_t level = getLight(4, x, y, z, channel);
+		uint8_t source = getSource(channel, newType, y);
+
+		// The block stopped passing light or emits less than before, take back what came through it
+		if (level > 0 && ((wasTransparent && !isTransparent) || getSource(channel, oldType, y) > source)) {
+			setLight(4, x, y, z, channel, 0);
+			removeQueues[channel].push_back({ node.x, node.y, node.z, level });
+		}
+		// The block stopped blocking light, let it and its neighbours shine through
+		if (!wasTransparent && isTransparent) {
+			addQueues[channel].push_back(node);
+			queueLitNeighbours(x, y, z, channel);
+		}
+
+		unpropagate(channel);
+		if (source > getLight(4, x, y, z, channel)) {
+			setLight(4, x, y, z, channel, source);
+			addQueues[channel].push_back(node);
+		}
+		propagate(channel);
+	}
+}
+
+void LightEngine::commit()
+{
+	for (GLint slot = 0; slot < 9; ++slot) {
+		if (!neighbourhood[slot] || !changedSections[slot]) continue;
+
+		neighbourhood[slot]->compactLight(changedSections[slot]);
+		neighbourhood[slot]->markSectionsDirty(changedSections[slot]);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Chunk.h"
+#include <array>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+
+// Flood fill lighting over a chunk and its 8 neighbours. Sky light comes down from the top of the world
+// without getting weaker and spreads sideways one level weaker per block, block light spreads out from
+// emitters like torches. Opaque blocks take the light of their brightest neighbour so their faces are
+// lit but never pass it on. Light fades out within 15 blocks, so anything started in the centre chunk
+// stays inside the neighbourhood
+class LightEngine
+{
+public:
+	static constexpr uint8_t MAX_LIGHT = 15;
+
+	// neighbourhood is indexed [(dx + 1) * 3 + (dz + 1)], missing chunks are null and stop light like a
+	// wall. The caller holds blockDataMutex of every chunk in it exclusively
+	explicit LightEngine(const std::array<Chunk*, 9>& neighbourhood) : neighbourhood(neighbourhood) {}
+
+	// Locks the chunks in world order, x then z, so jobs locking overlapping neighbourhoods can't deadlock
+	static std::vector<std::unique_lock<std::shared_mutex>> lockNeighbourhood(const std::array<Chunk*, 9>& neighbourhood);
+
+	static uint8_t getEmission(GLint blockType) { return blockType == TORCH ? 14 : 0; }
+
+	// Lights the centre chunk on its own, sunlight straight down and then sideways under overhangs and
+	// the light of its emitters. Expects a chunk without any light yet
+	void lightChunk();
+	// Carries light across the four borders of the centre chunk, into it and out of it
+	void spreadAcrossBorders();
+	// Relights around the block at (x, y, z) of the centre chunk, which was oldType before its last change
+	void updateBlock(GLint x, GLint y, GLint z, GLint oldType);
+
+	// Compacts the light sections that changed and marks them for remeshing
+	void commit();
+	GLuint getChangedBlockCount() const { return changedBlocks; }
+
+private:
+	enum Channel : uint8_t { SKY, BLOCK };
+
+	// Position relative to the centre chunk, x and z run from -CHUNK_SIZE to 2 * CHUNK_SIZE - 1
+	struct Node {
+		int8_t x;
+		uint8_t y;
+		int8_t z;
+		// The light the block had before it was removed, only used by the removal queues
+		uint8_t level;
+	};
+
+	// Neighbourhood slot holding the column, -1 when it lies outside or the chunk is missing
+	GLint getSlot(GLint x, GLint z) const;
+	static GLint toLocal(GLint coordinate) { return (coordinate + CHUNK_SIZE) % CHUNK_SIZE; }
+
+	GLint getBlock(GLint slot, GLint x, GLint y, GLint z) const { return neighbourhood[slot]->getStoredBlock(toLocal(x), y, toLocal(z)); }
+	uint8_t getLight(GLint slot, GLint x, GLint y, GLint z, Channel channel) const;
+	void setLight(GLint slot, GLint x, GLint y, GLint z, Channel channel, uint8_t level);
+	// Light a block produces by itself, emitters for block light and the top of the world for sky light
+	static uint8_t getSource(Channel channel, GLint blockType, GLint y);
+
+	// Queues the transparent lit neighbours of a block so they shine into it again
+	void queueLitNeighbours(GLint x, GLint y, GLint z, Channel channel);
+	// Drains the add queue, raising every block its light can reach
+	void propagate(Channel channel);
+	// Drains the removal queue, darkening everything lit through the removed blocks and queueing the
+	// blocks at the edge of the dark area that still get light from elsewhere
+	void unpropagate(Channel channel);
+
+	std::array<Chunk*, 9> neighbourhood;
+	std::array<uint8_t, 9> changedSections = {};
+	GLuint changedBlocks = 0;
+
+	std::array<std::vector<Node>, 2> addQueues;
+	std::array<std::vector<Node>, 2> removeQueues;
+};
@@ -24,8 +24,7 @@ void LoadingScreen::display(GLFWwindow* window, World& world, Frustum& frustum,
 
         GLint index = 0;
 
-        for (const auto& pair : world.getChunks()) {
-            const Chunk* chunk = pair.second;
+        for (const Chunk* chunk : world.getChunks()) {
             ImVec2 chunkPosMin = ImVec2(canvasCenter.x + (chunk->getMinBounds().x - camPos.x) * 0.7f, canvasCenter.y + (chunk->getMinBounds().z - camPos.z) * 0.7f);
             ImVec2 chunkPosMax = ImVec2(canvasCenter.x + (chunk->getMaxBounds().x - camPos.x) * 0.7f, canvasCenter.y + (chunk->getMaxBounds().z - camPos.z) * 0.7f);
 
@@ -0,0 +1,157 @@
+#include "PalettedSection.h"
+#include "ByteStream.h"
+#include <array>
+#include <algorithm>
+
+namespace {
+	uint8_t getIndexWidthFor(size_t paletteSize)
+	{
+		if (paletteSize <= 1) return 0;
+		if (paletteSize <= 2) return 1;
+		if (paletteSize <= 4) return 2;
+		if (paletteSize <= 16) return 4;
+		return 8;
+	}
+}
+
+void PalettedSection::setPaletteIndex(GLint index, GLuint paletteIndex)
+{
+	GLuint bit = static_cast<GLuint>(index) * bitsPerBlock;
+	uint64_t mask = ((uint64_t(1) << bitsPerBlock) - 1) << (bit & 63);
+	words[bit >> 6] = (words[bit >> 6] & ~mask) | (static_cast<uint64_t>(paletteIndex) << (bit & 63));
+}
+
+void PalettedSection::setIndexWidth(uint8_t bits)
+{
+	std::vector<uint64_t> oldWords = std::move(words);
+	uint8_t oldBits = bitsPerBlock;
+
+	bitsPerBlock = bits;
+	words.assign(SECTION_VOLUME * bits / 64, 0);
+	if (oldBits == 0) return;
+
+	for (GLint i = 0; i < SECTION_VOLUME; ++i) {
+		GLuint bit = static_cast<GLuint>(i) * oldBits;
+		setPaletteIndex(i, static_cast<GLuint>(oldWords[bit >> 6] >> (bit & 63)) & ((1u << oldBits) - 1));
+	}
+}
+
+void PalettedSection::set(GLint index, int8_t blockType)
+{
+	auto it = std::find(palette.begin(), palette.end(), blockType);
+	GLuint paletteIndex = static_cast<GLuint>(it - palette.begin());
+
+	if (it == palette.end()) {
+		palette.push_back(blockType);
+		uint8_t bits = getIndexWidthFor(palette.size());
+		if (bits != bitsPerBlock) {
+			setIndexWidth(bits);
+		}
+	}
+
+	if (bitsPerBlock != 0) {
+		setPaletteIndex(index, paletteIndex);
+	}
+}
+
+void PalettedSection::pack(const int8_t* blocks, GLint xStride)
+{
+	// Block types are int8_t, offset by 128 they index a lookup from block type to palette entry
+	std::array<int16_t, 256> lookup;
+	lookup.fill(-1);
+	palette.clear();
+
+	for (GLint x = 0; x < SECTION_SIZE; ++x) {
+		const int8_t* slice = blocks + x * xStride;
+		for (GLint i = 0; i < SECTION_SIZE * SECTION_SIZE; ++i) {
+			int16_t& entry = lookup[static_cast<uint8_t>(slice[i] + 128)];
+			if (entry < 0) {
+				entry = static_cast<int16_t>(palette.size());
+				palette.push_back(slice[i]);
+			}
+		}
+	}
+
+	bitsPerBlock = getIndexWidthFor(palette.size());
+	words.clear();
+	if (bitsPerBlock == 0) {
+		words.shrink_to_fit();
+		return;
+	}
+
+	words.assign(SECTION_VOLUME * bitsPerBlock / 64, 0);
+	const GLint blocksPerWord = 64 / bitsPerBlock;
+	GLint index = 0;
+	for (GLint x = 0; x < SECTION_SIZE; ++x) {
+		const int8_t* slice = blocks + x * xStride;
+		for (GLint i = 0; i < SECTION_SIZE * SECTION_SIZE; i += blocksPerWord, index += blocksPerWord) {
+			uint64_t word = 0;
+			for (GLint j = 0; j < blocksPerWord; ++j) {
+				word |= static_cast<uint64_t>(lookup[static_cast<uint8_t>(slice[i + j] + 128)]) << (j * bitsPerBlock);
+			}
+			words[index / blocksPerWord] = word;
+		}
+	}
+}
+
+void PalettedSection::unpack(int8_t* blocks, GLint xStride) const
+{
+	if (bitsPerBlock == 0) {
+		for (GLint x = 0; x < SECTION_SIZE; ++x) {
+			std::fill_n(blocks + x * xStride, SECTION_SIZE * SECTION_SIZE, palette[0]);
+		}
+		return;
+	}
+
+	const GLint blocksPerWord = 64 / bitsPerBlock;
+	const uint64_t mask = (uint64_t(1) << bitsPerBlock) - 1;
+	GLint index = 0;
+	for (GLint x = 0; x < SECTION_SIZE; ++x) {
+		int8_t* slice = blocks + x * xStride;
+		for (GLint i = 0; i < SECTION_SIZE * SECTION_SIZE; i += blocksPerWord, index += blocksPerWord) {
+			uint64_t word = words[index / blocksPerWord];
+			for (GLint j = 0; j < blocksPerWord; ++j) {
+				slice[i + j] = palette[(word >> (j * bitsPerBlock)) & mask];
+			}
+		}
+	}
+}
+
+void PalettedSection::serialize(ByteWriter& writer) const
+{
+	writer.write<uint8_t>(bitsPerBlock);
+	writer.write<uint16_t>(static_cast<uint16_t>(palette.size()));
+	writer.writeBytes(palette.data(), palette.size());
+	writer.writeBytes(words.data(), words.size() * sizeof(uint64_t));
+}
+
+bool PalettedSection::deserialize(ByteReader& reader)
+{
+	uint8_t bits = reader.read<uint8_t>();
+	uint16_t paletteSize = reader.read<uint16_t>();
+	if (!reader.isValid() || (bits != 0 && bits != 1 && bits != 2 && bits != 4 && bits != 8) ||
+		paletteSize == 0 || paletteSize > (1u << bits)) {
+		return false;
+	}
+
+	std::vector<int8_t> newPalette(paletteSize);
+	std::vector<uint64_t> newWords(SECTION_VOLUME * bits / 64);
+	reader.readBytes(newPalette.data(), newPalette.size());
+	reader.readBytes(newWords.data(), newWords.size() * sizeof(uint64_t));
+	if (!reader.isValid()) return false;
+
+	// get() indexes the palette without checks, so every index has to name an entry
+	if (paletteSize < (1u << bits)) {
+		const uint64_t mask = (uint64_t(1) << bits) - 1;
+		for (uint64_t word : newWords) {
+			for (GLint shift = 0; shift < 64; shift += bits) {
+				if (((word >> shift) & mask) >= paletteSize) return false;
+			}
+		}
+	}
+
+	palette = std::move(newPalette);
+	words = std::move(newWords);
+	bitsPerBlock = bits;
+	return true;
+}
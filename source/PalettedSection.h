@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class ByteWriter;
+class ByteReader;
+
+constexpr uint8_t SECTION_SIZE = 16;
+constexpr GLint SECTION_VOLUME = SECTION_SIZE * SECTION_SIZE * SECTION_SIZE;
+
+// Block storage for a 16x16x16 piece of a chunk: a palette of the block types it contains and one
+// index per block bit packed into 64 bit words. A section holding a single block type, like all air
+// or all stone, keeps just that value. Blocks are addressed by getIndex, x major then y then z like
+// the chunk arrays, so an x slice of a section is one contiguous run of a chunk array
+class PalettedSection
+{
+public:
+	static GLint getIndex(GLint x, GLint y, GLint z) { return (x * SECTION_SIZE + y) * SECTION_SIZE + z; }
+
+	GLint get(GLint index) const
+	{
+		if (bitsPerBlock == 0) return palette[0];
+		GLuint bit = static_cast<GLuint>(index) * bitsPerBlock;
+		return palette[(words[bit >> 6] >> (bit & 63)) & ((1u << bitsPerBlock) - 1)];
+	}
+
+	// Adds the block type to the palette and widens the indices when needed. Entries that are no
+	// longer used stay in the palette until the section is packed again
+	void set(GLint index, int8_t blockType);
+
+	// Rebuilds the section from blocks laid out like a chunk array, element (x, y, z) is read from
+	// blocks[x * xStride + y * SECTION_SIZE + z]. The palette ends up holding only what is used
+	void pack(const int8_t* blocks, GLint xStride);
+	// The inverse of pack, writes every block of the section
+	void unpack(int8_t* blocks, GLint xStride) const;
+
+	// Appends the palette and the packed indices as they are, nothing is unpacked
+	void serialize(ByteWriter& writer) const;
+	// Replaces the section with what serialize wrote, returns false and leaves the section as it was
+	// when the data is malformed
+	bool deserialize(ByteReader& reader);
+
+	bool isUniform() const { return bitsPerBlock == 0; }
+	int8_t getUniformBlock() const { return palette[0]; }
+	// May still list block types that set() has since overwritten everywhere
+	const std::vector<int8_t>& getPalette() const { return palette; }
+
+	// Heap bytes held by the palette and the index words
+	size_t getMemoryUsage() const { return palette.capacity() + words.capacity() * sizeof(uint64_t); }
+
+private:
+	void setIndexWidth(uint8_t bits);
+	void setPaletteIndex(GLint index, GLuint paletteIndex);
+
+	std::vector<int8_t> palette = { -1 };
+	std::vector<uint64_t> words;
+	// 0, 1, 2, 4 or 8, a power of two so an index never straddles two words
+	uint8_t bitsPerBlock = 0;
+};
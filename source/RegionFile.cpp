@@ -0,0 +1,204 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "RegionFile.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+RegionFile::RegionFile(std::filesystem::path path) : path(std::move(path))
+{
+	open();
+}
+
+RegionFile::~RegionFile()
+{
+	unmap();
+}
+
+void RegionFile::open()
+{
+	std::error_code error;
+	if (!std::filesystem::exists(path, error)) return;
+
+	file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+	if (file.is_open() && map() && mappedSize >= HEADER_SECTORS * SECTOR_SIZE) {
+		uint32_t header[2];
+		std::memcpy(header, mappedData, sizeof(header));
+		if (header[0] == MAGIC && header[1] == VERSION) {
+			std::memcpy(entries.data(), mappedData + TABLE_OFFSET, sizeof(entries));
+			usedSectors.assign(mappedSize / SECTOR_SIZE, false);
+			setSectorsUsed(0, HEADER_SECTORS, true);
+
+			// An entry pointing outside the file or into another payload can only come from a damaged
+			// file, that chunk is generated again instead
+			for (Entry& entry : entries) {
+				if (entry.sector == 0) continue;
+				uint32_t count = getSectorCount(entry.size);
+				bool isValid = entry.size > 0 && entry.sector >= HEADER_SECTORS && entry.sector + count <= usedSectors.size() &&
+					std::none_of(usedSectors.begin() + entry.sector, usedSectors.begin() + entry.sector + count, [](bool used) { return used; });
+				if (isValid) {
+					setSectorsUsed(entry.sector, count, true);
+				}
+				else {
+					entry = Entry();
+				}
+			}
+			return;
+		}
+	}
+
+	std::cerr << "Region file " << path.string() << " is unreadable, starting it over" << std::endl;
+	file.close();
+	unmap();
+}
+
+bool RegionFile::createFile()
+{
+	unmap();
+	file.close();
+	file.clear();
+	entries.fill(Entry());
+
+	{
+		std::ofstream created(path, std::ios::binary | std::ios::trunc);
+		std::vector<char> header(HEADER_SECTORS * SECTOR_SIZE, 0);
+		const uint32_t preamble[2] = { MAGIC, VERSION };
+		std::memcpy(header.data(), preamble, sizeof(preamble));
+		created.write(header.data(), header.size());
+		if (!created) return false;
+	}
+
+	file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+	usedSectors.assign(HEADER_SECTORS, true);
+	return file.is_open();
+}
+
+bool RegionFile::map()
+{
+	unmap();
+
+	std::error_code error;
+	size_t size = static_cast<size_t>(std::filesystem::file_size(path, error));
+	if (error || size == 0) return false;
+
+#ifdef _WIN32
+	// The view keeps the file and the mapping object alive, both handles can be closed right away
+	HANDLE fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) return false;
+	HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(fileHandle);
+	if (!mappingHandle) return false;
+	void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mappingHandle);
+	if (!view) return false;
+#else
+	int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) return false;
+	void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+	::close(descriptor);
+	if (view == MAP_FAILED) return false;
+#endif
+
+	mappedData = static_cast<const uint8_t*>(view);
+	mappedSize = size;
+	return true;
+}
+
+void RegionFile::unmap()
+{
+	if (!mappedData) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(mappedData);
+#else
+	munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+#endif
+	mappedData = nullptr;
+	mappedSize = 0;
+}
+
+bool RegionFile::read(GLint x, GLint z, std::vector<uint8_t>& out)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	const Entry& entry = entries[getEntryIndex(x, z)];
+	if (entry.sector == 0) return false;
+
+	// Writes go through the file stream and show up in the mapping, only a grown file needs a new one
+	size_t begin = static_cast<size_t>(entry.sector) * SECTOR_SIZE;
+	if (begin + entry.size > mappedSize && (!map() || begin + entry.size > mappedSize)) return false;
+
+	out.assign(mappedData + begin, mappedData + begin + entry.size);
+	return true;
+}
+
+bool RegionFile::write(GLint x, GLint z, const std::vector<uint8_t>& payload)
+{
+	if (payload.empty()) return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!file.is_open() && !createFile()) return false;
+
+	// The payload always goes to free sectors, so a write cut short never damages the stored copy
+	Entry& entry = entries[getEntryIndex(x, z)];
+	Entry written = { 0, static_cast<uint32_t>(payload.size()) };
+	uint32_t count = getSectorCount(written.size);
+	written.sector = allocateSectors(count);
+
+	std::vector<char> sectors(count * SECTOR_SIZE, 0);
+	std::memcpy(sectors.data(), payload.data(), payload.size());
+	file.seekp(static_cast<std::streamoff>(written.sector) * SECTOR_SIZE);
+	file.write(sectors.data(), sectors.size());
+	file.flush();
+
+	if (file) {
+		file.seekp(static_cast<std::streamoff>(TABLE_OFFSET + getEntryIndex(x, z) * sizeof(Entry)));
+		file.write(reinterpret_cast<const char*>(&written), sizeof(Entry));
+		file.flush();
+	}
+	if (!file) {
+		file.clear();
+		setSectorsUsed(written.sector, count, false);
+		return false;
+	}
+
+	if (entry.sector != 0) {
+		setSectorsUsed(entry.sector, getSectorCount(entry.size), false);
+	}
+	entry = written;
+	return true;
+}
+
+uint32_t RegionFile::allocateSectors(uint32_t count)
+{
+	uint32_t runStart = 0;
+	uint32_t runLength = 0;
+	for (uint32_t sector = HEADER_SECTORS; sector < usedSectors.size(); ++sector) {
+		if (usedSectors[sector]) {
+			runLength = 0;
+			continue;
+		}
+		if (runLength++ == 0) runStart = sector;
+		if (runLength == count) break;
+	}
+
+	// No free run is long enough, the payload goes to the end of the file, starting in a free tail if there is one
+	uint32_t first = runLength > 0 ? runStart : static_cast<uint32_t>(usedSectors.size());
+	if (first + count > usedSectors.size()) {
+		usedSectors.resize(first + count, false);
+	}
+	setSectorsUsed(first, count, true);
+	return first;
+}
+
+void RegionFile::setSectorsUsed(uint32_t first, uint32_t count, bool used)
+{
+	std::fill(usedSectors.begin() + first, usedSectors.begin() + first + count, used);
+}
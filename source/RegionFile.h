@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <filesystem>
+
+// Saved chunks of a 32x32 chunk area in one file. The file starts with a table holding where each
+// chunk's payload starts and how long it is, payloads follow in 4 KB sectors. A payload that outgrows
+// its sectors moves to the first free run large enough or to the end of the file, and the table
+// entry is only rewritten once the payload is on disk. Reads copy out of a memory mapping of the
+// file, so finding a chunk costs no system call once the region is open
+class RegionFile
+{
+public:
+	static constexpr GLint REGION_SIZE = 32;
+	static constexpr size_t SECTOR_SIZE = 4096;
+
+	explicit RegionFile(std::filesystem::path path);
+	~RegionFile();
+	RegionFile(const RegionFile&) = delete;
+	RegionFile& operator=(const RegionFile&) = delete;
+
+	// Takes the chunk position inside the region. Copies the stored payload into out, false when the
+	// chunk was never saved
+	bool read(GLint x, GLint z, std::vector<uint8_t>& out);
+	// Stores the payload, replacing an earlier one. False when the file could not be written, the
+	// previous payload stays readable then
+	bool write(GLint x, GLint z, const std::vector<uint8_t>& payload);
+
+private:
+	struct Entry {
+		// First sector of the payload, 0 when the chunk is not stored
+		uint32_t sector = 0;
+		uint32_t size = 0;
+	};
+
+	static constexpr uint32_t MAGIC = 0x47525856; // "VXRG"
+	static constexpr uint32_t VERSION = 1;
+	static constexpr size_t TABLE_OFFSET = 2 * sizeof(uint32_t);
+	// The magic, the version and one entry per chunk, rounded up to whole sectors
+	static constexpr uint32_t HEADER_SECTORS = static_cast<uint32_t>((TABLE_OFFSET + REGION_SIZE * REGION_SIZE * sizeof(Entry) + SECTOR_SIZE - 1) / SECTOR_SIZE);
+
+	static GLint getEntryIndex(GLint x, GLint z) { return x * REGION_SIZE + z; }
+	static uint32_t getSectorCount(uint32_t size) { return static_cast<uint32_t>((size + SECTOR_SIZE - 1) / SECTOR_SIZE); }
+
+	// Reads the table of an existing file, starts a new one when it is missing or not a region file
+	void open();
+	bool createFile();
+	// Maps the whole file, called again whenever a read reaches past the mapped part after the file grew
+	bool map();
+	void unmap();
+	uint32_t allocateSectors(uint32_t count);
+	void setSectorsUsed(uint32_t first, uint32_t count, bool used);
+
+	std::filesystem::path path;
+	// Guards everything below, the I/O thread writes while generation workers read
+	std::mutex mutex;
+	std::fstream file;
+	std::array<Entry, REGION_SIZE * REGION_SIZE> entries;
+	// One flag per sector of the file, the header sectors are always used
+	std::vector<bool> usedSectors;
+
+	const uint8_t* mappedData = nullptr;
+	size_t mappedSize = 0;
+};
@@ -0,0 +1,31 @@
+#include "SectionLight.h"
+#include <cstring>
+
+void SectionLight::set(GLint index, uint8_t light)
+{
+	if (values.empty()) {
+		if (light == uniformLight) return;
+		values.assign(SECTION_VOLUME, uniformLight);
+	}
+	values[index] = light;
+}
+
+void SectionLight::copyRow(GLint index, uint8_t* out) const
+{
+	if (values.empty()) {
+		std::memset(out, uniformLight, SECTION_SIZE);
+	}
+	else {
+		std::memcpy(out, &values[index], SECTION_SIZE);
+	}
+}
+
+void SectionLight::compact()
+{
+	if (values.empty()) return;
+
+	uint8_t first = values[0];
+	if (std::all_of(values.begin(), values.end(), [first](uint8_t light) { return light == first; })) {
+		fill(first);
+	}
+}
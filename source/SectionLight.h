@@ -0,0 +1,44 @@
+#pragma once
+
+#include "PalettedSection.h"
+#include <algorithm>
+
+// Light of a 16x16x16 section, laid out like PalettedSection. Every block has a sky light and a block
+// light level from 0 to 15, packed as two nibbles of one byte: sky in the low one, block in the high
+// one. A section where every block has the same light, like open air in full sunlight or buried
+// stone, keeps just that byte and allocates nothing
+class SectionLight
+{
+public:
+	static uint8_t pack(uint8_t skyLight, uint8_t blockLight) { return static_cast<uint8_t>(skyLight | blockLight << 4); }
+	static uint8_t getSkyLight(uint8_t light) { return light & 0xF; }
+	static uint8_t getBlockLight(uint8_t light) { return light >> 4; }
+	// What a face lit by both channels ends up with, the brighter of the two
+	static uint8_t getLightLevel(uint8_t light) { return std::max<uint8_t>(light & 0xF, light >> 4); }
+
+	uint8_t get(GLint index) const { return values.empty() ? uniformLight : values[index]; }
+	// Gives the section its own array the first time a block differs from the uniform value
+	void set(GLint index, uint8_t light);
+	// Writes the light of a 16 block z row starting at index
+	void copyRow(GLint index, uint8_t* out) const;
+
+	// Drops the array again when every block ended up with the same light
+	void compact();
+
+	// Sets every block of the section to the same light
+	void fill(uint8_t light)
+	{
+		uniformLight = light;
+		values.clear();
+		values.shrink_to_fit();
+	}
+
+	bool isUniform() const { return values.empty(); }
+	uint8_t getUniformLight() const { return uniformLight; }
+	size_t getMemoryUsage() const { return values.capacity(); }
+
+private:
+	uint8_t uniformLight = 0;
+	// SECTION_VOLUME entries, empty while the section is uniform
+	std::vector<uint8_t> values;
+};
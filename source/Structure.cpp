@@ -78,31 +78,36 @@ void Structure::generateBaseTree(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z)
 }
 */
 
-void Structure::generateBaseProceduralTree(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z) {
-    uint8_t treeHeight = 10 + rand() % 6;  // Random trunk height
-
-    std::unordered_map<World::ChunkCoord, std::vector<BlockChange>, World::ChunkCoordHash> chunkBlockChanges;
-
-    auto setLocalBlockType = [&](GLint offsetX, GLint offsetY, GLint offsetZ, uint8_t blockType) {
-        int32_t newX = x + offsetX;
-        int32_t newY = y + offsetY;
-        int32_t newZ = z + offsetZ;
-
-        int32_t globalX = chunk.chunkX * CHUNK_SIZE + newX;
-        int32_t globalZ = chunk.chunkZ * CHUNK_SIZE + newZ;
-
-        int32_t targetChunkX = globalX / CHUNK_SIZE;
-        if (globalX < 0 && globalX % CHUNK_SIZE != 0) targetChunkX -= 1;
-
-        int32_t targetChunkZ = globalZ / CHUNK_SIZE;
-        if (globalZ < 0 && globalZ % CHUNK_SIZE != 0) targetChunkZ -= 1;
+void Structure::generate(Chunk& chunk, const StructureAnchor& anchor) {
+    GLint minX = chunk.getChunkX() * CHUNK_SIZE, minZ = chunk.getChunkZ() * CHUNK_SIZE;
+    if (anchor.x + MAX_REACH < minX || anchor.x - MAX_REACH >= minX + CHUNK_SIZE ||
+        anchor.z + MAX_REACH < minZ || anchor.z - MAX_REACH >= minZ + CHUNK_SIZE) {
+        return;
+    }
 
-        int32_t localX = globalX - targetChunkX * CHUNK_SIZE;
-        int32_t localZ = globalZ - targetChunkZ * CHUNK_SIZE;
+    // Every chunk replays the same copy of the stream, so they all agree on the shape
+    WorldRandom random = anchor.random;
+    switch (anchor.type) {
+    case StructureAnchor::Type::ProceduralTree:
+        generateBaseProceduralTree(chunk, anchor.x, anchor.y, anchor.z, random);
+        break;
+    case StructureAnchor::Type::OrangeLeavesTree:
+        generateProceduralTreeOrangeLeaves(chunk, anchor.x, anchor.y, anchor.z, random);
+        break;
+    case StructureAnchor::Type::YellowLeavesTree:
+        generateProceduralTreeYellowLeaves(chunk, anchor.x, anchor.y, anchor.z, random);
+        break;
+    case StructureAnchor::Type::PurpleTree:
+        generateBasePurpleTree(chunk, anchor.x, anchor.y, anchor.z, random);
+        break;
+    }
+}
 
-        World::ChunkCoord targetCoord = { static_cast<int16_t>(targetChunkX), static_cast<int16_t>(targetChunkZ) };
+void Structure::generateBaseProceduralTree(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random) {
+    uint8_t treeHeight = 10 + random.nextInt(6);  // Random trunk height
 
-        chunkBlockChanges[targetCoord].push_back({ static_cast<int16_t>(localX), static_cast<int16_t>(newY), static_cast<int16_t>(localZ), blockType });
+    auto setLocalBlockType = [&](GLint offsetX, GLint offsetY, GLint offsetZ, uint8_t blockType) {
+        chunk.placeBlockIfInChunk(x + offsetX, y + offsetY, z + offsetZ, blockType);
     };
 
     for (uint8_t i = 0; i < treeHeight - 1; ++i) 
@@ -113,11 +118,11 @@ void Structure::generateBaseProceduralTree(Chunk& chunk, uint8_t x, uint8_t y, u
     // Place a leaf block at the top
     setLocalBlockType(0, treeHeight - 1, 0, OAK_LEAF);
 
-    int8_t leafRadius = 3 + rand() % 2;
+    int8_t leafRadius = 3 + random.nextInt(2);
     int8_t leafStart = treeHeight - (leafRadius + 3);
 
     FastNoiseLite leafNoise;
-    leafNoise.SetSeed(rand());
+    leafNoise.SetSeed(static_cast<int>(random.next()));
     leafNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2S);
     leafNoise.SetFrequency(1.0f);
 
@@ -129,12 +134,12 @@ void Structure::generateBaseProceduralTree(Chunk& chunk, uint8_t x, uint8_t y, u
             for (int8_t zOffset = -radius; zOffset <= radius; ++zOffset) {
                 GLfloat distance = sqrtf(xOffset * xOffset + zOffset * zOffset);
 
-                if (distance <= radius + 0.5f) {
+                if (distance <= radius + 0.5f && chunk.containsColumn(x + xOffset, z + zOffset)) {
                     GLfloat noiseValue = leafNoise.GetNoise
                     (
-                        static_cast<GLfloat>(chunk.chunkX * CHUNK_SIZE + x + xOffset),
+                        static_cast<GLfloat>(x + xOffset),
                         static_cast<GLfloat>(layerY),
-                        static_cast<GLfloat>(chunk.chunkZ * CHUNK_SIZE + z + zOffset)
+                        static_cast<GLfloat>(z + zOffset)
                     );
 
                     if (noiseValue > -0.5f) {
@@ -144,46 +149,13 @@ void Structure::generateBaseProceduralTree(Chunk& chunk, uint8_t x, uint8_t y, u
             }
         }
     }
-
-    for (const auto& [coord, changes] : chunkBlockChanges) {
-        Chunk* targetChunk = chunk.world->getChunk(coord.x, coord.z);
-        if (targetChunk) {
-            for (const auto& change : changes) {
-                targetChunk->setBlockType(change.localX, change.localY, change.localZ, change.blockType);
-            }
-            targetChunk->needsMeshUpdate = true;
-        }
-        else {
-            chunk.world->queueBlockChanges(coord.x, coord.z, changes);
-        }
-    }
 }
 
-void Structure::generateProceduralTreeOrangeLeaves(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z) {
-    uint8_t treeHeight = 10 + rand() % 6;
-
-    std::unordered_map<World::ChunkCoord, std::vector<BlockChange>, World::ChunkCoordHash> chunkBlockChanges;
+void Structure::generateProceduralTreeOrangeLeaves(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random) {
+    uint8_t treeHeight = 10 + random.nextInt(6);
 
     auto setLocalBlockType = [&](GLint offsetX, GLint offsetY, GLint offsetZ, uint8_t blockType) {
-        int32_t newX = x + offsetX;
-        int32_t newY = y + offsetY;
-        int32_t newZ = z + offsetZ;
-
-        int32_t globalX = chunk.chunkX * CHUNK_SIZE + newX;
-        int32_t globalZ = chunk.chunkZ * CHUNK_SIZE + newZ;
-
-        int32_t targetChunkX = globalX / CHUNK_SIZE;
-        if (globalX < 0 && globalX % CHUNK_SIZE != 0) targetChunkX -= 1;
-
-        int32_t targetChunkZ = globalZ / CHUNK_SIZE;
-        if (globalZ < 0 && globalZ % CHUNK_SIZE != 0) targetChunkZ -= 1;
-
-        int32_t localX = globalX - targetChunkX * CHUNK_SIZE;
-        int32_t localZ = globalZ - targetChunkZ * CHUNK_SIZE;
-
-        World::ChunkCoord targetCoord = { static_cast<int16_t>(targetChunkX), static_cast<int16_t>(targetChunkZ) };
-
-        chunkBlockChanges[targetCoord].push_back({ static_cast<int16_t>(localX), static_cast<int16_t>(newY), static_cast<int16_t>(localZ), blockType });
+        chunk.placeBlockIfInChunk(x + offsetX, y + offsetY, z + offsetZ, blockType);
     };
 
     for (uint8_t i = 0; i < treeHeight - 1; ++i) {
@@ -192,16 +164,16 @@ void Structure::generateProceduralTreeOrangeLeaves(Chunk& chunk, uint8_t x, uint
 
     setLocalBlockType(0, treeHeight - 1, 0, OAK_LEAF_ORANGE);
 
-    int8_t leafRadius = 3 + rand() % 2;
+    int8_t leafRadius = 3 + random.nextInt(2);
     int8_t leafStart = treeHeight - (leafRadius + 3);
 
     FastNoiseLite leafNoise;
-    leafNoise.SetSeed(rand() * 2);
+    leafNoise.SetSeed(static_cast<int>(random.next()));
     leafNoise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
     leafNoise.SetFrequency(1.5f);
 
     FastNoiseLite secondaryNoise;
-    secondaryNoise.SetSeed(rand() * 3);
+    secondaryNoise.SetSeed(static_cast<int>(random.next()));
     secondaryNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2S);
     secondaryNoise.SetFrequency(0.75f);
 
@@ -213,17 +185,17 @@ void Structure::generateProceduralTreeOrangeLeaves(Chunk& chunk, uint8_t x, uint
             for (int8_t zOffset = -radius; zOffset <= radius; ++zOffset) {
                 GLfloat distance = sqrtf(xOffset * xOffset + zOffset * zOffset);
 
-                if (distance <= radius + 0.5f) {
+                if (distance <= radius + 0.5f && chunk.containsColumn(x + xOffset, z + zOffset)) {
                     GLfloat noiseValue = leafNoise.GetNoise(
-                        static_cast<GLfloat>(chunk.chunkX * CHUNK_SIZE + x + xOffset),
+                        static_cast<GLfloat>(x + xOffset),
                         static_cast<GLfloat>(layerY),
-                        static_cast<GLfloat>(chunk.chunkZ * CHUNK_SIZE + z + zOffset)
+                        static_cast<GLfloat>(z + zOffset)
                     );
 
                     GLfloat secondaryNoiseValue = secondaryNoise.GetNoise(
-                        static_cast<GLfloat>(chunk.chunkX * CHUNK_SIZE + x + xOffset),
+                        static_cast<GLfloat>(x + xOffset),
                         static_cast<GLfloat>(layerY),
-                        static_cast<GLfloat>(chunk.chunkZ * CHUNK_SIZE + z + zOffset)
+                        static_cast<GLfloat>(z + zOffset)
                     );
 
                     if (noiseValue > -0.5f && secondaryNoiseValue > -0.3f) {
@@ -233,46 +205,13 @@ void Structure::generateProceduralTreeOrangeLeaves(Chunk& chunk, uint8_t x, uint
             }
         }
     }
-
-    for (const auto& [coord, changes] : chunkBlockChanges) {
-        Chunk* targetChunk = chunk.world->getChunk(coord.x, coord.z);
-        if (targetChunk) {
-            for (const auto& change : changes) {
-                targetChunk->setBlockType(change.localX, change.localY, change.localZ, change.blockType);
-            }
-            targetChunk->needsMeshUpdate = true;
-        }
-        else {
-            chunk.world->queueBlockChanges(coord.x, coord.z, changes);
-        }
-    }
 }
 
-void Structure::generateProceduralTreeYellowLeaves(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z) {
-    uint8_t treeHeight = 10 + rand() % 6;
-
-    std::unordered_map<World::ChunkCoord, std::vector<BlockChange>, World::ChunkCoordHash> chunkBlockChanges;
+void Structure::generateProceduralTreeYellowLeaves(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random) {
+    uint8_t treeHeight = 10 + random.nextInt(6);
 
     auto setLocalBlockType = [&](GLint offsetX, GLint offsetY, GLint offsetZ, uint8_t blockType) {
-        int32_t newX = x + offsetX;
-        int32_t newY = y + offsetY;
-        int32_t newZ = z + offsetZ;
-
-        int32_t globalX = chunk.chunkX * CHUNK_SIZE + newX;
-        int32_t globalZ = chunk.chunkZ * CHUNK_SIZE + newZ;
-
-        int32_t targetChunkX = globalX / CHUNK_SIZE;
-        if (globalX < 0 && globalX % CHUNK_SIZE != 0) targetChunkX -= 1;
-
-        int32_t targetChunkZ = globalZ / CHUNK_SIZE;
-        if (globalZ < 0 && globalZ % CHUNK_SIZE != 0) targetChunkZ -= 1;
-
-        int32_t localX = globalX - targetChunkX * CHUNK_SIZE;
-        int32_t localZ = globalZ - targetChunkZ * CHUNK_SIZE;
-
-        World::ChunkCoord targetCoord = { static_cast<int16_t>(targetChunkX), static_cast<int16_t>(targetChunkZ) };
-
-        chunkBlockChanges[targetCoord].push_back({ static_cast<int16_t>(localX), static_cast<int16_t>(newY), static_cast<int16_t>(localZ), blockType });
+        chunk.placeBlockIfInChunk(x + offsetX, y + offsetY, z + offsetZ, blockType);
     };
 
     for (uint8_t i = 0; i < treeHeight - 1; ++i) {
@@ -281,16 +220,16 @@ void Structure::generateProceduralTreeYellowLeaves(Chunk& chunk, uint8_t x, uint
 
     setLocalBlockType(0, treeHeight - 1, 0, OAK_LEAF_YELLOW);
 
-    int8_t leafRadius = 3 + rand() % 2;
+    int8_t leafRadius = 3 + random.nextInt(2);
     int8_t leafStart = treeHeight - (leafRadius + 3);
 
     FastNoiseLite leafNoise;
-    leafNoise.SetSeed(rand() * 5);
+    leafNoise.SetSeed(static_cast<int>(random.next()));
     leafNoise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
     leafNoise.SetFrequency(2.0f);
 
     FastNoiseLite cellularNoise;
-    cellularNoise.SetSeed(rand() * 7);
+    cellularNoise.SetSeed(static_cast<int>(random.next()));
     cellularNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2S);
     cellularNoise.SetFrequency(0.7f);
 
@@ -302,17 +241,17 @@ void Structure::generateProceduralTreeYellowLeaves(Chunk& chunk, uint8_t x, uint
             for (int8_t zOffset = -radius; zOffset <= radius; ++zOffset) {
                 GLfloat distance = sqrtf(xOffset * xOffset + zOffset * zOffset);
 
-                if (distance <= radius + 0.5f) {
+                if (distance <= radius + 0.5f && chunk.containsColumn(x + xOffset, z + zOffset)) {
                     GLfloat noiseValue = leafNoise.GetNoise(
-                        static_cast<GLfloat>(chunk.chunkX * CHUNK_SIZE + x + xOffset),
+                        static_cast<GLfloat>(x + xOffset),
                         static_cast<GLfloat>(layerY),
-                        static_cast<GLfloat>(chunk.chunkZ * CHUNK_SIZE + z + zOffset)
+                        static_cast<GLfloat>(z + zOffset)
                     );
 
                     GLfloat cellularNoiseValue = cellularNoise.GetNoise(
-                        static_cast<GLfloat>(chunk.chunkX * CHUNK_SIZE + x + xOffset),
+                        static_cast<GLfloat>(x + xOffset),
                         static_cast<GLfloat>(layerY),
-                        static_cast<GLfloat>(chunk.chunkZ * CHUNK_SIZE + z + zOffset)
+                        static_cast<GLfloat>(z + zOffset)
                     );
 
                     if (noiseValue > -0.2f && cellularNoiseValue < 0.3f) {
@@ -322,48 +261,15 @@ void Structure::generateProceduralTreeYellowLeaves(Chunk& chunk, uint8_t x, uint
             }
         }
     }
-
-    for (const auto& [coord, changes] : chunkBlockChanges) {
-        Chunk* targetChunk = chunk.world->getChunk(coord.x, coord.z);
-        if (targetChunk) {
-            for (const auto& change : changes) {
-                targetChunk->setBlockType(change.localX, change.localY, change.localZ, change.blockType);
-            }
-            targetChunk->needsMeshUpdate = true;
-        }
-        else {
-            chunk.world->queueBlockChanges(coord.x, coord.z, changes);
-        }
-    }
 }
 
-void Structure::generateBasePurpleTree(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z)
+void Structure::generateBasePurpleTree(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random)
 {
-    uint8_t trunkHeight = 3 + rand() % 2;
-    uint8_t leafHeight = 2 + rand() % 2;
-
-    std::unordered_map<World::ChunkCoord, std::vector<BlockChange>, World::ChunkCoordHash> chunkBlockChanges;
+    uint8_t trunkHeight = 3 + random.nextInt(2);
+    uint8_t leafHeight = 2 + random.nextInt(2);
 
     auto setLocalBlockType = [&](GLint offsetX, GLint offsetY, GLint offsetZ, uint8_t blockType) {
-        int32_t newX = x + offsetX;
-        int32_t newY = y + offsetY;
-        int32_t newZ = z + offsetZ;
-
-        int32_t globalX = chunk.chunkX * CHUNK_SIZE + newX;
-        int32_t globalZ = chunk.chunkZ * CHUNK_SIZE + newZ;
-
-        int32_t targetChunkX = globalX / CHUNK_SIZE;
-        if (globalX < 0 && globalX % CHUNK_SIZE != 0) targetChunkX -= 1;
-
-        int32_t targetChunkZ = globalZ / CHUNK_SIZE;
-        if (globalZ < 0 && globalZ % CHUNK_SIZE != 0) targetChunkZ -= 1;
-
-        int32_t localX = globalX - targetChunkX * CHUNK_SIZE;
-        int32_t localZ = globalZ - targetChunkZ * CHUNK_SIZE;
-
-        World::ChunkCoord targetCoord = { static_cast<int16_t>(targetChunkX), static_cast<int16_t>(targetChunkZ) };
-
-        chunkBlockChanges[targetCoord].push_back({ static_cast<int16_t>(localX), static_cast<int16_t>(newY), static_cast<int16_t>(localZ), blockType });
+        chunk.placeBlockIfInChunk(x + offsetX, y + offsetY, z + offsetZ, blockType);
     };
 
     // Generate trunk
@@ -374,7 +280,7 @@ void Structure::generateBasePurpleTree(Chunk& chunk, uint8_t x, uint8_t y, uint8
     // Generate branches
     int8_t branchStart = trunkHeight - 1;
     for (int8_t i = 0; i < 4; ++i) {
-        int8_t branchLength = 1 + rand() % 2;
+        int8_t branchLength = 1 + random.nextInt(2);
         int8_t offsetX = (i % 2 == 0) ? branchLength : 0;
         int8_t offsetZ = (i % 2 == 1) ? branchLength : 0;
 
@@ -388,22 +294,9 @@ void Structure::generateBasePurpleTree(Chunk& chunk, uint8_t x, uint8_t y, uint8
     }
 
     for (GLint i = 0; i < 4; ++i) {
-        int8_t offsetX = (i % 2 == 0) ? (1 + rand() % 2) : 0;
-        int8_t offsetZ = (i % 2 == 1) ? (1 + rand() % 2) : 0;
+        int8_t offsetX = (i % 2 == 0) ? (1 + random.nextInt(2)) : 0;
+        int8_t offsetZ = (i % 2 == 1) ? (1 + random.nextInt(2)) : 0;
 
         setLocalBlockType(offsetX, branchStart, offsetZ, OAK_LEAF_PURPLE);
     }
-
-    for (const auto& [coord, changes] : chunkBlockChanges) {
-        Chunk* targetChunk = chunk.world->getChunk(coord.x, coord.z);
-        if (targetChunk) {
-            for (const auto& change : changes) {
-                targetChunk->setBlockType(change.localX, change.localY, change.localZ, change.blockType);
-            }
-            targetChunk->needsMeshUpdate = true;
-        }
-        else {
-            chunk.world->queueBlockChanges(coord.x, coord.z, changes);
-        }
-    }
 }
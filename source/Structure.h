@@ -3,22 +3,40 @@
 
 #include <cstdint>
 #include <cmath>
+#include "WorldRandom.h"
 
 class Chunk;
 class World;
 
+// A structure rooted in a chunk. The terrain stage records it together with the random stream it
+// was picked with, the decoration stage of every chunk it reaches replays it from there
+struct StructureAnchor {
+    enum class Type : uint8_t { ProceduralTree, OrangeLeavesTree, YellowLeavesTree, PurpleTree };
+
+    Type type;
+    GLint x, y, z; // world coordinates of the trunk base
+    WorldRandom random;
+};
+
+// Structures are generated in world coordinates and only the blocks that fall inside the chunk being
+// decorated are written, so every chunk a structure crosses builds exactly its own part of it
 class Structure {
 public:
+    // No structure reaches further than this many blocks from its trunk horizontally
+    static constexpr GLint MAX_REACH = 4;
+
+    static void generate(Chunk& chunk, const StructureAnchor& anchor);
+
     //static void generateBaseTree(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z);
 
-    static void generateBaseProceduralTree(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z);
+    static void generateBaseProceduralTree(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random);
 
-    static void generateProceduralTreeOrangeLeaves(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z);
+    static void generateProceduralTreeOrangeLeaves(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random);
 
-    static void generateProceduralTreeYellowLeaves(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z);
+    static void generateProceduralTreeYellowLeaves(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random);
 
-    static void generateBasePurpleTree(Chunk& chunk, uint8_t x, uint8_t y, uint8_t z);
+    static void generateBasePurpleTree(Chunk& chunk, GLint x, GLint y, GLint z, WorldRandom& random);
 
 };
 
-#endif // STRUCTURES_H
\ No newline at end of file
+#endif // STRUCTURES_H
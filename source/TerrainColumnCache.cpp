@@ -0,0 +1,44 @@
+#include "TerrainColumnCache.h"
+
+std::shared_ptr<const TerrainRegion> TerrainColumnCache::getRegion(int16_t regionX, int16_t regionZ)
+{
+	int32_t key = getRegionKey(regionX, regionZ);
+	{
+		std::shared_lock<std::shared_mutex> lock(regionsMutex);
+		auto it = regions.find(key);
+		if (it != regions.end()) return it->second;
+	}
+
+	// Filled outside the lock, if another thread got there first its copy wins
+	auto region = std::make_shared<TerrainRegion>();
+	generator.getColumns(regionX * CHUNK_SIZE, regionZ * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, region->columns.data());
+
+	std::unique_lock<std::shared_mutex> lock(regionsMutex);
+	return regions.emplace(key, std::move(region)).first->second;
+}
+
+TerrainColumn TerrainColumnCache::getColumn(GLint x, GLint z) const
+{
+	GLint regionX = static_cast<GLint>(std::floor(static_cast<GLfloat>(x) / CHUNK_SIZE));
+	GLint regionZ = static_cast<GLint>(std::floor(static_cast<GLfloat>(z) / CHUNK_SIZE));
+	{
+		std::shared_lock<std::shared_mutex> lock(regionsMutex);
+		auto it = regions.find(getRegionKey(static_cast<int16_t>(regionX), static_cast<int16_t>(regionZ)));
+		if (it != regions.end()) {
+			return it->second->columns[(x - regionX * CHUNK_SIZE) * CHUNK_SIZE + (z - regionZ * CHUNK_SIZE)];
+		}
+	}
+	return generator.getColumn(x, z);
+}
+
+void TerrainColumnCache::evictRegion(int16_t regionX, int16_t regionZ)
+{
+	std::unique_lock<std::shared_mutex> lock(regionsMutex);
+	regions.erase(getRegionKey(regionX, regionZ));
+}
+
+size_t TerrainColumnCache::getRegionCount() const
+{
+	std::shared_lock<std::shared_mutex> lock(regionsMutex);
+	return regions.size();
+}
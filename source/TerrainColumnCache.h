@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Chunk.h"
+#include <memory>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <cmath>
+
+// Column data of one chunk sized region, indexed [x * CHUNK_SIZE + z]
+struct TerrainRegion {
+	std::array<TerrainColumn, CHUNK_SIZE * CHUNK_SIZE> columns;
+};
+
+// Caches the 2D terrain columns of loaded chunks so generation and height queries evaluate the
+// biome noise once per column. Regions are created by chunk generation and evicted when the chunk
+// unloads; readers hold a shared_ptr, so an eviction never pulls a region out from under them
+class TerrainColumnCache
+{
+public:
+	explicit TerrainColumnCache(const TerrainGenerator& generator) : generator(generator) {}
+
+	// Returns the cached region, generating and caching it first when missing
+	std::shared_ptr<const TerrainRegion> getRegion(int16_t regionX, int16_t regionZ);
+	// World coordinates, falls back to the generator without caching outside loaded regions
+	TerrainColumn getColumn(GLint x, GLint z) const;
+	void evictRegion(int16_t regionX, int16_t regionZ);
+
+	size_t getRegionCount() const;
+
+private:
+	static int32_t getRegionKey(int16_t regionX, int16_t regionZ) { return (static_cast<int32_t>(regionX) << 16) | static_cast<uint16_t>(regionZ); }
+
+	const TerrainGenerator& generator;
+	mutable std::shared_mutex regionsMutex;
+	std::unordered_map<int32_t, std::shared_ptr<const TerrainRegion>> regions;
+};
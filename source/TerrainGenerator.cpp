@@ -0,0 +1,135 @@
+#include "TerrainGenerator.h"
+
+TerrainGenerator::TerrainGenerator()
+	: forestBiome(BiomeTypes::Forest), desertBiome(BiomeTypes::Desert), plainsBiome(BiomeTypes::Plains), mountainBiome(BiomeTypes::Mountain)
+{
+	biomeNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+	biomeNoise.SetFrequency(0.0003f);
+
+	caveNoise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+	caveNoise.SetFractalOctaves(5);
+	caveNoise.SetFrequency(0.016f);
+}
+
+const Biomes& TerrainGenerator::getBiome(BiomeTypes type) const
+{
+	switch (type) {
+	case BiomeTypes::Desert:
+		return desertBiome;
+	case BiomeTypes::Plains:
+		return plainsBiome;
+	case BiomeTypes::Mountain:
+		return mountainBiome;
+	default:
+		return forestBiome;
+	}
+}
+
+GLfloat TerrainGenerator::smoothstep(GLfloat edge0, GLfloat edge1, GLfloat x)
+{
+	x = (x - edge0) / (edge1 - edge0);
+	x = std::clamp(x, 0.0f, 1.0f);
+	return x * x * (3 - 2 * x);
+}
+
+void TerrainGenerator::getBiomeWeights(GLfloat biomeNoiseValue, std::array<GLfloat, BIOME_COUNT>& weights) const
+{
+	GLfloat biomeValue = (biomeNoiseValue + 1.0f) / 2.0f;
+
+	for (size_t i = 0; i < biomes.size(); ++i) {
+		const BiomeData& biome = biomes[i];
+		GLfloat weight = 0.0f;
+
+		if (biome.type == BiomeTypes::Desert) {
+			weight = 1.0f - smoothstep(biome.edge0, biome.edge1, biomeValue);
+		}
+		else if (biome.type == BiomeTypes::Plains) {
+			weight = smoothstep(biome.edge0, biome.edge1, biomeValue) * (1.0f - smoothstep(biome.edge2, biome.edge3, biomeValue));
+		}
+		else if (biome.type == BiomeTypes::Forest) {
+			weight = smoothstep(biome.edge0, biome.edge1, biomeValue);
+		}
+		else if (biome.type == BiomeTypes::Mountain) {
+			weight = smoothstep(biome.edge0, biome.edge1, biomeValue) * (1.0f - smoothstep(biome.edge2, biome.edge3, biomeValue));
+		}
+		weights[i] = weight;
+	}
+
+	GLfloat totalWeight = 0.0f;
+	for (GLfloat weight : weights) {
+		totalWeight += weight;
+	}
+	if (totalWeight > 0.0f) {
+		for (GLfloat& weight : weights) {
+			weight /= totalWeight;
+		}
+	}
+}
+
+GLfloat TerrainGenerator::getBlendedHeight(GLint x, GLint z, const std::array<GLfloat, BIOME_COUNT>& weights) const
+{
+	GLfloat blendedHeight = 0.0f;
+	for (size_t i = 0; i < biomes.size(); ++i) {
+		if (weights[i] > 0.0f) {
+			GLfloat height = static_cast<GLfloat>(getBiome(biomes[i].type).getTerrainHeightAt(x, z));
+			blendedHeight += height * weights[i];
+		}
+	}
+	return blendedHeight;
+}
+
+void TerrainGenerator::setPrimaryBiomeAndCaves(TerrainColumn& column) const
+{
+	size_t primaryBiomeIndex = std::distance(column.biomeWeights.begin(), std::max_element(column.biomeWeights.begin(), column.biomeWeights.end()));
+	column.primaryBiome = &getBiome(biomes[primaryBiomeIndex].type);
+
+	column.caveThreshold = 0.0f;
+	for (size_t i = 0; i < biomes.size(); ++i) {
+		column.caveThreshold += column.biomeWeights[i] * biomes[i].caveThreshold;
+	}
+}
+
+TerrainColumn TerrainGenerator::getColumn(GLint x, GLint z) const
+{
+	TerrainColumn column;
+	getBiomeWeights(biomeNoise.GetNoise(static_cast<GLfloat>(x), static_cast<GLfloat>(z)), column.biomeWeights);
+	column.height = static_cast<GLint>(getBlendedHeight(x, z, column.biomeWeights));
+	setPrimaryBiomeAndCaves(column);
+	return column;
+}
+
+void TerrainGenerator::getColumns(GLint originX, GLint originZ, GLint sizeX, GLint sizeZ, TerrainColumn* columns) const
+{
+	GLint count = sizeX * sizeZ;
+	std::vector<GLfloat> samples(count);
+	biomeNoise.fillPlane(originX, originZ, sizeX, sizeZ, 1, samples.data());
+	for (GLint i = 0; i < count; ++i) {
+		getBiomeWeights(samples[i], columns[i].biomeWeights);
+	}
+
+	// Blended per biome rather than per column so each biome's height noise runs as one plane, and only
+	// for biomes that reach into the area. Per column the sum still adds up in getBlendedHeight's order
+	std::vector<GLfloat> blendedHeights(count, 0.0f);
+	std::vector<GLint> heights(count);
+	for (size_t b = 0; b < biomes.size(); ++b) {
+		bool isPresent = std::any_of(columns, columns + count, [b](const TerrainColumn& column) { return column.biomeWeights[b] > 0.0f; });
+		if (!isPresent) continue;
+
+		getBiome(biomes[b].type).getTerrainHeights(originX, originZ, sizeX, sizeZ, heights.data());
+		for (GLint i = 0; i < count; ++i) {
+			if (columns[i].biomeWeights[b] > 0.0f) {
+				blendedHeights[i] += static_cast<GLfloat>(heights[i]) * columns[i].biomeWeights[b];
+			}
+		}
+	}
+
+	for (GLint i = 0; i < count; ++i) {
+		columns[i].height = static_cast<GLint>(blendedHeights[i]);
+		setPrimaryBiomeAndCaves(columns[i]);
+	}
+}
+
+void TerrainGenerator::fillCaveNoise(GLint originX, GLint originY, GLint originZ, GLint sizeX, GLint sizeY, GLint sizeZ, GLint step, GLfloat* out) const
+{
+	caveNoise.fillBlock(originX, originY, originZ, sizeX, sizeY, sizeZ, step, out);
+}
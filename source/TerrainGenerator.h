@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Biomes.h"
+#include <array>
+#include <algorithm>
+#include <vector>
+
+struct BiomeData {
+	GLfloat minThreshold, maxThreshold;
+	BiomeTypes type;
+	GLfloat baseFrequency;
+	GLfloat caveThreshold;
+	GLfloat edge0, edge1, edge2, edge3;
+};
+
+constexpr uint8_t BIOME_COUNT = 4;
+
+// Everything generateChunk needs to know about one world column
+struct TerrainColumn {
+	std::array<GLfloat, BIOME_COUNT> biomeWeights; // Normalised, same order as TerrainGenerator::getBiomes()
+	GLint height;
+	GLfloat caveThreshold;
+	const Biomes* primaryBiome;
+};
+
+// Biome blending, terrain height and cave noise shared by every chunk. All noise is configured in the
+// constructor and only read afterwards, so the chunk loading threads can use one instance concurrently
+class TerrainGenerator
+{
+public:
+	TerrainGenerator();
+
+	TerrainColumn getColumn(GLint x, GLint z) const;
+	// Same columns for a sizeX * sizeZ area from (originX, originZ), noise is sampled a plane at a time.
+	// Indexed [x * sizeZ + z]
+	void getColumns(GLint originX, GLint originZ, GLint sizeX, GLint sizeZ, TerrainColumn* columns) const;
+	// Raw 3D cave noise on a lattice every step blocks, a block is carved where it exceeds the column's
+	// cave threshold. Indexed [(x * sizeZ + z) * sizeY + y]
+	void fillCaveNoise(GLint originX, GLint originY, GLint originZ, GLint sizeX, GLint sizeY, GLint sizeZ, GLint step, GLfloat* out) const;
+
+	const std::array<BiomeData, BIOME_COUNT>& getBiomes() const { return biomes; }
+	const Biomes& getBiome(BiomeTypes type) const;
+
+private:
+	static GLfloat smoothstep(GLfloat edge0, GLfloat edge1, GLfloat x);
+	void getBiomeWeights(GLfloat biomeNoiseValue, std::array<GLfloat, BIOME_COUNT>& weights) const;
+	GLfloat getBlendedHeight(GLint x, GLint z, const std::array<GLfloat, BIOME_COUNT>& weights) const;
+	void setPrimaryBiomeAndCaves(TerrainColumn& column) const;
+
+	BatchNoise biomeNoise, caveNoise;
+	Biomes forestBiome, desertBiome, plainsBiome, mountainBiome;
+
+	const std::array<BiomeData, BIOME_COUNT> biomes = { {
+		{0.0f, 0.33f, BiomeTypes::Desert, 0.0011f, 0.5f, 0.2f, 0.4f, 0.0f, 0.0f},
+		{0.33f, 0.5f, BiomeTypes::Plains, 0.0003f, 0.98f, 0.3f, 0.4f, 0.6f, 0.7f},
+		{0.5f, 0.8f, BiomeTypes::Forest, 0.002f, 0.85f, 0.6f, 0.8f, 0.0f, 0.0f},
+		{0.8f, 1.0f, BiomeTypes::Mountain, 0.005f, 0.9f, 0.6f, 0.7f, 0.6f, 0.8f}
+	} };
+};
@@ -1,92 +1,199 @@
 #pragma once
 #include <vector>
-#include <queue>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <future>
 #include <atomic>
-#include <exception>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <stdexcept>
+#include <algorithm>
 #include <chrono>
 
+// A move-only callable that keeps small callables inside itself instead of on the heap. Every chunk
+// job the world queues fits, larger ones still work but cost an allocation.
+class Task {
+public:
+    static constexpr size_t INLINE_SIZE = 112;
+
+    Task() = default;
+
+    template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    Task(F&& f) {
+        using Callable = std::decay_t<F>;
+        if constexpr (isStoredInline<Callable>()) {
+            new (storage) Callable(std::forward<F>(f));
+        }
+        else {
+            *reinterpret_cast<Callable**>(storage) = new Callable(std::forward<F>(f));
+        }
+        operations = &operationsFor<Callable>;
+    }
+
+    Task(Task&& other) noexcept {
+        moveFrom(other);
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        reset();
+    }
+
+    void operator()() {
+        operations->invoke(storage);
+    }
+
+    explicit operator bool() const {
+        return operations != nullptr;
+    }
+
+    // Destroys the callable and whatever it captured.
+    void reset() {
+        if (operations) {
+            operations->destroy(storage);
+            operations = nullptr;
+        }
+    }
+
+private:
+    struct Operations {
+        void (*invoke)(void* storage);
+        // Move constructs the callable into to and destroys the one left in from.
+        void (*move)(void* from, void* to);
+        void (*destroy)(void* storage);
+    };
+
+    template<class Callable>
+    static constexpr bool isStoredInline() {
+        return sizeof(Callable) <= INLINE_SIZE && alignof(Callable) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<Callable>;
+    }
+
+    template<class Callable>
+    static constexpr Operations operationsFor = isStoredInline<Callable>() ?
+        Operations{
+            [](void* storage) { (*std::launder(reinterpret_cast<Callable*>(storage)))(); },
+            [](void* from, void* to) {
+                Callable* callable = std::launder(reinterpret_cast<Callable*>(from));
+                new (to) Callable(std::move(*callable));
+                callable->~Callable();
+            },
+            [](void* storage) { std::launder(reinterpret_cast<Callable*>(storage))->~Callable(); }
+        } :
+        Operations{
+            [](void* storage) { (**reinterpret_cast<Callable**>(storage))(); },
+            [](void* from, void* to) { *reinterpret_cast<Callable**>(to) = *reinterpret_cast<Callable**>(from); },
+            [](void* storage) { delete *reinterpret_cast<Callable**>(storage); }
+        };
+
+    void moveFrom(Task& other) {
+        if (other.operations) {
+            other.operations->move(other.storage, storage);
+            operations = other.operations;
+            other.operations = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+    const Operations* operations = nullptr;
+};
+
+// Urgent tasks start before every normal task that hasn't started yet, for the little work the player
+// waits on while the world streams.
+enum class TaskPriority : uint8_t {
+    Urgent,
+    Normal
+};
+
+// Work-stealing thread pool. Every worker has its own queue behind its own lock, so submitting and
+// taking tasks no longer funnels every thread through one mutex. A worker submitting work keeps it in
+// its own queue, a thread outside the pool is given one of the queues, and a worker that runs dry
+// steals from the others before it goes to sleep. Each queue runs its tasks oldest first, like the
+// single queue did. Urgent tasks share one more queue every worker looks at first.
 class ThreadPool {
 public:
     // Initializes the thread pool with a specified number of threads and optional delay.
     ThreadPool(size_t threads, std::chrono::milliseconds delay = std::chrono::milliseconds(0))
-        : stop(false), delay(delay) {
-
-        // Reserve space for worker threads.
-        workers.reserve(threads);
-
-        // Create and start the specified number of worker threads.
-        for (size_t i = 0; i < threads; ++i) {
-            workers.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;  // A task to be executed by the thread.
-
-                    // Acquire lock to safely access the task queue.
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-
-                        // Wait until there is a task to execute or the pool is stopping.
-                        this->condition.wait(lock, [this] {
-                            return this->stop.load() || !this->tasks.empty();
-                        });
-
-                        // If stop is true and there are no remaining tasks, exit the loop.
-                        if (this->stop.load() && this->tasks.empty())
-                            return;
-
-                        // Get the next task from the queue.
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
-                    }
-
-                    // If a delay is specified, the thread sleeps for the given duration before executing the task.
-                    if (this->delay.count() > 0) {
-                        std::this_thread::sleep_for(this->delay);
-                    }
-
-                    // Execute the task.
-                    task();
-                }
-            });
+        : queues(std::max<size_t>(threads, 1)), delay(delay) {
+
+        workers.reserve(queues.size());
+        for (size_t i = 0; i < queues.size(); ++i) {
+            workers.emplace_back([this, i] { runWorker(i); });
         }
     }
 
-    // Enqueue a new task to be executed by the thread pool.
+    // Enqueue a new task to be executed by the thread pool. The future costs a shared state
+    // allocation, fire-and-forget work should use submit instead.
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args) -> std::future<typename std::invoke_result<F, Args...>::type> {
         using return_type = typename std::invoke_result<F, Args...>::type;
 
-        // Wrap the task into a packaged_task to handle the return value.
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+        std::packaged_task<return_type()> task(
+            [f = std::forward<F>(f), arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable -> return_type {
+                return std::apply(std::move(f), std::move(arguments));
+            }
         );
 
         // Retrieve the future from the packaged_task so we can access the result later.
-        std::future<return_type> res = task->get_future();
-
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex);
+        std::future<return_type> res = task.get_future();
+        submit([task = std::move(task)]() mutable { task(); });
+        return res;
+    }
 
-            // If the pool is stopping, don't allow new tasks to be enqueued.
-            if (stop.load())
-                throw std::runtime_error("enqueue on stopped ThreadPool");
+    // Queues a task nobody waits for. Nothing is allocated when its captures fit in a Task.
+    void submit(Task task, TaskPriority priority = TaskPriority::Normal) {
+        // If the pool is stopping, don't allow new tasks to be enqueued.
+        if (stop.load())
+            throw std::runtime_error("enqueue on stopped ThreadPool");
 
-            // Add the task to the queue as a lambda function.
-            tasks.emplace([task]() { (*task)(); });
+        pendingTasks.fetch_add(1);
+        bool isUrgent = priority == TaskPriority::Urgent;
+        WorkerQueue& queue = isUrgent ? urgentQueue : queues[getSubmitQueue()];
+        {
+            // Counted under the queue's lock, so the count never falls behind what the queues hold.
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+            queuedTasks.fetch_add(1);
+            if (isUrgent)
+                queuedUrgentTasks.fetch_add(1);
         }
 
-        // Notify one worker thread that a new task is available.
-        condition.notify_one();
-        return res;
+        // A worker that was woken and still looks for a task will find this one, or wake the next
+        // worker when it finds another.
+        if (searchingWorkers.load() == 0)
+            wakeWorker();
+    }
+
+    // Blocks until every queued task has finished and been destroyed.
+    void waitForIdle() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idleWaiters.fetch_add(1);
+        idleCondition.wait(lock, [this] { return pendingTasks.load() == 0; });
+        idleWaiters.fetch_sub(1);
     }
 
-    // Waits for all worker threads to finish and cleans up resources.
+    // Waits for all worker threads to finish the queued tasks and cleans up resources.
     ~ThreadPool() {
-        stop.store(true);
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stop.store(true);
+        }
         condition.notify_all();
 
         // Join all worker threads (wait for them to finish).
@@ -97,20 +204,141 @@ public:
     }
 
 private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Which pool and queue the calling thread works for, null for threads outside any pool.
+    static inline thread_local const ThreadPool* currentPool = nullptr;
+    static inline thread_local size_t currentQueue = 0;
+    // The queue a thread outside the pool last submitted to, it keeps using it so its tasks stay in
+    // one place and the other workers steal them, instead of every worker being woken for its share.
+    static inline thread_local const ThreadPool* submitterPool = nullptr;
+    static inline thread_local size_t submitterQueue = 0;
+
+    size_t getSubmitQueue() {
+        if (currentPool == this)
+            return currentQueue;
+        if (submitterPool != this) {
+            submitterPool = this;
+            submitterQueue = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        }
+        return submitterQueue;
+    }
+
+    void runWorker(size_t index) {
+        currentPool = this;
+        currentQueue = index;
+        bool searching = false;
+        while (true) {
+            Task task;
+            if (takeTask(index, task)) {
+                // The last worker looking for tasks found one, another has to look for the rest.
+                if (searching) {
+                    searching = false;
+                    if (searchingWorkers.fetch_sub(1) == 1 && queuedTasks.load() > 0)
+                        wakeWorker();
+                }
+
+                // If a delay is specified, the thread sleeps for the given duration before executing the task.
+                if (delay.count() > 0) {
+                    std::this_thread::sleep_for(delay);
+                }
+
+                task();
+                // Captures are released before the task counts as finished, waitForIdle relies on it.
+                task.reset();
+                finishTask();
+                continue;
+            }
+
+            if (searching) {
+                searching = false;
+                searchingWorkers.fetch_sub(1);
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepingWorkers.fetch_add(1);
+            condition.wait(lock, [this] { return stop.load() || queuedTasks.load() > 0; });
+            sleepingWorkers.fetch_sub(1);
+            searching = true;
+            searchingWorkers.fetch_add(1);
+
+            // If stop is true and there are no remaining tasks, exit the loop.
+            if (stop.load() && queuedTasks.load() == 0)
+                return;
+        }
+    }
+
+    // Takes the oldest urgent task, otherwise the oldest task of the worker's own queue, otherwise steals
+    // the oldest one of another queue.
+    bool takeTask(size_t index, Task& task) {
+        if (queuedUrgentTasks.load() > 0) {
+            std::lock_guard<std::mutex> lock(urgentQueue.mutex);
+            if (!urgentQueue.tasks.empty()) {
+                task = std::move(urgentQueue.tasks.front());
+                urgentQueue.tasks.pop_front();
+                queuedUrgentTasks.fetch_sub(1);
+                queuedTasks.fetch_sub(1);
+                return true;
+            }
+        }
+
+        for (size_t offset = 0; offset < queues.size(); ++offset) {
+            WorkerQueue& queue = queues[(index + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                queuedTasks.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Only a sleeping worker needs waking. Taking the sleep mutex makes sure one that just decided
+    // to sleep is already waiting when it is notified.
+    void wakeWorker() {
+        if (sleepingWorkers.load() > 0) {
+            { std::lock_guard<std::mutex> lock(sleepMutex); }
+            condition.notify_one();
+        }
+    }
+
+    void finishTask() {
+        // Wake up anyone waiting in waitForIdle once the last task has finished.
+        if (pendingTasks.fetch_sub(1) == 1 && idleWaiters.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            idleCondition.notify_all();
+        }
+    }
+
     // Vector of worker threads.
     std::vector<std::thread> workers;
 
-    // Queue of tasks to be executed by the workers.
-    std::queue<std::function<void()>> tasks;
+    // One queue per worker, threads outside the pool are given them in turn.
+    std::vector<WorkerQueue> queues;
+    std::atomic<size_t> nextQueue = 0;
+    WorkerQueue urgentQueue;
 
-    // Mutex to protect access to the task queue.
-    std::mutex queue_mutex;
+    // Tasks sitting in a queue, the urgent ones among them, and tasks queued or running.
+    std::atomic<size_t> queuedTasks = 0;
+    std::atomic<size_t> queuedUrgentTasks = 0;
+    std::atomic<size_t> pendingTasks = 0;
 
-    // Condition variable to notify worker threads when new tasks are available.
+    // Idle workers sleep on condition, waitForIdle on idleCondition.
+    std::mutex sleepMutex;
     std::condition_variable condition;
+    std::condition_variable idleCondition;
+    std::atomic<size_t> sleepingWorkers = 0;
+    // Workers woken that haven't found a task yet.
+    std::atomic<size_t> searchingWorkers = 0;
+    std::atomic<size_t> idleWaiters = 0;
 
     // Flag to indicate when the pool is stopping.
-    std::atomic<bool> stop;
+    std::atomic<bool> stop = false;
 
     // Delay between task executions.
     std::chrono::milliseconds delay;
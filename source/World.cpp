@@ -1,32 +1,89 @@
 #include "World.h"
+#include "LightEngine.h"
+#include <fstream>
+#include <iostream>
 
-World::World(const Frustum& frustum) : playerChunkX(0), playerChunkZ(0), chunkLoadQueue(ChunkCoordComparator(*this)), textureManager(), threadPool(std::thread::hardware_concurrency()) {
-	std::srand(static_cast<GLuint>(std::time(0)));
-
-	for (int8_t x = -renderDistance + 1; x <= renderDistance - 1; ++x)
+World::World(const Frustum& frustum, GLuint seed) : playerChunkX(0), playerChunkZ(0), seed(seed), textureManager(), chunkStorage(std::filesystem::path("saves") / std::to_string(seed)), threadPool(std::thread::hardware_concurrency()) {
+	for (int16_t x = -renderDistance + 1 - pipelineMargin; x <= renderDistance - 1 + pipelineMargin; ++x)
 	{
-		for (int8_t z = -renderDistance + 1; z <= renderDistance - 1; ++z)
+		for (int16_t z = -renderDistance + 1 - pipelineMargin; z <= renderDistance - 1 + pipelineMargin; ++z)
 		{
-			queueChunkLoad(x, z);
+			if (isWithinStreamingDistance(x, z, renderDistance - 1, pipelineMargin))
+			{
+				queueChunkLoad(x, z);
+			}
 		}
 	}
-	processChunkLoadQueue(renderDistance * renderDistance, 0.5);
+	processChunkLoadQueue(static_cast<uint8_t>(std::min(renderDistance * renderDistance, 255)), 0.5);
+}
+
+GLuint World::loadOrCreateSeed()
+{
+	const std::filesystem::path path = std::filesystem::path("saves") / "world.dat";
+	std::error_code error;
+	if (std::filesystem::exists(path, error)) {
+		std::ifstream file(path, std::ios::binary);
+		uint32_t contents[3] = {};
+		if (file.read(reinterpret_cast<char*>(contents), sizeof(contents)) && contents[0] == WORLD_FILE_MAGIC && contents[1] == WORLD_FILE_VERSION) {
+			return contents[2];
+		}
+		std::cerr << "World file " << path.string() << " is unreadable, starting a new world" << std::endl;
+	}
+
+	// Written next to the file and moved over it, a launch that stops halfway never leaves half a file behind
+	const GLuint seed = static_cast<GLuint>(std::time(nullptr));
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += ".tmp";
+	std::filesystem::create_directories(path.parent_path(), error);
+	bool isWritten = false;
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		const uint32_t contents[3] = { WORLD_FILE_MAGIC, WORLD_FILE_VERSION, seed };
+		isWritten = static_cast<bool>(file.write(reinterpret_cast<const char*>(contents), sizeof(contents)).flush());
+	}
+	if (isWritten) std::filesystem::rename(temporaryPath, path, error);
+	if (!isWritten || error) {
+		std::cerr << "Failed to save the world seed to " << path.string() << ", the next launch starts a new world" << std::endl;
+	}
+	return seed;
 }
 
 World::~World()
 {
-	std::lock_guard<std::mutex> lock(chunksMutex);
-	for (auto& pair : chunks)
+	threadPool.waitForIdle();
+
+	saveUnloadedEdits();
+
+	// Every load job has finished, the chunks that never made it into the grid go as well
+	for (auto& [coord, pendingChunk] : pendingChunks)
+	{
+		delete pendingChunk.chunk.get();
+	}
+
+	std::vector<uint8_t> data;
+	for (Chunk* chunk : chunks)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(chunk->blockDataMutex);
+			saveChunk(chunk, data);
+		}
+		delete chunk;
+	}
+	std::vector<Chunk*> retiredChunks;
+	chunkReclaimer.drain(retiredChunks);
+	for (Chunk* chunk : retiredChunks)
 	{
-		delete pair.second;
+		delete chunk;
 	}
 }
 
 bool World::isInitialChunksLoaded() {
-	for (int8_t x = -renderDistance + 1; x <= renderDistance - 1; ++x) {
-		for (int8_t z = -renderDistance + 1; z <= renderDistance - 1; ++z) {
-			ChunkCoord coord = { x, z };
-			if (!isChunkLoaded(coord.x, coord.z)) {
+	for (int16_t x = -renderDistance + 1; x <= renderDistance - 1; ++x) {
+		for (int16_t z = -renderDistance + 1; z <= renderDistance - 1; ++z) {
+			if (!isWithinStreamingDistance(x, z, renderDistance - 1, 0)) continue;
+
+			Chunk* chunk = getChunk(x, z);
+			if (!chunk || !chunk->hasReached(ChunkState::Decorated)) {
 				return false;
 			}
 		}
@@ -34,107 +91,147 @@ bool World::isInitialChunksLoaded() {
 	return true;
 }
 
-void World::Draw(const Frustum& frustum) {
-	std::vector<Chunk*> chunksToDraw, chunksNeedingUpdate;
+void World::Draw(const Frustum& frustum, shader& chunkShader) {
+	std::vector<Chunk*> chunksToDraw, idleChunks;
 
-	{
-		std::lock_guard<std::mutex> lock(chunksMutex);
-		for (auto& pair : chunks) {
-			Chunk* chunk = pair.second;
-			if (chunk) {
-				if (chunk->needsMeshUpdate) {
-					chunksNeedingUpdate.push_back(chunk);
-				}
-				if (chunk->isInFrustum(frustum)) {
-					chunksToDraw.push_back(chunk);
-				}
-			}
+	for (Chunk* chunk : chunks) {
+		if (chunk->getState() != ChunkState::Meshing) {
+			idleChunks.push_back(chunk);
+		}
+		if (chunk->isInFrustum(frustum)) {
+			chunksToDraw.push_back(chunk);
 		}
 	}
 
-	std::vector<std::future<void>> futures;
-	for (Chunk* chunk : chunksNeedingUpdate) {
-		futures.push_back(threadPool.enqueue([chunk]() {
-			chunk->generateMesh(chunk->getBlockTypes());
-			chunk->needsMeshUpdate = false;
-		}));
-	}
-
-	for (auto& future : futures) future.get();
+	updateChunkMeshes(idleChunks);
 
 	for (Chunk* chunk : chunksToDraw) {
-		chunk->updateOpenGLBuffers();
-		chunk->Draw();
+		if (bytesUploadedThisFrame < meshUploadBudget) {
+			bytesUploadedThisFrame += chunk->updateOpenGLBuffers();
+		}
+		chunk->Draw(chunkShader);
 	}
 }
 
 void World::DrawWater(const Frustum& frustum, shader& waterShader, glm::mat4 view, glm::mat4 projection, glm::vec3 lightDirection, Camera& camera) {
-	std::vector<Chunk*> chunksToDraw, chunksNeedingUpdate;
+	std::vector<Chunk*> chunksToDraw;
 
-	{
-		std::lock_guard<std::mutex> lock(chunksMutex);
-		for (auto& pair : chunks) {
-			Chunk* chunk = pair.second;
-			if (chunk) {
-				if (chunk->needsMeshUpdate) {
-					if (chunk->isInFrustum(frustum)) {
-						chunksNeedingUpdate.push_back(chunk);
-					}
-				}
-				if (chunk->isInFrustum(frustum)) {
-					chunksToDraw.push_back(chunk);
-				}
-			}
+	for (Chunk* chunk : chunks) {
+		if (chunk->isInFrustum(frustum)) {
+			chunksToDraw.push_back(chunk);
 		}
 	}
 
-	std::vector<std::future<void>> futures;
-	for (Chunk* chunk : chunksNeedingUpdate) {
-		futures.push_back(threadPool.enqueue([chunk]() {
-			chunk->generateMesh(chunk->getBlockTypes());
-			chunk->needsMeshUpdate = false;
-		}));
+	for (Chunk* chunk : chunksToDraw) {
+		if (bytesUploadedThisFrame < meshUploadBudget) {
+			bytesUploadedThisFrame += chunk->updateOpenGLWaterBuffers();
+		}
+		chunk->DrawWater(waterShader, view, projection, lightDirection, camera);
 	}
+}
 
-	for (auto& future : futures) future.get();
+void World::updateChunkMeshes(const std::vector<Chunk*>& idleChunks) {
+	for (Chunk* chunk : idleChunks) {
+		// A player edit is uploaded as soon as it is meshed, whatever streaming used of the budget
+		if ((chunk->hasEditedBackMesh || bytesUploadedThisFrame < meshUploadBudget) && chunk->publishBackMesh()) {
+			chunk->hasEditedBackMesh = false;
+			bytesUploadedThisFrame += chunk->updateOpenGLBuffers();
+			bytesUploadedThisFrame += chunk->updateOpenGLWaterBuffers();
+		}
 
-	for (Chunk* chunk : chunksToDraw) {
-		chunk->updateOpenGLWaterBuffers();
-		chunk->DrawWater(waterShader, view, projection, lightDirection, camera);
+		ChunkState state = chunk->getState();
+		if (state == ChunkState::Decorated && isNeighbourhoodAtLeast(chunk, ChunkState::Decorated)) {
+			queueLightSpread(chunk);
+		}
+
+		// Meshing starts from Lit or Uploaded only, so a chunk never has two mesh jobs and the back buffer is
+		// only rebuilt once its previous contents have been published. A chunk also waits until no neighbour
+		// can change its blocks or light any more. Only the sections dirtied since the last build are meshed again
+		if (state != ChunkState::Lit && state != ChunkState::Uploaded) continue;
+		if (!chunk->hasDirtySections() || !isNeighbourhoodAtLeast(chunk, ChunkState::Lit)) continue;
+		if (!chunk->advanceState(state, ChunkState::Meshing)) continue;
+
+		uint8_t editedSections = chunk->editedSections.exchange(0);
+		uint8_t sections = chunk->dirtySections.exchange(0) | editedSections;
+		chunk->hasEditedBackMesh = editedSections != 0;
+		threadPool.submit([chunk, sections, pin = chunkReclaimer.pin()]() {
+			chunk->buildBackMesh(sections);
+		}, editedSections != 0 ? TaskPriority::Urgent : TaskPriority::Normal);
 	}
 }
 
+void World::deleteRetiredChunks() {
+	std::vector<Chunk*> retiredChunks;
+	chunkReclaimer.collect(retiredChunks);
+	if (retiredChunks.empty()) return;
+
+	// The GL objects of all retired chunks go in one call per kind instead of three per section
+	std::vector<GLuint> vertexArrays, buffers;
+	for (Chunk* chunk : retiredChunks) {
+		chunk->releaseBuffers(vertexArrays, buffers);
+		delete chunk;
+	}
+	glDeleteVertexArrays(static_cast<GLsizei>(vertexArrays.size()), vertexArrays.data());
+	glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+}
+
 void World::updatePlayerPosition(const glm::vec3& position, const Frustum& frustum)
 {
 	int16_t newChunkX = static_cast<int16_t>(std::floor(position.x / CHUNK_SIZE));
 	int16_t newChunkZ = static_cast<int16_t>(std::floor(position.z / CHUNK_SIZE));
 
-	if (newChunkX != playerChunkX || newChunkZ != playerChunkZ)
+	if (newChunkX != playerChunkX || newChunkZ != playerChunkZ || isStreamingAreaChanged)
 	{
+		int16_t oldChunkX = playerChunkX;
+		int16_t oldChunkZ = playerChunkZ;
 		playerChunkX = newChunkX;
 		playerChunkZ = newChunkZ;
+		isStreamingAreaChanged = false;
+		queueUnloadsAfterMove(oldChunkX, oldChunkZ);
 
-		for (int16_t dx = -renderDistance; dx <= renderDistance; ++dx)
+		// Loads the player moved away from stop at their next stage, their chunks would be unloaded right away
+		for (auto& [coord, pendingChunk] : pendingChunks)
 		{
-			for (int16_t dz = -renderDistance; dz <= renderDistance; ++dz)
+			if (!isWithinUnloadDistance(coord.x, coord.z))
 			{
-				int16_t chunkX = playerChunkX + dx;
-				int16_t chunkZ = playerChunkZ + dz;
+				pendingChunk.cancellation.request_stop();
+			}
+		}
+		rebuildChunkLoadQueue(frustum);
+	}
+	else if (isLoadQueueRebuildNeeded || glm::dot(frustum.getViewDirection(), rankedViewDirection) < viewTurnThreshold)
+	{
+		rebuildChunkLoadQueue(frustum);
+	}
+}
 
-				if (isChunkInFrustum(chunkX, chunkZ, frustum) && !isChunkLoaded(chunkX, chunkZ))
-				{
-					queueChunkLoad(chunkX, chunkZ);
-				}
+void World::rebuildChunkLoadQueue(const Frustum& frustum)
+{
+	isLoadQueueRebuildNeeded = false;
+	rankedViewDirection = frustum.getViewDirection();
+
+	chunkLoadQueue.clear();
+	for (int16_t dx = -renderDistance - pipelineMargin; dx <= renderDistance + pipelineMargin; ++dx)
+	{
+		for (int16_t dz = -renderDistance - pipelineMargin; dz <= renderDistance + pipelineMargin; ++dz)
+		{
+			int16_t chunkX = playerChunkX + dx;
+			int16_t chunkZ = playerChunkZ + dz;
+
+			if (isWithinLoadDistance(chunkX, chunkZ) && isChunkInFrustum(chunkX, chunkZ, frustum) && !isChunkLoaded(chunkX, chunkZ)
+				&& pendingChunks.find({ chunkX, chunkZ }) == pendingChunks.end())
+			{
+				chunkLoadQueue.push_back({ { chunkX, chunkZ }, getChunkLoadPriority(chunkX, chunkZ) });
 			}
 		}
 	}
+	std::make_heap(chunkLoadQueue.begin(), chunkLoadQueue.end());
 }
 
 void World::processChunkLoadQueue(uint8_t maxChunksToLoad, uint16_t delay)
 {
 	static auto lastChunkLoadTime = std::chrono::steady_clock::now();
 	uint8_t chunksLoaded = 0;
-	std::vector<ChunkCoord> tempUnloadList;
 
 	auto currentTime = std::chrono::steady_clock::now();
 	auto timeSinceLastChunk = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastChunkLoadTime).count();
@@ -142,35 +239,51 @@ void World::processChunkLoadQueue(uint8_t maxChunksToLoad, uint16_t delay)
 	while (!chunkLoadQueue.empty() && chunksLoaded < maxChunksToLoad) 
 	{
 		if (timeSinceLastChunk < delay)
-			return;
+			break;
 
-		ChunkCoord coord = chunkLoadQueue.top();
-		chunkLoadQueue.pop();
+		std::pop_heap(chunkLoadQueue.begin(), chunkLoadQueue.end());
+		ChunkCoord coord = chunkLoadQueue.back().coord;
+		chunkLoadQueue.pop_back();
 
-		if (isWithinRenderDistance(coord.x, coord.z) && !isChunkLoaded(coord.x, coord.z)) 
+		if (isWithinLoadDistance(coord.x, coord.z) && !isChunkLoaded(coord.x, coord.z)) 
 		{
 			loadChunk(coord.x, coord.z);
 			++chunksLoaded;
 
 			lastChunkLoadTime = std::chrono::steady_clock::now();
+		}
+	}
 
-			for (const auto& pair : chunks)
+	// A new render distance or streaming shape can leave any loaded chunk outside, the only time every chunk is checked
+	if (isUnloadScanNeeded)
+	{
+		isUnloadScanNeeded = false;
+		for (const Chunk* chunk : chunks)
+		{
+			ChunkCoord coord = { static_cast<int16_t>(chunk->getChunkX()), static_cast<int16_t>(chunk->getChunkZ()) };
+			if (!isWithinUnloadDistance(coord.x, coord.z))
 			{
-				const ChunkCoord& loadedCoord = pair.first;
-				if (!isWithinRenderDistance(loadedCoord.x, loadedCoord.z))
-				{
-					tempUnloadList.push_back(loadedCoord);
-				}
+				unloadQueue.push_back(coord);
 			}
 		}
 	}
 
 	for (auto it = pendingChunks.begin(); it != pendingChunks.end(); ) 
 	{
-		if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) 
+		if (it->second.chunk.wait_for(std::chrono::seconds(0)) == std::future_status::ready) 
 		{
-			Chunk* chunk = it->second.get();
-			addChunk(chunk);
+			if (Chunk* chunk = it->second.chunk.get())
+			{
+				addChunk(chunk);
+			}
+			else
+			{
+				// Cancelled, the terrain columns it may have generated go as well. The player can have come
+				// back since, then the chunk is queued again
+				++cancelledChunkLoads;
+				terrainColumnCache.evictRegion(it->first.x, it->first.z);
+				isLoadQueueRebuildNeeded |= isWithinLoadDistance(it->first.x, it->first.z);
+			}
 			it = pendingChunks.erase(it);
 		}
 		else {
@@ -178,65 +291,136 @@ void World::processChunkLoadQueue(uint8_t maxChunksToLoad, uint16_t delay)
 		}
 	}
 
-	for (const auto& coord : tempUnloadList) {
-		unloadChunk(coord.x, coord.z);
+	unloadQueuedChunks();
+	saveUnloadedEdits();
+	deleteRetiredChunks();
+}
+
+void World::queueUnloadsAfterMove(int16_t oldChunkX, int16_t oldChunkZ)
+{
+	// Only the columns of the old area are visited and in each only the runs outside the new area, so a
+	// move costs the chunks that left range plus one step per column
+	GLint margin = pipelineMargin + unloadHysteresis;
+	GLint reach = renderDistance + margin;
+	for (GLint x = oldChunkX - reach; x <= oldChunkX + reach; ++x)
+	{
+		GLint oldHalfWidth = getStreamingHalfWidth(std::abs(x - oldChunkX), renderDistance, margin);
+		GLint newHalfWidth = getStreamingHalfWidth(std::abs(x - playerChunkX), renderDistance, margin);
+		for (GLint z = oldChunkZ - oldHalfWidth; z <= oldChunkZ + oldHalfWidth; ++z)
+		{
+			if (std::abs(z - playerChunkZ) <= newHalfWidth)
+			{
+				z = playerChunkZ + newHalfWidth;
+				continue;
+			}
+
+			if (chunks.get(static_cast<int16_t>(x), static_cast<int16_t>(z)))
+			{
+				unloadQueue.push_back({ static_cast<int16_t>(x), static_cast<int16_t>(z) });
+			}
+		}
 	}
 }
 
-void World::addChunk(Chunk* chunk) {
-	ChunkCoord coord = { static_cast<int16_t>(chunk->getChunkX()), static_cast<int16_t>(chunk->getChunkZ()) };
+void World::unloadQueuedChunks()
+{
+	auto start = std::chrono::steady_clock::now();
+	while (!unloadQueue.empty() && std::chrono::steady_clock::now() - start < unloadTimeBudget)
 	{
-		std::lock_guard<std::mutex> lock(chunksMutex);
-		chunks[coord] = chunk;
+		ChunkCoord coord = unloadQueue.back();
+		unloadQueue.pop_back();
+
+		// The player may have come back since the chunk was queued
+		if (!isWithinUnloadDistance(coord.x, coord.z))
+		{
+			unloadChunk(coord.x, coord.z);
+		}
 	}
-	threadPool.enqueue([=] { notifyNeighbors(chunk); });
 }
 
-void World::notifyNeighbors(Chunk* chunk) {
-	int16_t chunkX = chunk->getChunkX();
-	int16_t chunkZ = chunk->getChunkZ();
-	int16_t offsets[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+void World::addChunk(Chunk* chunk) {
+	ChunkCoord coord = { static_cast<int16_t>(chunk->getChunkX()), static_cast<int16_t>(chunk->getChunkZ()) };
+	// The player can have moved on while the chunk was being generated, it goes straight to the cache
+	if (!isWithinUnloadDistance(coord.x, coord.z)) {
+		retireChunk(chunk);
+		return;
+	}
+
+	// Two chunks inside the unload distance never share a slot, whatever holds it is out of range and
+	// only waiting in the unload queue
+	if (Chunk* occupant = chunks.getOccupant(coord.x, coord.z)) {
+		unloadChunk(static_cast<int16_t>(occupant->getChunkX()), static_cast<int16_t>(occupant->getChunkZ()));
+	}
+	chunks.insert(chunk);
+	queueDecorations(coord);
+}
 
-	for (uint8_t i = 0; i < 4; ++i) {
-		int16_t neighborX = chunkX + offsets[i][0];
-		int16_t neighborZ = chunkZ + offsets[i][1];
-		threadPool.enqueue([=]() {
-			if (Chunk* neighbor = getChunk(neighborX, neighborZ)) {
-				neighbor->needsMeshUpdate = true;
+void World::queueDecorations(const ChunkCoord& coord) {
+	for (int16_t cx = coord.x - 1; cx <= coord.x + 1; ++cx) {
+		for (int16_t cz = coord.z - 1; cz <= coord.z + 1; ++cz) {
+			Chunk* chunk = chunks.get(cx, cz);
+			if (!chunk || chunk->getState() != ChunkState::Generated) continue;
+
+			std::array<const Chunk*, 9> neighbourhood;
+			bool hasTerrain = true;
+			for (int16_t dx = -1; dx <= 1 && hasTerrain; ++dx) {
+				for (int16_t dz = -1; dz <= 1 && hasTerrain; ++dz) {
+					const Chunk* neighbour = chunks.get(static_cast<int16_t>(cx + dx), static_cast<int16_t>(cz + dz));
+					hasTerrain = neighbour != nullptr;
+					neighbourhood[(dx + 1) * 3 + (dz + 1)] = neighbour;
+				}
 			}
-		});
+			if (!hasTerrain) continue;
+
+			chunk->advanceState(ChunkState::Generated, ChunkState::Decorating);
+			threadPool.submit([chunk, neighbourhood, pin = chunkReclaimer.pin()]() {
+				chunk->decorate(neighbourhood);
+			});
+		}
 	}
 }
 
-void World::queueBlockChanges(int16_t chunkX, int16_t chunkZ, const std::vector<BlockChange>& changes) {
-	std::lock_guard<std::mutex> lock(queuedBlockChangesMutex);
-	ChunkCoord coord = { chunkX, chunkZ };
-	auto& existingChanges = queuedBlockChanges[coord];
-	existingChanges.insert(existingChanges.end(), changes.begin(), changes.end());
+void World::queueLightSpread(Chunk* chunk) {
+	std::array<Chunk*, 9> neighbourhood = getNeighbourhood(chunk->getChunkX(), chunk->getChunkZ());
+	chunk->advanceState(ChunkState::Decorated, ChunkState::Lighting);
+	threadPool.submit([chunk, neighbourhood, pin = chunkReclaimer.pin()]() {
+		// The light of a chunk that started unloading is never used
+		if (chunk->isUnloading()) return;
+		{
+			auto locks = LightEngine::lockNeighbourhood(neighbourhood);
+			LightEngine engine(neighbourhood);
+			engine.spreadAcrossBorders();
+			engine.commit();
+		}
+		chunk->advanceState(ChunkState::Lighting, ChunkState::Lit);
+	});
+}
+
+bool World::isNeighbourhoodAtLeast(const Chunk* chunk, ChunkState stage) const {
+	for (int16_t dx = -1; dx <= 1; ++dx) {
+		for (int16_t dz = -1; dz <= 1; ++dz) {
+			const Chunk* neighbour = chunks.get(static_cast<int16_t>(chunk->getChunkX() + dx), static_cast<int16_t>(chunk->getChunkZ() + dz));
+			if (!neighbour || !neighbour->hasReached(stage)) {
+				return false;
+			}
+		}
+	}
+	return true;
 }
 
-std::vector<BlockChange> World::getQueuedBlockChanges(int16_t chunkX, int16_t chunkZ) {
-	std::lock_guard<std::mutex> lock(queuedBlockChangesMutex);
-	ChunkCoord coord = { chunkX, chunkZ };
-	std::vector<BlockChange> changes;
-	auto it = queuedBlockChanges.find(coord);
-	if (it != queuedBlockChanges.end()) {
-		changes = it->second;
-		queuedBlockChanges.erase(it);
+std::array<Chunk*, 9> World::getNeighbourhood(int16_t chunkX, int16_t chunkZ) const {
+	std::array<Chunk*, 9> neighbourhood;
+	for (int16_t dx = -1; dx <= 1; ++dx) {
+		for (int16_t dz = -1; dz <= 1; ++dz) {
+			neighbourhood[(dx + 1) * 3 + (dz + 1)] = chunks.get(static_cast<int16_t>(chunkX + dx), static_cast<int16_t>(chunkZ + dz));
+		}
 	}
-	return changes;
+	return neighbourhood;
 }
 
 Chunk* World::getChunk(int16_t x, int16_t z)
 {
-	ChunkCoord coord = { x, z };
-	std::lock_guard<std::mutex> lock(chunksMutex);
-	auto it = chunks.find(coord);
-	if (it != chunks.end())
-	{
-		return it->second;
-	}
-	return nullptr;
+	return chunks.get(x, z);
 }
 
 void World::setBlock(int16_t x, int16_t y, int16_t z, int8_t type) {
@@ -247,84 +431,177 @@ void World::setBlock(int16_t x, int16_t y, int16_t z, int8_t type) {
 	uint8_t localY = y;
 	uint8_t localZ = (z % CHUNK_SIZE + CHUNK_SIZE) % CHUNK_SIZE;
 
-	Chunk* chunk = getChunk(chunkX, chunkZ);
-	if (chunk) {
-		threadPool.enqueue([this, chunk, localX, localY, localZ, type, chunkX, chunkZ]() {
-			chunk->setBlockType(localX, localY, localZ, type);
-			propagateSunlight(chunkX, chunkZ, localX, localY, localZ);
-			chunk->needsMeshUpdate = true;
+	std::array<Chunk*, 9> neighbourhood = getNeighbourhood(chunkX, chunkZ);
+	if (neighbourhood[4]) {
+		threadPool.submit([this, neighbourhood, localX, localY, localZ, type, pin = chunkReclaimer.pin()]() {
+			auto start = std::chrono::steady_clock::now();
+			GLuint changedLight = 0;
+			bool changed;
+			bool isUnloading;
+			{
+				// Light from the block can reach into every neighbour, so all of them are locked for the update
+				auto locks = LightEngine::lockNeighbourhood(neighbourhood);
+				GLint oldType = neighbourhood[4]->getStoredBlock(localX, localY, localZ);
+				changed = neighbourhood[4]->setStoredBlock(localX, localY, localZ, type);
+				if (changed) {
+					LightEngine engine(neighbourhood);
+					engine.updateBlock(localX, localY, localZ, oldType);
+					engine.commit();
+					changedLight = engine.getChangedBlockCount();
+				}
+				// Unloading saves the chunk and marks it under its lock, an edit that finds it unloading
+				// came too late for that save
+				isUnloading = neighbourhood[4]->isUnloading();
+			}
 
-			if (localX == 0 || localX == CHUNK_SIZE - 1 ||
-				localZ == 0 || localZ == CHUNK_SIZE - 1) {
-				updateNeighboringChunksOnBlockChange(chunkX, chunkZ, localX, localY, localZ);
+			if (changed && isUnloading) {
+				std::lock_guard<std::mutex> lock(unloadedEditsMutex);
+				unloadedEdits.push_back({ neighbourhood[4], pin });
 			}
-		});
+			if (changed) {
+				lastLightUpdateTime = std::chrono::duration<GLfloat, std::milli>(std::chrono::steady_clock::now() - start).count();
+				lastLightUpdateBlocks = changedLight;
+				if (localX == 0 || localX == CHUNK_SIZE - 1 ||
+					localZ == 0 || localZ == CHUNK_SIZE - 1) {
+					updateNeighboringChunksOnBlockChange(neighbourhood, localX, localY, localZ);
+				}
+				// The remeshes the edit caused skip the streaming work queued ahead of them
+				for (Chunk* chunk : neighbourhood) {
+					if (chunk) chunk->markDirtySectionsEdited();
+				}
+			}
+		}, TaskPriority::Urgent);
 	}
 }
 
-void World::propagateSunlight(int16_t chunkX, int16_t chunkZ, int16_t localX, int16_t localY, int16_t localZ) {
-	Chunk* chunk = getChunk(chunkX, chunkZ);
-	if (chunk) {
-		chunk->recalculateSunlightColumn(localX, localZ);
-		chunk->needsMeshUpdate = true;
-	}
+void World::queueChunkLoad(int16_t x, int16_t z)
+{
+	chunkLoadQueue.push_back({ { x, z }, getChunkLoadPriority(x, z) });
+	std::push_heap(chunkLoadQueue.begin(), chunkLoadQueue.end());
 }
 
-void World::queueChunkLoad(int16_t x, int16_t z)
+GLint World::getChunkLoadPriority(int16_t x, int16_t z) const
 {
-	ChunkCoord coord = { x, z };
-	chunkLoadQueue.push(coord);
+	GLint dx = x - playerChunkX;
+	GLint dz = z - playerChunkZ;
+	GLint distance = dx * dx + dz * dz;
+
+	// Compares squared cosines so no square root is needed. Looking straight up or down, or before the
+	// first player update, the view direction has no horizontal part and nothing is in the cone
+	glm::vec2 forward(rankedViewDirection.x, rankedViewDirection.z);
+	GLfloat along = dx * forward.x + dz * forward.y;
+	if (along > 0.0f && along * along >= viewConeCosSquared * static_cast<GLfloat>(distance) * glm::dot(forward, forward))
+	{
+		return distance / 4;
+	}
+	return distance;
 }
 
 void World::loadChunk(int16_t x, int16_t z) {
 	ChunkCoord coord = { x, z };
-	if (chunks.find(coord) == chunks.end() && pendingChunks.find(coord) == pendingChunks.end()) {
-		auto future = threadPool.enqueue([this, coord]() -> Chunk* {
-			Chunk* chunk = new Chunk(coord.x, coord.z, textureManager, this);
-			auto changes = getQueuedBlockChanges(coord.x, coord.z);
-			for (const auto& change : changes) {
-				chunk->setBlockType(change.localX, change.localY, change.localZ, change.blockType);
+	if (!chunks.get(x, z) && pendingChunks.find(coord) == pendingChunks.end()) {
+		std::vector<uint8_t> cachedData;
+		bool isCached = chunkCache.take(x, z, cachedData);
+		chunkStateCounts.add(ChunkState::Queued);
+		PendingChunk& pendingChunk = pendingChunks[coord];
+		pendingChunk.chunk = threadPool.enqueue([this, coord, isCached, cachedData = std::move(cachedData), cancellation = pendingChunk.cancellation.get_token()]() -> Chunk* {
+			chunkStateCounts.remove(ChunkState::Queued);
+			// A cached payload is restored even when cancelled, it is all that is left of the chunk and goes
+			// back to the cache once the chunk is found out of range
+			if (isCached) {
+				return new Chunk(coord.x, coord.z, textureManager, this, &cachedData);
 			}
-			return chunk;
+			if (cancellation.stop_requested()) return nullptr;
+			std::vector<uint8_t> savedData;
+			if (chunkStorage.load(coord.x, coord.z, savedData)) {
+				return new Chunk(coord.x, coord.z, textureManager, this, &savedData);
+			}
+			if (cancellation.stop_requested()) return nullptr;
+			// The terrain columns are a stage of their own, the chunk finds them in the cache
+			terrainColumnCache.getRegion(coord.x, coord.z);
+			if (cancellation.stop_requested()) return nullptr;
+			return new Chunk(coord.x, coord.z, textureManager, this);
 		});
-		pendingChunks[coord] = std::move(future);
 	}
 }
 
 void World::unloadChunk(int16_t x, int16_t z) {
-	ChunkCoord coord = { x, z };
-	std::unique_lock<std::mutex> lock(chunksMutex);
-	auto it = chunks.find(coord);
-	if (it != chunks.end()) {
-		Chunk* chunk = it->second;
-		chunks.erase(it);
-		lock.unlock();
+	if (Chunk* chunk = chunks.remove(x, z)) {
+		retireChunk(chunk);
+	}
+}
 
-		delete chunk;
+void World::retireChunk(Chunk* chunk) {
+	int16_t x = static_cast<int16_t>(chunk->getChunkX());
+	int16_t z = static_cast<int16_t>(chunk->getChunkZ());
+	std::vector<uint8_t> data;
+	bool isSaved;
+	{
+		// A worker may still be meshing this chunk or its neighbours, it is deleted once their pins are gone.
+		// Whatever that worker finishes afterwards is dropped. Edits write under the exclusive lock, so each
+		// one either lands in this save or finds the chunk unloading
+		std::shared_lock<std::shared_mutex> lock(chunk->blockDataMutex);
+		isSaved = saveChunk(chunk, data);
+		chunk->beginUnloading();
+	}
+	if (isSaved) {
+		chunkCache.insert(x, z, std::move(data));
+	}
+	terrainColumnCache.evictRegion(x, z);
+	chunkReclaimer.retire(chunk);
+}
+
+bool World::saveChunk(Chunk* chunk, std::vector<uint8_t>& data) {
+	// Decoration writes blocks while it runs, a chunk caught in the middle is generated again instead
+	ChunkState state = chunk->getStateBeforeUnloading();
+	if (state == ChunkState::Decorating) return false;
+	// Only decorated chunks go to disk, terrain alone is cheap enough to generate again. The flag is cleared
+	// before the blocks are read, so an edit landing in between is saved again next time instead of lost
+	bool isStored = state >= ChunkState::Decorated && chunk->hasUnsavedChanges.exchange(false);
+
+	data.clear();
+	chunk->save(data);
+	if (isStored) {
+		chunkStorage.save(static_cast<int16_t>(chunk->getChunkX()), static_cast<int16_t>(chunk->getChunkZ()), data);
+	}
+	return true;
+}
+
+void World::saveUnloadedEdits() {
+	std::vector<std::pair<Chunk*, EpochReclaimer<Chunk>::Guard>> edits;
+	{
+		std::lock_guard<std::mutex> lock(unloadedEditsMutex);
+		edits.swap(unloadedEdits);
+	}
+
+	std::vector<uint8_t> data;
+	for (auto& [chunk, pin] : edits) {
+		int16_t x = static_cast<int16_t>(chunk->getChunkX());
+		int16_t z = static_cast<int16_t>(chunk->getChunkZ());
+		std::shared_lock<std::shared_mutex> lock(chunk->blockDataMutex);
+		// A chunk loaded again meanwhile restored the older payload, only the saved one has the edit then
+		if (saveChunk(chunk, data) && !isChunkLoaded(x, z) && pendingChunks.find({ x, z }) == pendingChunks.end()) {
+			chunkCache.insert(x, z, std::move(data));
+		}
 	}
 }
 
 bool World::isChunkLoaded(int16_t x, int16_t z) {
-	ChunkCoord coord = { x, z };
-	std::lock_guard<std::mutex> lock(chunksMutex);
-	return chunks.find(coord) != chunks.end();
+	return chunks.get(x, z) != nullptr;
 }
 
-void World::updateNeighboringChunksOnBlockChange(int16_t chunkX, int16_t chunkZ, int16_t localX, int16_t localY, int16_t localZ) {
-	std::vector<std::pair<int16_t, int16_t>> neighborsToUpdate;
+void World::updateNeighboringChunksOnBlockChange(const std::array<Chunk*, 9>& neighbourhood, int16_t localX, int16_t localY, int16_t localZ) {
+	std::vector<Chunk*> neighborsToUpdate;
 
-	if (localX == 0) neighborsToUpdate.emplace_back(chunkX - 1, chunkZ);
-	if (localX == CHUNK_SIZE - 1) neighborsToUpdate.emplace_back(chunkX + 1, chunkZ);
-	if (localZ == 0) neighborsToUpdate.emplace_back(chunkX, chunkZ - 1);
-	if (localZ == CHUNK_SIZE - 1) neighborsToUpdate.emplace_back(chunkX, chunkZ + 1);
+	if (localX == 0) neighborsToUpdate.push_back(neighbourhood[1]);
+	if (localX == CHUNK_SIZE - 1) neighborsToUpdate.push_back(neighbourhood[7]);
+	if (localZ == 0) neighborsToUpdate.push_back(neighbourhood[3]);
+	if (localZ == CHUNK_SIZE - 1) neighborsToUpdate.push_back(neighbourhood[5]);
 
-	for (const auto& [nx, nz] : neighborsToUpdate) {
-		threadPool.enqueue([this, nx, nz]() {
-			Chunk* neighborChunk = getChunk(nx, nz);
-			if (neighborChunk) {
-				neighborChunk->needsMeshUpdate = true;
-			}
-		});
+	for (Chunk* neighborChunk : neighborsToUpdate) {
+		if (neighborChunk) {
+			neighborChunk->markSectionsDirty(Chunk::getSectionsAround(localY));
+		}
 	}
 }
 
@@ -332,46 +609,73 @@ bool World::isChunkInFrustum(int16_t chunkX, int16_t chunkZ, const Frustum& frus
 {
 	if (!isFrustumCullingEnabled) return true;
 
-	// Calculate the chunk's AABB
-	glm::vec3 minBounds(chunkX * CHUNK_SIZE, 0, chunkZ * CHUNK_SIZE);
-	glm::vec3 maxBounds(chunkX * CHUNK_SIZE + CHUNK_SIZE, CHUNK_HEIGHT, chunkZ * CHUNK_SIZE + CHUNK_SIZE);
+	// Calculate the chunk's AABB, grown by the pipeline margin so the neighbours a visible chunk
+	// needs for decoration and meshing rank with it in the load queue
+	GLfloat margin = static_cast<GLfloat>(pipelineMargin * CHUNK_SIZE);
+	glm::vec3 minBounds(chunkX * CHUNK_SIZE - margin, 0, chunkZ * CHUNK_SIZE - margin);
+	glm::vec3 maxBounds(chunkX * CHUNK_SIZE + CHUNK_SIZE + margin, CHUNK_HEIGHT, chunkZ * CHUNK_SIZE + CHUNK_SIZE + margin);
 	return frustum.isBoxInFrustum(minBounds, maxBounds);
 }
 
-bool World::isWithinRenderDistance(int16_t x, int16_t z) const
+GLint World::getStreamingHalfWidth(GLint dx, GLint distance, GLint margin) const
 {
-	return std::abs(x - playerChunkX) <= renderDistance && std::abs(z - playerChunkZ) <= renderDistance;
+	if (dx > distance + margin) return -1;
+	if (!isCircularStreamingEnabled) return distance + margin;
+
+	// The circle grown by a square margin, every chunk with a chunk of the circle at most margin away on both axes
+	GLint outsideX = std::max(dx - margin, 0);
+	GLint remaining = distance * distance - outsideX * outsideX;
+	GLint outsideZ = static_cast<GLint>(std::sqrt(static_cast<GLdouble>(remaining)));
+	while (outsideZ * outsideZ > remaining) --outsideZ;
+	while ((outsideZ + 1) * (outsideZ + 1) <= remaining) ++outsideZ;
+	return margin + outsideZ;
 }
 
-bool World::ChunkCoordComparator::operator()(const ChunkCoord& a, const ChunkCoord& b) const {
-    GLfloat distA = std::abs(a.x - world.playerChunkX) + std::abs(a.z - world.playerChunkZ);
-    GLfloat distB = std::abs(b.x - world.playerChunkX) + std::abs(b.z - world.playerChunkZ);
-    return distA > distB;
+bool World::isWithinStreamingDistance(int16_t x, int16_t z, GLint distance, GLint margin) const
+{
+	return std::abs(z - playerChunkZ) <= getStreamingHalfWidth(std::abs(x - playerChunkX), distance, margin);
 }
 
-GLfloat World::getTerrainHeightAt(GLfloat x, GLfloat z)
+bool World::isWithinLoadDistance(int16_t x, int16_t z) const
+{
+	return isWithinStreamingDistance(x, z, renderDistance, pipelineMargin);
+}
+
+bool World::isWithinUnloadDistance(int16_t x, int16_t z) const
 {
-	int16_t chunkX = static_cast<int16_t>(floor(x)) / CHUNK_SIZE;
-	int16_t chunkZ = static_cast<int16_t>(floor(z)) / CHUNK_SIZE;
+	return isWithinStreamingDistance(x, z, renderDistance, pipelineMargin + unloadHysteresis);
+}
 
-	Chunk* chunk = getChunk(chunkX, chunkZ);
-	if (!chunk) return CHUNK_HEIGHT;
+void World::setRenderDistance(uint8_t distance)
+{
+	distance = std::min(distance, maxRenderDistance);
+	if (distance == renderDistance) return;
+	renderDistance = distance;
+	isStreamingAreaChanged = true;
+	isUnloadScanNeeded = true;
+}
 
-	int16_t localX = static_cast<int16_t>(floor(x)) % CHUNK_SIZE;
-	int16_t localZ = static_cast<int16_t>(floor(z)) % CHUNK_SIZE;
+void World::setUnloadHysteresis(uint8_t hysteresis)
+{
+	unloadHysteresis = std::min(hysteresis, maxUnloadHysteresis);
+	isUnloadScanNeeded = true;
+}
 
-	if (localX < 0) localX += CHUNK_SIZE;
-	if (localZ < 0) localZ += CHUNK_SIZE;
+void World::setCircularStreamingState(bool enabled)
+{
+	isCircularStreamingEnabled = enabled;
+	isStreamingAreaChanged = true;
+	isUnloadScanNeeded = true;
+}
 
-	return static_cast<GLfloat>(chunk->getTerrainHeightAt(localX, localZ));
+GLfloat World::getTerrainHeightAt(GLfloat x, GLfloat z)
+{
+	return static_cast<GLfloat>(terrainColumnCache.getColumn(static_cast<GLint>(floor(x)), static_cast<GLint>(floor(z))).height);
 }
 
 void World::updateAllChunkMeshes() {
-	for (auto& pair : chunks) {
-		Chunk* chunk = pair.second;
-		if (chunk) {
-			chunk->needsMeshUpdate = true;
-		}
+	for (Chunk* chunk : chunks) {
+		chunk->markSectionsDirty(ALL_SECTIONS);
 	}
 }
 
@@ -394,3 +698,9 @@ void World::setGreedyMeshingEnabled(bool enabled)
 	isGreedyMeshingEnabled = enabled;
 	updateAllChunkMeshes();
 }
+
+void World::setBinaryGreedyMeshingEnabled(bool enabled)
+{
+	isBinaryGreedyMeshingEnabled = enabled;
+	updateAllChunkMeshes();
+}
@@ -1,34 +1,49 @@
 #pragma once
 
 #include <unordered_map>
-#include <queue>
-#include <map>
 #include <unordered_set>
+#include <stop_token>
+#include <ctime>
 #include "Chunk.h"
 #include "ThreadPool.h"
-
-struct BlockChange {
-	int16_t localX, localY, localZ;
-	uint8_t blockType;
-};
+#include "TerrainColumnCache.h"
+#include "ChunkStorage.h"
+#include "ChunkCache.h"
+#include "ChunkGrid.h"
+#include "EpochReclaimer.h"
 
 class World
 {
 public:
-	World(const Frustum& frustum);
+	// The seed drives every random generation decision, the same seed always builds the same chunks
+	World(const Frustum& frustum, GLuint seed = static_cast<GLuint>(std::time(nullptr)));
+	// The seed of the world kept in saves/world.dat. A new one is picked and written the first time, so every
+	// launch continues the same world and reads back the chunks saved under saves/<seed>
+	static GLuint loadOrCreateSeed();
 	~World();
 	bool isInitialChunksLoaded();
-	void Draw(const Frustum& frustum);
+	void Draw(const Frustum& frustum, shader& chunkShader);
 	void DrawWater(const Frustum& frustum, shader& waterShader, glm::mat4 view, glm::mat4 projection, glm::vec3 lightDirection, Camera& camera);
 	void updatePlayerPosition(const glm::vec3& position, const Frustum& frustum);
 	void processChunkLoadQueue(uint8_t maxChunksToLoad, uint16_t delay);
+	// Lock free. Other threads than the main thread hold a pinChunks guard for as long as they use the result
 	Chunk* getChunk(int16_t x, int16_t z);
+	// Chunks unloaded after this are only deleted once the guard is gone
+	EpochReclaimer<Chunk>::Guard pinChunks() { return chunkReclaimer.pin(); }
 	GLfloat getTerrainHeightAt(GLfloat x, GLfloat z);
+	GLuint getSeed() const { return seed; }
+	const TerrainGenerator& getTerrainGenerator() const { return terrainGenerator; }
+	TerrainColumnCache& getTerrainColumnCache() { return terrainColumnCache; }
+	// How many chunks sit in each pipeline stage, including load jobs that haven't started
+	ChunkStateCounts& getChunkStateCounts() { return chunkStateCounts; }
+	size_t getQueuedChunkSaveCount() const { return chunkStorage.getQueuedWriteCount(); }
+	size_t getRetiredChunkCount() const { return chunkReclaimer.getRetiredCount(); }
+	// Load jobs the player moved away from before they finished
+	GLuint getCancelledChunkLoadCount() const { return cancelledChunkLoads; }
+	ChunkCache& getChunkCache() { return chunkCache; }
 
 	void setBlock(int16_t x, int16_t y, int16_t z, int8_t type);
 
-	void queueBlockChanges(int16_t chunkX, int16_t chunkZ, const std::vector<BlockChange>& changes);
-
 	void updateAllChunkMeshes();
 
 	struct ChunkCoord {
@@ -47,17 +62,21 @@ public:
 	};
 
 	struct ChunkCoordHash {
+		// Both coordinates side by side, xor-ing their hashes made (a, b) and (b, a) collide
 		std::size_t operator()(const ChunkCoord& coord) const {
-			return std::hash<int16_t>()(coord.x) ^ std::hash<int16_t>()(coord.z);
+			return std::hash<int32_t>()((static_cast<int32_t>(coord.x) << 16) | static_cast<uint16_t>(coord.z));
 		}
 	};
 
-	const std::unordered_map<ChunkCoord, Chunk*, ChunkCoordHash>& getChunks() const { return chunks; }
+	const ChunkGrid& getChunks() const { return chunks; }
 
 	bool isAOEnabled = true;
 	bool isFrustumCullingEnabled = true;
 	bool isStructureGenerationEnabled = true;
 	bool isGreedyMeshingEnabled = true;
+	bool isBinaryGreedyMeshingEnabled = true;
+	// Streams a circle around the player instead of a square, about a quarter fewer chunks for the same reach
+	bool isCircularStreamingEnabled = true;
 
 	bool getAOState() const { return isAOEnabled; }
 	void setAOState(bool enabled);
@@ -71,40 +90,150 @@ public:
 	bool getIsGreedyMeshingEnabled() const { return isGreedyMeshingEnabled; }
 	void setGreedyMeshingEnabled(bool enabled);
 
+	bool getIsBinaryGreedyMeshingEnabled() const { return isBinaryGreedyMeshingEnabled; }
+	void setBinaryGreedyMeshingEnabled(bool enabled);
+
+	bool getCircularStreamingState() const { return isCircularStreamingEnabled; }
+	void setCircularStreamingState(bool enabled);
+
+	// Changes take effect over the next frames: chunks that came into range are queued and the ones that
+	// left it are unloaded a batch per frame
+	static constexpr uint8_t maxRenderDistance = 32;
+	static constexpr uint8_t maxUnloadHysteresis = 4;
+	uint8_t getRenderDistance() const { return renderDistance; }
+	void setRenderDistance(uint8_t distance);
+	uint8_t getUnloadHysteresis() const { return unloadHysteresis; }
+	void setUnloadHysteresis(uint8_t hysteresis);
+
+	void resetFrameStats() { bytesUploadedThisFrame = 0; }
+	size_t getBytesUploadedThisFrame() const { return bytesUploadedThisFrame; }
+	// Time the light engine took for the last block edit and how many block lights it changed
+	GLfloat getLastLightUpdateTime() const { return lastLightUpdateTime; }
+	GLuint getLastLightUpdateBlocks() const { return lastLightUpdateBlocks; }
+
 private:
-	struct ChunkCoordComparator {
-		ChunkCoordComparator(const World& world) : world(world) {}
-		bool operator()(const ChunkCoord& a, const ChunkCoord& b) const;
-		const World& world;
+	struct ChunkLoadRequest {
+		ChunkCoord coord;
+		// Lower loads sooner, see getChunkLoadPriority
+		GLint priority;
+
+		// The heap keeps its largest element on top, the lowest priority value has to compare largest
+		bool operator<(const ChunkLoadRequest& other) const { return priority > other.priority; }
+	};
+
+	// A load job handed to the pool, the job stops at its next stage and returns null once cancellation is requested
+	struct PendingChunk {
+		std::future<Chunk*> chunk;
+		std::stop_source cancellation;
 	};
 
 	void queueChunkLoad(int16_t x, int16_t z);
+	// Squared distance to the player in chunks, a quarter of it for chunks in the view cone so what the
+	// player looks at fills in first
+	GLint getChunkLoadPriority(int16_t x, int16_t z) const;
+	// Queues the chunks in load distance and view that aren't loaded or loading, ranked from the current
+	// position and view direction
+	void rebuildChunkLoadQueue(const Frustum& frustum);
 	void loadChunk(int16_t x, int16_t z);
 	void unloadChunk(int16_t x, int16_t z);
+	// Keeps the payload of a chunk no longer in the grid in the cache and deletes it once no pin can reach it
+	void retireChunk(Chunk* chunk);
+	// Writes the chunk's payload into data and hands it to storage when it is decorated and changed since
+	// it was last saved. False when the chunk is still being decorated and can't be saved. The caller holds
+	// the chunk's blockDataMutex
+	bool saveChunk(Chunk* chunk, std::vector<uint8_t>& data);
+	// Saves the unloading chunks that an edit changed after retireChunk saved them
+	void saveUnloadedEdits();
 	bool isChunkLoaded(int16_t x, int16_t z);
-	bool isWithinRenderDistance(int16_t x, int16_t z) const;
-	void updateNeighboringChunksOnBlockChange(int16_t chunkX, int16_t chunkZ, int16_t localX, int16_t localY, int16_t localZ);
+	// Half the z extent of the streaming shape grown by margin chunks in the column dx chunks from the player,
+	// -1 when the column lies outside. Both shapes are convex, so every column is a single run
+	GLint getStreamingHalfWidth(GLint dx, GLint distance, GLint margin) const;
+	// True when the chunk is within distance chunks of the player in the streaming shape grown by margin chunks
+	bool isWithinStreamingDistance(int16_t x, int16_t z, GLint distance, GLint margin) const;
+	bool isWithinLoadDistance(int16_t x, int16_t z) const;
+	bool isWithinUnloadDistance(int16_t x, int16_t z) const;
+	void updateNeighboringChunksOnBlockChange(const std::array<Chunk*, 9>& neighbourhood, int16_t localX, int16_t localY, int16_t localZ);
 	bool isChunkInFrustum(int16_t chunkX, int16_t chunkZ, const Frustum& frustum) const;
 
-	void propagateSunlight(int16_t chunkX, int16_t chunkZ, int16_t localX, int16_t localY, int16_t localZ);
-
-	void addChunk(Chunk* chunk);
-	void notifyNeighbors(Chunk* chunk);
+	// Queues the loaded chunks that were inside the unload distance around the old player chunk but are
+	// outside it around the current one
+	void queueUnloadsAfterMove(int16_t oldChunkX, int16_t oldChunkZ);
+	// Unloads queued chunks that are still out of range until unloadTimeBudget runs out
+	void unloadQueuedChunks();
 
-	std::vector<BlockChange> getQueuedBlockChanges(int16_t chunkX, int16_t chunkZ);
+	void updateChunkMeshes(const std::vector<Chunk*>& idleChunks);
+	void deleteRetiredChunks();
 
-	std::unordered_map<ChunkCoord, Chunk*, ChunkCoordHash> chunks;
-	std::priority_queue<ChunkCoord, std::vector<ChunkCoord>, ChunkCoordComparator> chunkLoadQueue;
+	void addChunk(Chunk* chunk);
+	// Starts the decoration stage of the chunks around coord whose 3x3 neighbourhood now has terrain
+	void queueDecorations(const ChunkCoord& coord);
+	// Starts spreading light across the borders of a chunk whose 3x3 neighbourhood is decorated
+	void queueLightSpread(Chunk* chunk);
+	bool isNeighbourhoodAtLeast(const Chunk* chunk, ChunkState stage) const;
+	// The chunk at (chunkX, chunkZ) and its 8 neighbours indexed [(dx + 1) * 3 + (dz + 1)], null where
+	// not loaded. Main thread only
+	std::array<Chunk*, 9> getNeighbourhood(int16_t chunkX, int16_t chunkZ) const;
+
+	// Declared before anything that owns chunks, every chunk reports to it until it is deleted
+	ChunkStateCounts chunkStateCounts;
+	// Written by the main thread only, looked up from any thread
+	ChunkGrid chunks;
+	// A heap of load requests, rebuilt whenever the player changes chunk or turns so the priorities follow them
+	std::vector<ChunkLoadRequest> chunkLoadQueue;
+	// Where the player looked when the load queue was last ranked
+	glm::vec3 rankedViewDirection{ 0.0f };
+	// Set when a cancelled load came back while its chunk was in load distance again
+	bool isLoadQueueRebuildNeeded = false;
 	int16_t playerChunkX, playerChunkZ;
+	const GLuint seed;
+	static constexpr uint32_t WORLD_FILE_MAGIC = 0x44575856; // "VXWD"
+	static constexpr uint32_t WORLD_FILE_VERSION = 1;
 	TextureManager textureManager;
-
-	std::unordered_map<ChunkCoord, std::future<Chunk*>, ChunkCoordHash> pendingChunks;
-	std::mutex chunksMutex;
+	// Immutable once constructed, read by every chunk generation job
+	const TerrainGenerator terrainGenerator;
+	// Column data of the loaded chunks, a region is dropped when its chunk unloads
+	TerrainColumnCache terrainColumnCache{ terrainGenerator };
+
+	std::unordered_map<ChunkCoord, PendingChunk, ChunkCoordHash> pendingChunks;
+	GLuint cancelledChunkLoads = 0;
+	// Saved chunks of this seed, declared before the pool so no job outlives it
+	ChunkStorage chunkStorage;
+	// Filled by edit jobs, the pins keep the chunks alive until the main thread saved them
+	std::mutex unloadedEditsMutex;
+	std::vector<std::pair<Chunk*, EpochReclaimer<Chunk>::Guard>> unloadedEdits;
+	ChunkCache chunkCache{ 16 * 1024 * 1024 };
+	// Unloaded chunks wait here until no job that was handed them or looked them up is left. Every chunk
+	// job pins it when it is queued, declared before the pool so no job outlives it
+	EpochReclaimer<Chunk> chunkReclaimer;
 	ThreadPool threadPool;
 
-	std::map<ChunkCoord, std::vector<BlockChange>> queuedBlockChanges;
-	std::mutex queuedBlockChangesMutex;
-
-	const uint8_t renderDistance = 12;
+	uint8_t renderDistance = 12;
+	// Chunks are loaded out to the render distance plus pipelineMargin but only unloaded this many chunks
+	// further out, so walking back and forth over a chunk border doesn't unload and reload the edge
+	uint8_t unloadHysteresis = 2;
+	// Set when the render distance or the streaming shape changed, the next player update queues the new area
+	bool isStreamingAreaChanged = false;
+	// Set when the streaming area changed shape, every loaded chunk is checked against it once
+	bool isUnloadScanNeeded = false;
+	// Every loaded chunk outside the unload distance is in here, possibly more than once. Entries are checked
+	// again when they come up, the player may have returned since
+	std::vector<ChunkCoord> unloadQueue;
+	const std::chrono::microseconds unloadTimeBudget{ 1000 };
+	// The load queue is rebuilt once the view turned further than about 25 degrees
+	static constexpr GLfloat viewTurnThreshold = 0.9f;
+	// Squared cosine of the view cone's half angle, 30 degrees around the view direction
+	static constexpr GLfloat viewConeCosSquared = 0.75f;
+	// Terrain is generated this many chunks past the render distance: decoration needs a ring of
+	// neighbours with terrain, spreading light a ring of decorated neighbours and meshing a ring of
+	// lit neighbours
+	static constexpr uint8_t pipelineMargin = 3;
+	// Every chunk inside the unload distance needs a grid slot of its own
+	static_assert(2 * (maxRenderDistance + pipelineMargin + maxUnloadHysteresis) + 1 <= ChunkGrid::SIZE, "The chunk grid is narrower than the largest unload area");
+	const size_t meshUploadBudget = 2 * 1024 * 1024;
+
+	// GPU buffer traffic caused by mesh uploads, reset by main at the start of every frame
+	size_t bytesUploadedThisFrame = 0;
+	std::atomic<GLfloat> lastLightUpdateTime = 0.0f;
+	std::atomic<GLuint> lastLightUpdateBlocks = 0;
 
 };
\ No newline at end of file
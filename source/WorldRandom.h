@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+
+// Random numbers for world generation decisions. A stream is keyed by the world seed and a block
+// column and every draw hashes that key with an incrementing counter, so a value only depends on
+// where it is used, never on which thread generates the chunk or in which order chunks load
+class WorldRandom
+{
+public:
+	WorldRandom(GLuint worldSeed, GLint x, GLint z)
+		: key(mix(static_cast<uint64_t>(worldSeed) * 0x9E3779B97F4A7C15ull ^ (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(z)))) {}
+
+	// Uniform over all 32 bit values
+	uint32_t next() { return static_cast<uint32_t>(mix(key + ++counter * 0x9E3779B97F4A7C15ull) >> 32); }
+	// Uniform in [0, bound)
+	GLint nextInt(GLint bound) { return static_cast<GLint>((static_cast<uint64_t>(next()) * static_cast<uint32_t>(bound)) >> 32); }
+	// Uniform in [0, 1)
+	GLfloat nextFloat() { return static_cast<GLfloat>(next() >> 8) * (1.0f / 16777216.0f); }
+
+	// How many values have been drawn, a stream rebuilt from the same key and seeked there continues
+	// exactly where this one is
+	uint64_t getPosition() const { return counter; }
+	void seek(uint64_t position) { counter = position; }
+
+private:
+	// splitmix64 finaliser
+	static uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t key;
+	uint64_t counter = 0;
+};
@@ -74,7 +74,7 @@ int main()
 
 	Frustum frustum;
 	TextureManager textureManager;
-	World world(frustum);
+	World world(frustum, World::loadOrCreateSeed());
 	Player player(camera, world, &textureManager);
 	glfwSetWindowUserPointer(window, &player);
 	glfwSetScrollCallback(window, main::scroll_callback);
@@ -118,7 +118,9 @@ void main::processRendering(GLFWwindow* window, shader& mainShader, shader& wate
 {
 	// Prepare matrices
 	glm::mat4 view = camera.getViewMatrix();
-	glm::mat4 projection = glm::perspective(glm::radians(75.0f), (GLfloat)(SCR_WIDTH / (GLfloat)SCR_HEIGHT), 0.1f, 320.0f);
+	// The far plane follows the render distance, 320 at the default of 12 chunks
+	GLfloat farPlane = static_cast<GLfloat>((world.getRenderDistance() + 8) * CHUNK_SIZE);
+	glm::mat4 projection = glm::perspective(glm::radians(75.0f), (GLfloat)(SCR_WIDTH / (GLfloat)SCR_HEIGHT), 0.1f, farPlane);
 	glm::mat4 model = glm::mat4(1.0f);
 
 	skybox.updateSunAndMoonPosition(deltaTime);
@@ -164,7 +166,8 @@ void main::processRendering(GLFWwindow* window, shader& mainShader, shader& wate
 	// Underwater Effect
 	mainShader.setBool("isUnderwater", player.isInUnderwater());
 
-	world.Draw(frustum);
+	world.resetFrameStats();
+	world.Draw(frustum, mainShader);
 	
 	// Draw water
 	world.DrawWater(frustum, waterShader, view, projection, lightDirection, camera);
@@ -281,7 +284,7 @@ void main::initializeMeshOutline(shader& meshingShader, glm::mat4 model, glm::ma
 	glEnable(GL_POLYGON_OFFSET_LINE); // Enable polygon offset for lines
 	glPolygonOffset(-0.5, -0.5);
 
-	world.Draw(frustum);
+	world.Draw(frustum, meshingShader);
 
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // Reset to fill mode
 	glDisable(GL_POLYGON_OFFSET_LINE); // Disable polygon offset for lines
@@ -403,6 +406,24 @@ void main::renderImGui(GLFWwindow* window, const glm::vec3& playerPosition, Play
 
 	ImGui::Text("Player Position: (%.2f, %.2f, %.2f)", playerPosition.x, playerPosition.y, playerPosition.z); // Player Position in the world
 
+	ImGui::Text("Mesh Upload: %.1f KB/frame", world.getBytesUploadedThisFrame() / 1024.0f); // GPU buffer traffic this frame
+
+	ImGui::Text("Last Light Update: %.3f ms, %u blocks", world.getLastLightUpdateTime(), world.getLastLightUpdateBlocks()); // Light engine cost of the last block edit
+
+	ImGui::Text("Chunk Saves Queued: %zu", world.getQueuedChunkSaveCount()); // Chunks waiting for the storage I/O thread
+	ImGui::Text("Unloaded Chunks Pinned: %zu", world.getRetiredChunkCount()); // Unloaded chunks jobs may still reach
+	ImGui::Text("Chunk Loads Cancelled: %u", world.getCancelledChunkLoadCount()); // Loads the player moved away from
+
+	ImGui::Text("World Seed: %u", world.getSeed());
+
+	// Chunks per pipeline stage, a stage that keeps filling up is the bottleneck
+	ImGui::Separator();
+	ImGui::Text("Chunk Pipeline");
+	const ChunkStateCounts& chunkStateCounts = world.getChunkStateCounts();
+	for (size_t state = 0; state < static_cast<size_t>(ChunkState::Count); ++state) {
+		ImGui::Text("  %s: %u", getChunkStateName(static_cast<ChunkState>(state)), chunkStateCounts.get(static_cast<ChunkState>(state)));
+	}
+
 	ImGui::Separator();
 	ImGui::Text("Select Block Type:");
 	static const char* blockTypeNames[] = {
@@ -449,6 +470,12 @@ void main::renderImGui(GLFWwindow* window, const glm::vec3& playerPosition, Play
 		world.setGreedyMeshingEnabled(isGreedyMeshingEnabled);
 	}
 
+	bool isBinaryGreedyMeshingEnabled = world.getIsBinaryGreedyMeshingEnabled();
+	if (ImGui::Checkbox("Use Binary Greedy mesher", &isBinaryGreedyMeshingEnabled))
+	{
+		world.setBinaryGreedyMeshingEnabled(isBinaryGreedyMeshingEnabled);
+	}
+
 	// Inventory Hotbar visiblity Toggle
 	ImGui::Separator();
 	ImGui::Checkbox("Show Inventory Hotbar", &isHotbarVisible);
@@ -467,6 +494,21 @@ void main::renderImGui(GLFWwindow* window, const glm::vec3& playerPosition, Play
 		world.setFrustumCullingState(frustumCullingState);
 	}
 
+	// Streaming area
+	ImGui::Separator();
+	GLint renderDistance = world.getRenderDistance();
+	if (ImGui::SliderInt("Render Distance", &renderDistance, 2, World::maxRenderDistance)) {
+		world.setRenderDistance(static_cast<uint8_t>(renderDistance));
+	}
+	GLint unloadHysteresis = world.getUnloadHysteresis();
+	if (ImGui::SliderInt("Unload Hysteresis", &unloadHysteresis, 0, World::maxUnloadHysteresis)) {
+		world.setUnloadHysteresis(static_cast<uint8_t>(unloadHysteresis));
+	}
+	bool circularStreamingState = world.getCircularStreamingState();
+	if (ImGui::Checkbox("Circular Streaming", &circularStreamingState)) {
+		world.setCircularStreamingState(circularStreamingState);
+	}
+
 	// Structure generation toggle
 	ImGui::Separator();
 	bool structureGenerationState = world.getStructureGenerationState();
@@ -503,8 +545,7 @@ void main::renderImGui(GLFWwindow* window, const glm::vec3& playerPosition, Play
 		ImVec2 canvasCenter = ImVec2(canvasPos.x + canvasSize.x / 2, canvasPos.y + canvasSize.y / 2);
 
 		// Draw chunks relative to the camera position, centering the camera on the canvas
-		for (const auto& pair : world.getChunks()) {
-			const Chunk* chunk = pair.second;
+		for (const Chunk* chunk : world.getChunks()) {
 
 			// Calculate chunk top-down coordinates
 			ImVec2 chunkPosMin = ImVec2(
@@ -551,6 +592,15 @@ void main::renderImGui(GLFWwindow* window, const glm::vec3& playerPosition, Play
 
 		// Display current memory usage value
 		ImGui::Text("Current Memory Usage: %zu MB", memoryUsage);
+
+		// Recently unloaded chunks kept compressed in memory
+		ChunkCache& chunkCache = world.getChunkCache();
+		ImGui::Text("Chunk Cache: %zu chunks, %.1f MB, %u hits, %u misses", chunkCache.getChunkCount(),
+			chunkCache.getMemoryUsage() / (1024.0f * 1024.0f), chunkCache.getHitCount(), chunkCache.getMissCount());
+		GLint chunkCacheBudget = static_cast<GLint>(chunkCache.getMemoryBudget() / (1024 * 1024));
+		if (ImGui::SliderInt("Chunk Cache Budget (MB)", &chunkCacheBudget, 0, 256)) {
+			chunkCache.setMemoryBudget(static_cast<size_t>(chunkCacheBudget) * 1024 * 1024);
+		}
 	}
 
 	if (ImGui::Button("Exit Game")) glfwSetWindowShouldClose(window, true);  // Close the game
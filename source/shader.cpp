@@ -94,7 +94,7 @@ void shader::setInt(const std::string& name, bool value) const
     glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
 }
 
-void shader::setFloat(const std::string& name, bool value) const
+void shader::setFloat(const std::string& name, float value) const
 {
     glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 }
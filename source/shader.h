@@ -27,7 +27,7 @@ public:
 
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, bool value) const;
-	void setFloat(const std::string& name, bool value) const;
+	void setFloat(const std::string& name, float value) const;
 
 	void checkCompileErrors(unsigned shader, std::string type);
 
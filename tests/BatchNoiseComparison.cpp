@@ -0,0 +1,139 @@
+#include "BatchNoise.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <vector>
+
+// Fills planes and blocks with every noise and fractal type that has a batch kernel and checks each sample
+// against GetNoise at the same coordinates, at zero, negative, large and lattice-stepped origins. Then times
+// a GetNoise loop against one batch call for the sizes the terrain generator fills. The kernels this build
+// runs depend on the flags: SSE2 by default, AVX2 with ENABLE_AVX2 and GetNoise per sample in the
+// BatchNoiseComparisonScalar build, which defines BATCH_NOISE_SCALAR
+
+namespace {
+	constexpr GLfloat epsilon = 1e-6f;
+	constexpr GLint timingRuns = 200;
+
+	struct NoiseSettings {
+		const char* name;
+		FastNoiseLite::NoiseType noiseType;
+		FastNoiseLite::FractalType fractalType;
+		bool is3D;
+	};
+
+	// Everything hasBatchKernel accepts, the fractals with 5 octaves like the terrain noise
+	const NoiseSettings settings[] = {
+		{ "Perlin 2D", FastNoiseLite::NoiseType_Perlin, FastNoiseLite::FractalType_None, false },
+		{ "Perlin 2D FBm", FastNoiseLite::NoiseType_Perlin, FastNoiseLite::FractalType_FBm, false },
+		{ "Perlin 2D Ridged", FastNoiseLite::NoiseType_Perlin, FastNoiseLite::FractalType_Ridged, false },
+		{ "OpenSimplex2 2D", FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_None, false },
+		{ "OpenSimplex2 2D FBm", FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_FBm, false },
+		{ "OpenSimplex2 2D Ridged", FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_Ridged, false },
+		{ "OpenSimplex2 3D", FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_None, true },
+		{ "OpenSimplex2 3D FBm", FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_FBm, true },
+		{ "OpenSimplex2 3D Ridged", FastNoiseLite::NoiseType_OpenSimplex2, FastNoiseLite::FractalType_Ridged, true },
+	};
+
+	struct Region {
+		GLint originX, originY, originZ;
+		GLint sizeX, sizeY, sizeZ;
+		GLint step;
+	};
+
+	// Sizes that aren't a multiple of the lane count check the kernels' remainder handling
+	const Region regions[] = {
+		{ 0, 0, 0, 16, 64, 16, 1 },
+		{ -1000, -37, -517, 17, 9, 13, 1 },
+		{ 1 << 20, 100, -(1 << 20), 16, 16, 16, 1 },
+		{ -48, 0, 32, 9, 58, 9, 2 },
+		{ 4096, 8, -4096, 5, 31, 5, 4 },
+	};
+
+	const char* getKernelName()
+	{
+#if defined(BATCH_NOISE_SCALAR)
+		return "scalar";
+#elif defined(__AVX2__)
+		return "AVX2";
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+
+	void fill(const BatchNoise& noise, const NoiseSettings& setting, const Region& region, GLfloat* out)
+	{
+		if (setting.is3D) noise.fillBlock(region.originX, region.originY, region.originZ, region.sizeX, region.sizeY, region.sizeZ, region.step, out);
+		else noise.fillPlane(region.originX, region.originZ, region.sizeX, region.sizeZ, region.step, out);
+	}
+
+	// Same layout as the batch calls, [x * sizeZ + z] for planes and [(x * sizeZ + z) * sizeY + y] for blocks
+	void fillWithGetNoise(const BatchNoise& noise, const NoiseSettings& setting, const Region& region, GLfloat* out)
+	{
+		const GLint sizeY = setting.is3D ? region.sizeY : 1;
+		for (GLint x = 0; x < region.sizeX; ++x) {
+			for (GLint z = 0; z < region.sizeZ; ++z) {
+				GLfloat sampleX = static_cast<GLfloat>(region.originX + x * region.step);
+				GLfloat sampleZ = static_cast<GLfloat>(region.originZ + z * region.step);
+				for (GLint y = 0; y < sizeY; ++y) {
+					out[(x * region.sizeZ + z) * sizeY + y] = setting.is3D
+						? noise.GetNoise(sampleX, static_cast<GLfloat>(region.originY + y * region.step), sampleZ)
+						: noise.GetNoise(sampleX, sampleZ);
+				}
+			}
+		}
+	}
+
+	template<typename Fill>
+	double timeFill(Fill fill)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (GLint run = 0; run < timingRuns; ++run) {
+			fill();
+		}
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / timingRuns;
+	}
+}
+
+int main()
+{
+	std::printf("%s kernels, %d regions per noise, epsilon %g\n", getKernelName(), static_cast<int>(std::size(regions)), epsilon);
+	std::printf("%-24s %10s %14s %12s %8s\n", "noise", "max error", "GetNoise us", "batch us", "speedup");
+
+	GLint failures = 0;
+	std::vector<GLfloat> expected, actual;
+	for (const NoiseSettings& setting : settings) {
+		BatchNoise noise(1337);
+		noise.SetNoiseType(setting.noiseType);
+		noise.SetFractalType(setting.fractalType);
+		noise.SetFractalOctaves(5);
+		noise.SetFrequency(0.016f);
+
+		GLfloat maxError = 0.0f;
+		for (const Region& region : regions) {
+			size_t samples = static_cast<size_t>(region.sizeX) * region.sizeZ * (setting.is3D ? region.sizeY : 1);
+			expected.assign(samples, 0.0f);
+			actual.assign(samples, 0.0f);
+			fillWithGetNoise(noise, setting, region, expected.data());
+			fill(noise, setting, region, actual.data());
+			for (size_t i = 0; i < samples; ++i) {
+				maxError = std::max(maxError, std::abs(actual[i] - expected[i]));
+			}
+		}
+
+		// A chunk's plane or its full height block, like getColumns and the cave lattice
+		const Region timed = { 0, 0, 0, 16, 64, 16, 1 };
+		expected.resize(static_cast<size_t>(timed.sizeX) * timed.sizeY * timed.sizeZ);
+		actual.resize(expected.size());
+		double getNoiseTime = timeFill([&]() { fillWithGetNoise(noise, setting, timed, expected.data()); });
+		double batchTime = timeFill([&]() { fill(noise, setting, timed, actual.data()); });
+
+		bool isMatching = maxError <= epsilon;
+		failures += !isMatching;
+		std::printf("%-24s %10.2g %14.1f %12.1f %7.1fx%s\n", setting.name, maxError, getNoiseTime, batchTime, getNoiseTime / batchTime, isMatching ? "" : "  differs from GetNoise");
+	}
+	return failures == 0 ? 0 : 1;
+}
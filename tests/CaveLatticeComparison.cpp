@@ -0,0 +1,171 @@
+#include "TerrainGenerator.h"
+#include "Chunk.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Quality and time of the cave noise lattice Chunk::generateChunk samples and interpolates, for several
+// lattice spacings against the noise at every block. Misclassified counts the blocks of the cave band
+// whose cave or solid state differs from the exact noise. generateChunk uses a 2 block lattice, the test
+// fails once that spacing misclassifies more than maxMisclassified of the band or changes the cave volume
+// by more than maxCaveVolumeChange, time to look at the spacing again. Usage: CaveLatticeComparison [radius] [runs]
+
+namespace {
+	// Same band as generateChunk: above caveMinHeight, below the surface buffer and not above the terrain
+	constexpr GLint caveMinHeight = CHUNK_HEIGHT / 64;
+	constexpr GLint surfaceBuffer = CHUNK_HEIGHT / 9;
+
+	constexpr GLint shippedSpacing = 2;
+	constexpr double maxMisclassified = 0.001;
+	constexpr double maxCaveVolumeChange = 0.1;
+
+	struct LatticeSpacing {
+		GLint xz, y;
+	};
+
+	struct ChunkColumns {
+		GLint originX, originZ;
+		std::vector<TerrainColumn> columns;
+		GLint caveTop;
+	};
+
+	bool isInCaveBand(GLint y, const TerrainColumn& column)
+	{
+		return y > caveMinHeight && y < CHUNK_HEIGHT - surfaceBuffer && y <= column.height;
+	}
+
+	// Fills the lattice of one chunk and interpolates it to every block of the band, isCave is indexed like
+	// the chunk's blocks [(x * CHUNK_SIZE + z) * CHUNK_HEIGHT + y]
+	void classifyCaves(const TerrainGenerator& terrain, const ChunkColumns& chunk, LatticeSpacing spacing, std::vector<GLfloat>& lattice, std::vector<uint8_t>& isCave)
+	{
+		const GLint samplesXZ = CHUNK_SIZE / spacing.xz + 1;
+		const GLint samplesY = chunk.caveTop / spacing.y + 2;
+		lattice.resize(samplesXZ * samplesXZ * samplesY);
+		if (spacing.xz == spacing.y) {
+			terrain.fillCaveNoise(chunk.originX, 0, chunk.originZ, samplesXZ, samplesY, samplesXZ, spacing.xz, lattice.data());
+		}
+		else {
+			// The batch noise has one step for all axes, a lattice stretched along y is filled a level at a time
+			std::vector<GLfloat> level(samplesXZ * samplesXZ);
+			for (GLint j = 0; j < samplesY; ++j) {
+				terrain.fillCaveNoise(chunk.originX, j * spacing.y, chunk.originZ, samplesXZ, 1, samplesXZ, spacing.xz, level.data());
+				for (GLint column = 0; column < samplesXZ * samplesXZ; ++column) {
+					lattice[column * samplesY + j] = level[column];
+				}
+			}
+		}
+
+		isCave.assign(CHUNK_SIZE * CHUNK_SIZE * CHUNK_HEIGHT, 0);
+		std::vector<GLfloat> caveColumn(samplesY);
+		for (GLint x = 0; x < CHUNK_SIZE; ++x) {
+			for (GLint z = 0; z < CHUNK_SIZE; ++z) {
+				const TerrainColumn& column = chunk.columns[x * CHUNK_SIZE + z];
+				GLint i = x / spacing.xz, k = z / spacing.xz;
+				GLfloat fx = static_cast<GLfloat>(x % spacing.xz) / spacing.xz;
+				GLfloat fz = static_cast<GLfloat>(z % spacing.xz) / spacing.xz;
+				const GLfloat* c00 = &lattice[(i * samplesXZ + k) * samplesY];
+				const GLfloat* c01 = c00 + samplesY;
+				const GLfloat* c10 = c00 + samplesXZ * samplesY;
+				const GLfloat* c11 = c10 + samplesY;
+				for (GLint j = 0; j < samplesY; ++j) {
+					GLfloat low = c00[j] + (c10[j] - c00[j]) * fx;
+					GLfloat high = c01[j] + (c11[j] - c01[j]) * fx;
+					caveColumn[j] = low + (high - low) * fz;
+				}
+
+				for (GLint y = 0; y < CHUNK_HEIGHT; ++y) {
+					if (!isInCaveBand(y, column)) continue;
+					GLint j = y / spacing.y;
+					GLfloat fy = static_cast<GLfloat>(y % spacing.y) / spacing.y;
+					GLfloat caveValue = caveColumn[j] + (caveColumn[j + 1] - caveColumn[j]) * fy;
+					isCave[(x * CHUNK_SIZE + z) * CHUNK_HEIGHT + y] = caveValue > column.caveThreshold;
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const GLint radius = argc > 1 ? std::atoi(argv[1]) : 11;
+	const GLint runs = argc > 2 ? std::atoi(argv[2]) : 3;
+
+	TerrainGenerator terrain;
+	std::vector<ChunkColumns> chunks;
+	for (GLint chunkX = -radius; chunkX <= radius; ++chunkX) {
+		for (GLint chunkZ = -radius; chunkZ <= radius; ++chunkZ) {
+			ChunkColumns chunk = { chunkX * CHUNK_SIZE, chunkZ * CHUNK_SIZE, std::vector<TerrainColumn>(CHUNK_SIZE * CHUNK_SIZE), 0 };
+			terrain.getColumns(chunk.originX, chunk.originZ, CHUNK_SIZE, CHUNK_SIZE, chunk.columns.data());
+			for (const TerrainColumn& column : chunk.columns) {
+				chunk.caveTop = std::max(chunk.caveTop, std::min<GLint>(column.height, CHUNK_HEIGHT - surfaceBuffer - 1));
+			}
+			chunks.push_back(std::move(chunk));
+		}
+	}
+
+	// A 1 block lattice samples every block, the interpolation leaves the samples as they are
+	std::vector<GLfloat> lattice;
+	std::vector<std::vector<uint8_t>> exactCaves(chunks.size());
+	size_t bandBlocks = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		classifyCaves(terrain, chunks[i], { 1, 1 }, lattice, exactCaves[i]);
+		for (GLint x = 0; x < CHUNK_SIZE; ++x) {
+			for (GLint z = 0; z < CHUNK_SIZE; ++z) {
+				for (GLint y = 0; y < CHUNK_HEIGHT; ++y) {
+					bandBlocks += isInCaveBand(y, chunks[i].columns[x * CHUNK_SIZE + z]);
+				}
+			}
+		}
+	}
+
+	std::printf("%zu chunks, %zu blocks in the cave band\n", chunks.size(), bandBlocks);
+	std::printf("%-12s %10s %14s %12s\n", "lattice", "us/chunk", "misclassified", "cave blocks");
+
+	const LatticeSpacing spacings[] = { { 1, 1 }, { 8, 8 }, { 4, 4 }, { 4, 2 }, { 2, 4 }, { 2, 2 } };
+	bool isShippedSpacingGood = true;
+	std::vector<uint8_t> isCave;
+	size_t exactCaveBlocks = 0;
+	for (LatticeSpacing spacing : spacings) {
+		double best = 0.0;
+		for (GLint run = 0; run < runs; ++run) {
+			auto start = std::chrono::steady_clock::now();
+			for (const ChunkColumns& chunk : chunks) {
+				classifyCaves(terrain, chunk, spacing, lattice, isCave);
+			}
+			double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			best = run == 0 ? elapsed : std::min(best, elapsed);
+		}
+
+		size_t misclassified = 0;
+		size_t caveBlocks = 0;
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			classifyCaves(terrain, chunks[i], spacing, lattice, isCave);
+			for (size_t block = 0; block < isCave.size(); ++block) {
+				misclassified += isCave[block] != exactCaves[i][block];
+				caveBlocks += isCave[block];
+			}
+		}
+		if (spacing.xz == 1) exactCaveBlocks = caveBlocks;
+
+		char name[32];
+		if (spacing.xz == 1) std::snprintf(name, sizeof(name), "exact");
+		else if (spacing.xz == spacing.y) std::snprintf(name, sizeof(name), "%d blocks", spacing.xz);
+		else std::snprintf(name, sizeof(name), "%d xz, %d y", spacing.xz, spacing.y);
+		double misclassifiedShare = static_cast<double>(misclassified) / bandBlocks;
+		std::printf("%-12s %10.1f %13.3f%% %12zu\n", name, best / chunks.size(), 100.0 * misclassifiedShare, caveBlocks);
+
+		if (spacing.xz == shippedSpacing && spacing.y == shippedSpacing) {
+			double volumeChange = std::abs(static_cast<double>(caveBlocks) - static_cast<double>(exactCaveBlocks)) / std::max<size_t>(exactCaveBlocks, 1);
+			isShippedSpacingGood = misclassifiedShare <= maxMisclassified && volumeChange <= maxCaveVolumeChange;
+		}
+	}
+
+	if (!isShippedSpacingGood) {
+		std::printf("The %d block lattice generateChunk uses is too far off the exact cave noise\n", shippedSpacing);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include "World.h"
+#include "GLStub.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Lookups per second of World::getChunk from 1 and 8 reader threads on random coordinates around spawn,
+// with the main thread idle and with it streaming chunks in and out while the player steps back and forth
+// over a few chunks. Readers renew their pin every few thousand lookups like the jobs do. Fails when a
+// lookup returns a chunk other than the one asked for. Usage: ChunkLookupThroughput [lookups per reader]
+
+namespace {
+	// Lookups go to a 41x41 area, the chunks at render distance 12 and some that aren't loaded
+	constexpr GLint lookupRadius = 20;
+	constexpr size_t lookupsPerPin = 4096;
+}
+
+int main(int argc, char** argv)
+{
+	const size_t lookupsPerReader = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+	const GLuint seed = 42;
+
+	installGLStubs();
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::path("saves") / std::to_string(seed), error);
+
+	Camera camera;
+	Frustum frustum;
+	glm::vec3 position(8.0f, 100.0f, 8.0f);
+	frustum.update(glm::perspective(glm::radians(75.0f), 1280.0f / 720.0f, 0.1f, 320.0f) * camera.setPosition(position));
+	World world(frustum, seed);
+	world.setFrustumCullingState(false);
+	shader mainShader("main.vs", "main.fs");
+	while (!world.isInitialChunksLoaded()) {
+		world.processChunkLoadQueue(1, 1);
+	}
+
+	size_t wrongChunks = 0;
+	for (bool isStreaming : { false, true }) {
+		for (size_t readers : { 1, 8 }) {
+			std::atomic<bool> isStarted = false;
+			std::atomic<size_t> finishedReaders = 0;
+			std::atomic<size_t> found = 0;
+			std::atomic<size_t> wrong = 0;
+			std::vector<std::thread> threads;
+			for (size_t reader = 0; reader < readers; ++reader) {
+				threads.emplace_back([&, reader]() {
+					uint32_t random = 12345u + static_cast<uint32_t>(reader) * 7919u;
+					size_t readerFound = 0;
+					size_t readerWrong = 0;
+					EpochReclaimer<Chunk>::Guard pin;
+					while (!isStarted) std::this_thread::yield();
+					for (size_t i = 0; i < lookupsPerReader; ++i) {
+						if (i % lookupsPerPin == 0) pin = world.pinChunks();
+						random = random * 1664525u + 1013904223u;
+						int16_t x = static_cast<int16_t>(static_cast<GLint>((random >> 8) % (2 * lookupRadius + 1)) - lookupRadius);
+						int16_t z = static_cast<int16_t>(static_cast<GLint>((random >> 20) % (2 * lookupRadius + 1)) - lookupRadius);
+						if (Chunk* chunk = world.getChunk(x, z)) {
+							++readerFound;
+							readerWrong += chunk->getChunkX() != x || chunk->getChunkZ() != z;
+						}
+					}
+					found += readerFound;
+					wrong += readerWrong;
+					++finishedReaders;
+				});
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			isStarted = true;
+			GLint frame = 0;
+			while (finishedReaders < readers) {
+				if (isStreaming) {
+					// Three chunks east and back every 20 frames, the edge of the area loads and unloads each time
+					position.x = 8.0f + ((frame++ / 20) % 2) * 3 * CHUNK_SIZE;
+					frustum.update(glm::perspective(glm::radians(75.0f), 1280.0f / 720.0f, 0.1f, 320.0f) * camera.setPosition(position));
+					world.updatePlayerPosition(position, frustum);
+					world.processChunkLoadQueue(8, 0);
+					world.Draw(frustum, mainShader);
+				}
+				else {
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+				}
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+
+			size_t lookups = readers * lookupsPerReader;
+			wrongChunks += wrong;
+			std::cout << (isStreaming ? "streaming" : "idle") << ", " << readers << " readers: " << lookups / seconds / 1e6 << " M lookups/s, "
+				<< 100.0 * found / lookups << "% found, " << wrong << " wrong chunks" << std::endl;
+		}
+	}
+	return wrongChunks == 0 ? 0 : 1;
+}
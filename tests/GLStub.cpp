@@ -0,0 +1,95 @@
+#include "GLStub.h"
+#include <glad/glad.h>
+#include <atomic>
+
+namespace {
+	std::atomic<GLuint> nextName = 1;
+
+	template<typename Result, typename... Args>
+	Result APIENTRY ignore(Args...)
+	{
+		return Result();
+	}
+
+	template<typename Result, typename... Args>
+	void stub(Result(APIENTRY*& function)(Args...))
+	{
+		function = &ignore<Result, Args...>;
+	}
+
+	void APIENTRY generateNames(GLsizei count, GLuint* names)
+	{
+		for (GLsizei i = 0; i < count; ++i) names[i] = nextName++;
+	}
+
+	GLuint APIENTRY createProgram()
+	{
+		return nextName++;
+	}
+
+	GLuint APIENTRY createShader(GLenum)
+	{
+		return nextName++;
+	}
+
+	// Compile and link status, the info logs are never asked for
+	void APIENTRY getStatus(GLuint, GLenum, GLint* value)
+	{
+		*value = GL_TRUE;
+	}
+}
+
+void installGLStubs()
+{
+	glad_glGenBuffers = generateNames;
+	glad_glGenVertexArrays = generateNames;
+	glad_glGenTextures = generateNames;
+	glad_glCreateProgram = createProgram;
+	glad_glCreateShader = createShader;
+	glad_glGetShaderiv = getStatus;
+	glad_glGetProgramiv = getStatus;
+
+	stub(glad_glActiveTexture);
+	stub(glad_glAttachShader);
+	stub(glad_glBindBuffer);
+	stub(glad_glBindTexture);
+	stub(glad_glBindVertexArray);
+	stub(glad_glBlendFunc);
+	stub(glad_glBufferData);
+	stub(glad_glBufferSubData);
+	stub(glad_glCompileShader);
+	stub(glad_glCullFace);
+	stub(glad_glDeleteBuffers);
+	stub(glad_glDeleteProgram);
+	stub(glad_glDeleteShader);
+	stub(glad_glDeleteTextures);
+	stub(glad_glDeleteVertexArrays);
+	stub(glad_glDisable);
+	stub(glad_glDrawElements);
+	stub(glad_glEnable);
+	stub(glad_glEnableVertexAttribArray);
+	stub(glad_glGenerateMipmap);
+	stub(glad_glGetProgramInfoLog);
+	stub(glad_glGetShaderInfoLog);
+	stub(glad_glGetUniformLocation);
+	stub(glad_glLinkProgram);
+	stub(glad_glShaderSource);
+	stub(glad_glTexImage2D);
+	stub(glad_glTexImage3D);
+	stub(glad_glTexParameteri);
+	stub(glad_glTexSubImage3D);
+	stub(glad_glUniform1f);
+	stub(glad_glUniform1i);
+	stub(glad_glUniform2f);
+	stub(glad_glUniform2fv);
+	stub(glad_glUniform3f);
+	stub(glad_glUniform3fv);
+	stub(glad_glUniform4f);
+	stub(glad_glUniform4fv);
+	stub(glad_glUniformMatrix2fv);
+	stub(glad_glUniformMatrix3fv);
+	stub(glad_glUniformMatrix4fv);
+	stub(glad_glUseProgram);
+	stub(glad_glVertexAttribIPointer);
+	stub(glad_glVertexAttribPointer);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Points every GL function the engine calls at a stub, so chunks can be meshed, uploaded and drawn
+// without a context. Object names come from a counter and every shader compiles and links
+void installGLStubs();
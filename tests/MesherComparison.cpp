@@ -0,0 +1,153 @@
+#include "World.h"
+#include "GLStub.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// Meshes the chunks around spawn of a fixed seed with the naive, the greedy and the binary greedy mesher,
+// times each and checks that both greedy meshers cover exactly the faces the naive one builds, each lit
+// like the naive one lights it. Every quad is expanded back into the unit faces it covers, keyed by face
+// direction and texture layer and carrying the quad's light, so merging quads differently doesn't count as
+// a difference but a merge across a change in light does. Usage: MesherComparison [seed] [runs]
+
+namespace {
+	enum Mesher { Naive, Greedy, Binary, MesherCount };
+	const char* const mesherNames[] = { "naive", "greedy", "binary greedy" };
+
+	struct MeshedChunk {
+		Chunk* chunk;
+		ChunkSnapshot snapshot;
+	};
+
+	// One key per unit face a quad covers: face and layer on top, then the block coordinates in 12 bits each and
+	// the light in the lowest 4 bits. Keys sort by position first, so without the light they are still sorted
+	void addUnitFaces(const std::vector<PackedVertex>& vertices, std::vector<uint64_t>& faces)
+	{
+		for (size_t quad = 0; quad + 3 < vertices.size(); quad += 4) {
+			GLint minCorner[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+			GLint maxCorner[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+			for (size_t corner = quad; corner < quad + 4; ++corner) {
+				GLuint position = vertices[corner].position;
+				GLint coordinates[3] = { static_cast<GLint>(position & 0x1FF), static_cast<GLint>((position >> 9) & 0xFFF), static_cast<GLint>((position >> 21) & 0x1FF) };
+				for (GLint axis = 0; axis < 3; ++axis) {
+					minCorner[axis] = std::min(minCorner[axis], coordinates[axis]);
+					maxCorner[axis] = std::max(maxCorner[axis], coordinates[axis]);
+				}
+			}
+
+			// Positions are in 1/16 blocks, the quad is flat along its normal
+			GLint extent[3];
+			for (GLint axis = 0; axis < 3; ++axis) {
+				extent[axis] = std::max((maxCorner[axis] - minCorner[axis]) / 16, 1);
+			}
+			uint64_t face = vertices[quad].attributes & 0x7;
+			uint64_t layer = (vertices[quad].attributes >> 7) & 0xFF;
+			uint64_t light = (vertices[quad].attributes >> 3) & 0xF;
+			for (GLint x = 0; x < extent[0]; ++x) {
+				for (GLint y = 0; y < extent[1]; ++y) {
+					for (GLint z = 0; z < extent[2]; ++z) {
+						faces.push_back((face << 52) | (layer << 44) | (static_cast<uint64_t>(minCorner[0] / 16 + x) << 32) |
+							(static_cast<uint64_t>(minCorner[1] / 16 + y) << 16) | (static_cast<uint64_t>(minCorner[2] / 16 + z) << 4) | light);
+					}
+				}
+			}
+		}
+	}
+
+	bool hasSameCoverage(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](uint64_t faceA, uint64_t faceB) { return faceA >> 4 == faceB >> 4; });
+	}
+
+	void setMesher(World& world, Mesher mesher)
+	{
+		world.setGreedyMeshingEnabled(mesher != Naive);
+		world.setBinaryGreedyMeshingEnabled(mesher == Binary);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const GLuint seed = argc > 1 ? static_cast<GLuint>(std::atoi(argv[1])) : 42;
+	const GLint runs = argc > 2 ? std::atoi(argv[2]) : 4;
+
+	installGLStubs();
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::path("saves") / std::to_string(seed), error);
+
+	Camera camera;
+	Frustum frustum;
+	frustum.update(glm::perspective(glm::radians(75.0f), 1280.0f / 720.0f, 0.1f, 320.0f) * camera.updateView());
+	World world(frustum, seed);
+	while (!world.isInitialChunksLoaded()) {
+		world.processChunkLoadQueue(1, 1);
+	}
+
+	// The snapshots are taken once, every mesher works on the same blocks and light
+	std::vector<MeshedChunk> chunks;
+	for (Chunk* chunk : world.getChunks()) {
+		if (chunk->hasReached(ChunkState::Decorated)) {
+			chunks.push_back({ chunk, chunk->captureSnapshot() });
+		}
+	}
+
+	// Unit faces of every chunk per mesher, solid and water kept apart
+	std::vector<std::vector<uint64_t>> solidFaces[MesherCount];
+	std::vector<std::vector<uint64_t>> waterFaces[MesherCount];
+	size_t quadCounts[MesherCount] = {};
+	ChunkMesh mesh;
+	for (GLint mesher = Naive; mesher < MesherCount; ++mesher) {
+		setMesher(world, static_cast<Mesher>(mesher));
+		solidFaces[mesher].resize(chunks.size());
+		waterFaces[mesher].resize(chunks.size());
+
+		double best = 0.0;
+		for (GLint run = 0; run < runs; ++run) {
+			auto start = std::chrono::steady_clock::now();
+			for (MeshedChunk& meshed : chunks) {
+				for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+					if (meshed.snapshot.hasNoVisibleFaces(section)) continue;
+					meshed.chunk->generateMesh(meshed.snapshot, mesh, section);
+				}
+			}
+			double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			best = run == 0 ? elapsed : std::min(best, elapsed);
+		}
+
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			for (GLint section = 0; section < CHUNK_SECTIONS; ++section) {
+				if (chunks[i].snapshot.hasNoVisibleFaces(section)) continue;
+				chunks[i].chunk->generateMesh(chunks[i].snapshot, mesh, section);
+				addUnitFaces(mesh.vertices, solidFaces[mesher][i]);
+				addUnitFaces(mesh.waterVertices, waterFaces[mesher][i]);
+				quadCounts[mesher] += (mesh.vertices.size() + mesh.waterVertices.size()) / 4;
+			}
+			std::sort(solidFaces[mesher][i].begin(), solidFaces[mesher][i].end());
+			std::sort(waterFaces[mesher][i].begin(), waterFaces[mesher][i].end());
+		}
+
+		std::cout << mesherNames[mesher] << ": " << best / chunks.size() << " us/chunk, " << quadCounts[mesher] << " quads, best of " << runs << " runs" << std::endl;
+	}
+
+	GLint failures = 0;
+	for (GLint mesher = Greedy; mesher < MesherCount; ++mesher) {
+		size_t differing = 0;
+		size_t differentlyLit = 0;
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			if (!hasSameCoverage(solidFaces[mesher][i], solidFaces[Naive][i]) || !hasSameCoverage(waterFaces[mesher][i], waterFaces[Naive][i])) {
+				++differing;
+			}
+			else if (solidFaces[mesher][i] != solidFaces[Naive][i] || waterFaces[mesher][i] != waterFaces[Naive][i]) {
+				++differentlyLit;
+			}
+		}
+		std::cout << mesherNames[mesher] << ": " << differing << " of " << chunks.size() << " chunks cover different faces than the naive mesher, "
+			<< differentlyLit << " light faces differently" << std::endl;
+		failures += differing != 0 || differentlyLit != 0;
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include "World.h"
+#include "GLStub.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+// Streams and meshes a world while the player walks and places a block every frame, so mesh, light and
+// edit jobs race the main thread's uploads and unloads the whole time. Built with ENABLE_TSAN this is
+// the check for the chunk threads. The test itself fails when the pipeline doesn't settle afterwards
+// or an edit got lost. Usage: MeshingStress [frames]
+
+namespace {
+	struct Edit {
+		GLint x, z;
+		int8_t type;
+	};
+
+	const ChunkState busyStates[] = { ChunkState::Queued, ChunkState::Generating, ChunkState::Decorating, ChunkState::Lighting, ChunkState::Meshing, ChunkState::MeshReady };
+
+	bool isPipelineBusy(const ChunkStateCounts& counts)
+	{
+		for (ChunkState state : busyStates) {
+			if (counts.get(state) != 0) return true;
+		}
+		return false;
+	}
+
+	GLint toChunk(GLint block)
+	{
+		return block >= 0 ? block / CHUNK_SIZE : (block + 1) / CHUNK_SIZE - 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const GLint frames = argc > 1 ? std::atoi(argv[1]) : 640;
+	const GLuint seed = 1234;
+
+	installGLStubs();
+	// Saved chunks of an earlier run would skip generation
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::path("saves") / std::to_string(seed), error);
+
+	Camera camera;
+	Frustum frustum;
+	glm::vec3 position(8.0f, 100.0f, 8.0f);
+	const glm::mat4 projection = glm::perspective(glm::radians(75.0f), 1280.0f / 720.0f, 0.1f, 320.0f);
+	const glm::vec3 lightDirection(-0.2f, -1.0f, -0.3f);
+	frustum.update(projection * camera.setPosition(position));
+
+	World world(frustum, seed);
+	shader mainShader("main.vs", "main.fs");
+	shader waterShader("water.vs", "water.fs");
+
+	auto runFrame = [&]() {
+		glm::mat4 view = camera.setPosition(position);
+		frustum.update(projection * view);
+		world.resetFrameStats();
+		world.updatePlayerPosition(position, frustum);
+		world.processChunkLoadQueue(4, 0);
+		world.Draw(frustum, mainShader);
+		world.DrawWater(frustum, waterShader, view, projection, lightDirection, camera);
+	};
+
+	// Like the loading screen, the player only starts moving once the chunks around spawn are there
+	auto start = std::chrono::steady_clock::now();
+	while (!world.isInitialChunksLoaded()) {
+		world.processChunkLoadQueue(1, 1);
+	}
+	std::cout << "Initial chunks loaded in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s, " << world.getChunks().size() << " chunks" << std::endl;
+
+	// A block per frame along x and back again, every frame places a torch or glass at a new spot next to
+	// the player. The chunks edited on the way out unload and come back from the cache on the way back
+	std::vector<Edit> edits;
+	for (GLint frame = 0; frame < frames; ++frame) {
+		position.x += frame < frames / 2 ? 1.0f : -1.0f;
+		Edit edit = { static_cast<GLint>(std::floor(position.x)), 8 + frame % 16, static_cast<int8_t>(frame % 2 ? TORCH : GLASS) };
+		world.setBlock(static_cast<int16_t>(edit.x), 100, static_cast<int16_t>(edit.z), edit.type);
+		// The player outruns streaming, an edit in a chunk that isn't there is dropped like in the game
+		Chunk* chunk = world.getChunk(static_cast<int16_t>(toChunk(edit.x)), static_cast<int16_t>(toChunk(edit.z)));
+		if (chunk && chunk->hasReached(ChunkState::Decorated)) {
+			edits.push_back(edit);
+		}
+		runFrame();
+	}
+
+	// Standing still the pipeline has to drain, only chunks waiting for neighbours outside the load area stay behind
+	const ChunkStateCounts& counts = world.getChunkStateCounts();
+	auto settleStart = std::chrono::steady_clock::now();
+	GLint idleFrames = 0;
+	while (idleFrames < 10) {
+		if (std::chrono::steady_clock::now() - settleStart > std::chrono::minutes(5)) {
+			std::cerr << "The chunk pipeline didn't settle" << std::endl;
+			for (ChunkState state : busyStates) {
+				std::cerr << "  " << getChunkStateName(state) << ": " << counts.get(state) << std::endl;
+			}
+			return 1;
+		}
+		runFrame();
+		idleFrames = isPipelineBusy(counts) ? 0 : idleFrames + 1;
+	}
+
+	// Only the edits in loaded chunks can be checked, the far end of the walk is out of range again. A later
+	// edit at the same spot wins
+	std::unordered_map<GLint, int8_t> expectedTypes;
+	for (const Edit& edit : edits) {
+		expectedTypes[(edit.x << 16) | edit.z] = edit.type;
+	}
+	GLint checkedEdits = 0;
+	GLint lostEdits = 0;
+	for (const auto& [key, type] : expectedTypes) {
+		GLint x = key >> 16;
+		GLint z = key & 0xFFFF;
+		GLint chunkX = toChunk(x);
+		GLint chunkZ = toChunk(z);
+		Chunk* chunk = world.getChunk(static_cast<int16_t>(chunkX), static_cast<int16_t>(chunkZ));
+		if (!chunk) continue;
+
+		++checkedEdits;
+		if (chunk->getBlockType(x - chunkX * CHUNK_SIZE, 100, z - chunkZ * CHUNK_SIZE) != type) {
+			++lostEdits;
+		}
+	}
+
+	std::cout << frames << " frames with an edit each, " << world.getChunks().size() << " chunks loaded, "
+		<< counts.get(ChunkState::Uploaded) << " uploaded, " << lostEdits << " of " << checkedEdits << " edits checked lost" << std::endl;
+	return lostEdits == 0 && checkedEdits > 0 ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+#include "World.h"
+#include "ChunkStorage.h"
+#include "GLStub.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Times what a load job does for a chunk that was never saved against one that was: generating the
+// terrain, decorating and lighting it, or reading the payload from the region files and restoring it with
+// its light. Fails when a restored chunk's blocks, light or structure anchors differ from the generated
+// one, or a saved chunk can't be found in storage again. Usage: StoredChunkLoad [seed] [runs]
+
+namespace {
+	// Chunks within this distance of spawn, their neighbours are all part of the initial load
+	constexpr GLint radius = 6;
+
+	struct StoredChunk {
+		GLint x, z;
+		std::array<const Chunk*, 9> neighbourhood;
+		std::vector<uint8_t> payload;
+	};
+
+	double elapsedMicroseconds(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Like the load job and the decoration job together, for a chunk storage has nothing for
+	Chunk* generate(World& world, TextureManager& textureManager, const StoredChunk& stored)
+	{
+		Chunk* chunk = new Chunk(stored.x, stored.z, textureManager, &world);
+		std::array<const Chunk*, 9> neighbourhood = stored.neighbourhood;
+		neighbourhood[4] = chunk;
+		chunk->advanceState(ChunkState::Generated, ChunkState::Decorating);
+		chunk->decorate(neighbourhood);
+		return chunk;
+	}
+
+	// Anchors have to come back with their random stream where it was, neighbours generated again replay
+	// them to build their part of the structure
+	bool hasSameAnchor(const StructureAnchor& a, const StructureAnchor& b)
+	{
+		WorldRandom randomA = a.random;
+		WorldRandom randomB = b.random;
+		return a.type == b.type && a.x == b.x && a.y == b.y && a.z == b.z &&
+			a.random.getPosition() == b.random.getPosition() && randomA.next() == randomB.next();
+	}
+
+	bool hasSameContents(const Chunk& a, const Chunk& b)
+	{
+		for (GLint x = 0; x < CHUNK_SIZE; ++x) {
+			for (GLint y = 0; y < CHUNK_HEIGHT; ++y) {
+				for (GLint z = 0; z < CHUNK_SIZE; ++z) {
+					if (a.getStoredBlock(x, y, z) != b.getStoredBlock(x, y, z) || a.getStoredLight(x, y, z) != b.getStoredLight(x, y, z)) return false;
+				}
+			}
+		}
+		return std::equal(a.structureAnchors.begin(), a.structureAnchors.end(), b.structureAnchors.begin(), b.structureAnchors.end(), hasSameAnchor);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const GLuint seed = argc > 1 ? static_cast<GLuint>(std::atoi(argv[1])) : 42;
+	const GLint runs = argc > 2 ? std::atoi(argv[2]) : 3;
+
+	installGLStubs();
+	std::error_code error;
+	std::filesystem::remove_all(std::filesystem::path("saves") / std::to_string(seed), error);
+	const std::filesystem::path storageDirectory = std::filesystem::path("saves") / "StoredChunkLoad";
+	std::filesystem::remove_all(storageDirectory, error);
+
+	Camera camera;
+	Frustum frustum;
+	frustum.update(glm::perspective(glm::radians(75.0f), 1280.0f / 720.0f, 0.1f, 320.0f) * camera.updateView());
+	World world(frustum, seed);
+	while (!world.isInitialChunksLoaded()) {
+		world.processChunkLoadQueue(1, 1);
+	}
+
+	// The world's chunks are only the neighbours, the timed chunks are built next to them and never join the grid
+	std::vector<StoredChunk> chunks;
+	for (GLint x = -radius; x <= radius; ++x) {
+		for (GLint z = -radius; z <= radius; ++z) {
+			StoredChunk stored = { x, z, {}, {} };
+			bool hasNeighbourhood = true;
+			for (GLint dx = -1; dx <= 1; ++dx) {
+				for (GLint dz = -1; dz <= 1; ++dz) {
+					const Chunk* neighbour = world.getChunk(static_cast<int16_t>(x + dx), static_cast<int16_t>(z + dz));
+					hasNeighbourhood = hasNeighbourhood && neighbour && neighbour->hasReached(ChunkState::Generated);
+					stored.neighbourhood[(dx + 1) * 3 + (dz + 1)] = neighbour;
+				}
+			}
+			if (hasNeighbourhood) chunks.push_back(std::move(stored));
+		}
+	}
+
+	TextureManager textureManager;
+	size_t payloadBytes = 0;
+	for (StoredChunk& stored : chunks) {
+		std::unique_ptr<Chunk> chunk(generate(world, textureManager, stored));
+		chunk->save(stored.payload);
+		payloadBytes += stored.payload.size();
+	}
+
+	double bestGeneration = 0.0;
+	double bestRestore = 0.0;
+	for (GLint run = 0; run < runs; ++run) {
+		auto start = std::chrono::steady_clock::now();
+		for (const StoredChunk& stored : chunks) {
+			delete generate(world, textureManager, stored);
+		}
+		double generation = elapsedMicroseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		for (const StoredChunk& stored : chunks) {
+			delete new Chunk(stored.x, stored.z, textureManager, &world, &stored.payload);
+		}
+		double restore = elapsedMicroseconds(start);
+
+		bestGeneration = run == 0 ? generation : std::min(bestGeneration, generation);
+		bestRestore = run == 0 ? restore : std::min(bestRestore, restore);
+	}
+
+	size_t differing = 0;
+	size_t anchors = 0;
+	for (const StoredChunk& stored : chunks) {
+		std::unique_ptr<Chunk> generated(generate(world, textureManager, stored));
+		Chunk restored(stored.x, stored.z, textureManager, &world, &stored.payload);
+		differing += !hasSameContents(*generated, restored);
+		anchors += generated->structureAnchors.size();
+	}
+
+	// Written out by the I/O thread when the storage closes, read back through the region file mapping
+	{
+		ChunkStorage storage(storageDirectory);
+		for (const StoredChunk& stored : chunks) {
+			storage.save(static_cast<int16_t>(stored.x), static_cast<int16_t>(stored.z), stored.payload);
+		}
+	}
+	ChunkStorage storage(storageDirectory);
+	std::vector<uint8_t> payload;
+	size_t found = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (const StoredChunk& stored : chunks) {
+		found += storage.load(static_cast<int16_t>(stored.x), static_cast<int16_t>(stored.z), payload);
+	}
+	double lookup = elapsedMicroseconds(start);
+
+	std::cout << chunks.size() << " chunks, " << payloadBytes / 1024.0 / chunks.size() << " KB payload per chunk" << std::endl;
+	std::cout << "generated: " << bestGeneration / chunks.size() / 1000.0 << " ms/chunk for terrain, decoration and light" << std::endl;
+	std::cout << "restored: " << bestRestore / chunks.size() / 1000.0 << " ms/chunk with light, " << bestGeneration / bestRestore << "x faster" << std::endl;
+	std::cout << "storage lookup: " << lookup / chunks.size() << " us/chunk, " << found << " of " << chunks.size() << " found" << std::endl;
+	std::cout << differing << " of " << chunks.size() << " restored chunks differ from the generated ones, " << anchors << " structure anchors compared" << std::endl;
+	return differing == 0 && anchors > 0 && found == chunks.size() ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include "ThreadPool.h"
+#include "SingleQueueThreadPool.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Runs a million tiny tasks through the work-stealing pool and through the single-queue pool it replaced.
+// Each task increments a counter and carries a 72 byte capture, about what the chunk jobs capture. Tasks are
+// queued from the main thread with 1 and 4 workers and from inside tasks, the way a job submits its
+// follow-up work. Fails when a task didn't run. Usage: ThreadPoolBenchmark [tasks]
+
+namespace {
+	// Tasks queued from inside tasks are spread over this many parent tasks
+	constexpr size_t parentTasks = 1000;
+
+	std::atomic<size_t> counter = 0;
+	size_t failures = 0;
+
+	struct Capture {
+		std::array<void*, 9> payload{};
+	};
+	static_assert(sizeof(Capture) == 72);
+
+	void report(const char* pool, const char* queuing, size_t workers, size_t tasks, std::chrono::steady_clock::time_point start)
+	{
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		bool isComplete = counter.exchange(0) == tasks;
+		failures += !isComplete;
+		std::printf("%-14s %-22s %zu workers %8.2f M tasks/s%s\n", pool, queuing, workers, tasks / seconds / 1e6, isComplete ? "" : "  tasks missing");
+	}
+
+	// Queued from the main thread, then waited for
+	template<typename Pool, typename Queue>
+	void runFromMainThread(const char* name, const char* queuing, size_t workers, size_t tasks, Queue queue)
+	{
+		Pool pool(workers);
+		auto start = std::chrono::steady_clock::now();
+		Capture capture;
+		for (size_t i = 0; i < tasks; ++i) {
+			queue(pool, [capture]() { counter.fetch_add(1, std::memory_order_relaxed); (void)capture; });
+		}
+		pool.waitForIdle();
+		report(name, queuing, workers, tasks, start);
+	}
+
+	// Every parent task queues its share of the tasks from a worker
+	template<typename Pool, typename Queue>
+	void runFromWorkers(const char* name, const char* queuing, size_t workers, size_t tasks, Queue queue)
+	{
+		Pool pool(workers);
+		auto start = std::chrono::steady_clock::now();
+		size_t tasksPerParent = tasks / parentTasks;
+		for (size_t i = 0; i < parentTasks; ++i) {
+			queue(pool, [&pool, &queue, tasksPerParent]() {
+				Capture capture;
+				for (size_t j = 0; j < tasksPerParent; ++j) {
+					queue(pool, [capture]() { counter.fetch_add(1, std::memory_order_relaxed); (void)capture; });
+				}
+			});
+		}
+		pool.waitForIdle();
+		report(name, queuing, workers, tasksPerParent * parentTasks, start);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t tasks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+	auto enqueue = [](auto& pool, auto task) { pool.enqueue(std::move(task)); };
+	auto submit = [](ThreadPool& pool, auto task) { pool.submit(std::move(task)); };
+	for (size_t workers : { 1, 4 }) {
+		runFromMainThread<SingleQueueThreadPool>("single queue", "enqueue", workers, tasks, enqueue);
+		runFromMainThread<ThreadPool>("work stealing", "enqueue", workers, tasks, enqueue);
+		runFromMainThread<ThreadPool>("work stealing", "submit", workers, tasks, submit);
+	}
+	runFromWorkers<SingleQueueThreadPool>("single queue", "enqueue from workers", 4, tasks, enqueue);
+	runFromWorkers<ThreadPool>("work stealing", "enqueue from workers", 4, tasks, enqueue);
+	runFromWorkers<ThreadPool>("work stealing", "submit from workers", 4, tasks, submit);
+	return failures == 0 ? 0 : 1;
+}